@@ -529,6 +529,35 @@ ed_cmdline (int ch)
 
 			cnf.reset_clhistory = 1;
 
+			/* symbol completion for the tag commands, from the symbol index
+			 */
+			for (ii=0; ii < cnf.cmdline_len && cnf.cmdline_buff[ii] != ' '; ii++)
+				;
+			ix = (ii > 0) ? hash_name(cnf.cmdline_buff, ii) : -1;
+			if (ix >= 0 && ix < TLEN && ii < cnf.clpos &&
+			    (strncmp(table[ix].fullname, "tag_jump_to", 12) == 0 ||
+			     strncmp(table[ix].fullname, "tag_view_info", 14) == 0))
+			{
+				if ((cnf.cmdline_buff[cnf.clpos-1] != ' ') &&
+				    (cnf.cmdline_buff[cnf.clpos] == ' ' || cnf.cmdline_buff[cnf.clpos] == '\0'))
+				{
+					/* ix points last word, characters after cursor will be lost */
+					for (ix = cnf.clpos-1; ix > ii && cnf.cmdline_buff[ix-1] != ' '; ix--)
+						;
+					cnf.cmdline_buff[cnf.clpos] = '\0';
+					choices = NULL;
+					if (!tag_complete(cnf.cmdline_buff+ix, (unsigned)(CMDLINESIZE-ix), &choices)) {
+						cnf.cmdline_len = strlen(cnf.cmdline_buff);
+						go2end_cmdline();
+						if (choices != NULL) {
+							tracemsg("%s", choices);	/* limited lines */
+						}
+					}
+					FREE(choices); choices = NULL;
+				}
+				break;
+			}
+
 			/* filename globbing
 			 * always, except ... where we can use regexp
 			 */
@@ -1110,7 +1139,7 @@ set_position (int ri, int lineno, LINE *lp)
 	update_focus(CENTER_FOCUSLINE, ri);
 	go_home();
 	if (HIDDEN_LINE(cnf.ring_curr, CURR_LINE)) {
-		CURR_LINE->lflag &= ~LMASK(cnf.ring_curr);
+		lll_unhide(CURR_LINE, LMASK(cnf.ring_curr));
 	}
 }
 
@@ -1788,6 +1817,8 @@ milbuff (LINE *lp, int from, int length, const char *replacement, int rl)
 	if (csere (&lp->buff, &lp->llen, from, length, replacement, rl)) {
 		return (-1);
 	}
+	lp->lgen = ++cnf.line_gen;
+	LINES_CHANGED(lll_ri(lp));
 
 	if (lp->buff[lp->llen-1] != '\n') {
 		/* fixit
@@ -2119,6 +2150,7 @@ duplicate (void)
 		ret=2;
 	} else {
 		lx->lflag = CURR_LINE->lflag & ~LSTAT_BM_BITS;
+		lll_hide_put(lx, lll_hide_get(CURR_LINE));
 		CURR_LINE = lx;
 
 		/* skip focus (no shadow line) */
@@ -838,7 +838,7 @@ diff_parser (const char *dataline)
 
 /*
 * general_parser - general internal parser for SPECIAL buffers,
-*	ring list, directory list, find/grep or make output
+*	ring list, directory list, find/grep or make output, outline
 */
 void
 general_parser (void)
@@ -893,7 +893,9 @@ general_parser (void)
 		}
 	}
 	else if ((strncmp(CURR_FILE.fname, "*find*", 6) == 0) ||
-		(strncmp(CURR_FILE.fname, "*make*", 6) == 0)) {
+		(strncmp(CURR_FILE.fname, "*make*", 6) == 0) ||
+		(strncmp(CURR_FILE.fname, "*changeall*", 11) == 0) ||
+		(strncmp(CURR_FILE.fname, "*outline*", 9) == 0)) {
 		simple_parser (dataline, SIMPLE_PARSER_JUMP);
 	}
 	else if (strncmp(CURR_FILE.fname, "*sh*", 4) == 0) {
@@ -957,6 +959,8 @@ is_special (const char *special)
 			tracemsg ("list of open buffers");
 		} else if (strncmp(CURR_FILE.fname, "*cmds*", 6) == 0) {
 			tracemsg ("list of commands");
+		} else if (strncmp(CURR_FILE.fname, "*outline*", 9) == 0) {
+			tracemsg ("outline of the source");
 		}
 		else if ((CURR_FILE.fflag & (FSTAT_SPECW | FSTAT_SCRATCH)) == 0) {
 			switch (CURR_FILE.ftype)
@@ -2123,7 +2127,7 @@ unhide_udiff_range (int ri, const char *range, int *target_line, int *target_len
 	cnf.fdata[ri].lineno = lineno;
 
 	while (length > 0 && TEXT_LINE(lp)) {
-		lp->lflag &= ~FMASK(cnf.fdata[ri].flevel);	/* unhide */
+		lll_unhide(lp, FMASK(cnf.fdata[ri].flevel));	/* unhide */
 		lp = lp->next;
 		length--;
 	}
@@ -2202,7 +2206,7 @@ process_diff (void)
 			if (lx_->llen > 10 && lx_->buff[0] == '@' && lx_->buff[1] == '@')
 			{
 				/* unhide diff change */
-				lx_->lflag &= ~FMASK(cnf.fdata[ri_].flevel);
+				lll_unhide(lx_, FMASK(cnf.fdata[ri_].flevel));
 
 				if (!regexec(&reg1, lx_->buff, 10, pmatch, 0) &&
 					pmatch[1].rm_so >= 0 && pmatch[1].rm_so < pmatch[1].rm_eo)
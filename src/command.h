@@ -118,19 +118,26 @@ TABLE table[] = {
 	{ "dlevel",	KEY_NONE, 2,		PN(decr_filter_level),	0x00},
 	{ "il2",	KEY_NONE, 3,		PN(incr2_filter_level),	0x00},
 	{ "dl2",	KEY_NONE, 3,		PN(decr2_filter_level),	0x00},
+	{ "fisect",	-1, 4,			PN(filter_intersect),	0x01},
+	{ "funion",	-1, 4,			PN(filter_union),	0x01},
 	{ "",		KEY_M_BACKSLASH, -1,	PN(incr_filter_cycle),	0x00},
 	{ "m1",		-1, 2,			PN(filter_m1),		0x00},
+	{ "context",	-1, 4,			PN(filter_context),	0x01},
+	{ "vsave",	-1, 5,			PN(view_save),		0x01},
+	{ "vload",	-1, 5,			PN(view_load),		0x01},
 
 	/* brace match and folding */
 	{ "match",	KEY_F9, 3,		PN(tomatch),		0x00},
 	{ "fmatch",	KEY_S_F9, 2,		PN(forcematch),		0x00},
 	{ "fblock",	KEY_S_F10, 2,		PN(fold_block),		0x00},
 	{ "thisf",	KEY_S_F11, 4,		PN(fold_thisfunc),	0x00},
+	{ "outline",	-1, 4,			PN(outline),		0x00},
 
 	/* search, change, highlight, regexp tools */
 	{ "/",		-1, 1,			PN(search),		0x01},
 	{ "",		KEY_C_L, -1,		PN(repeat_search),	0x00},
 	{ "change",	-1, 2,			PN(change),		0x03},
+	{ "changeall",	-1, 7,			PN(changeall),		0x11},
 	/* repeat_change() -- only from change() and event_handler() */
 	{ "tag",	-1, 3,			PN(color_tag),		0x11},
 	{ "tf",		KEY_M_T, 2,		PN(tag_focusline),	0x00},
@@ -142,12 +149,14 @@ TABLE table[] = {
 	/* multifile search tools */
 	{ "find",	KEY_NONE, 4,		PN(find_cmd),		0x11},
 	{ "locate",	KEY_NONE, 3,		PN(locate_cmd),		0x11},
+	{ "refs",	KEY_NONE, 4,		PN(refs_cmd),		0x11},
 	{ "lfswitch",	KEY_NONE, 2,		PN(locate_find_switch),	0x00},
 	{ "",		KEY_M_Q, -1,		PN(multisearch_cmd),	0x00},
 	{ "",		KEY_M_W, -1,		PN(find_window_switch),	0x00},
 	{ "fword",	KEY_NONE, 2,		PN(fw_option_switch),	0x00},
 	{ "fspath",	-1, 3,			PN(fsearch_path_macro),	0x01},
 	{ "fseargs",	-1, 4,			PN(fsearch_args_macro),	0x01},
+	{ "pindex",	KEY_NONE, 4,		PN(pindex_cmd),		0x11},
 
 	/* external tools, filter pipes, VCS calls and unified diffs */
 	{ "sh",		-1, 2,			PN(shell_cmd),		0x01},
@@ -198,6 +207,7 @@ TABLE table[] = {
 	{ "symbol",	KEY_F10, 3,		PN(tag_view_info),	0x11},
 	{ "jump",	KEY_F11, 1,		PN(tag_jump_to),	0x11},
 	{ "jback",	KEY_C_T, 2,		PN(tag_jump_back),	0x00},
+	{ "mktags",	KEY_NONE, 6,		PN(tag_make),		0x11},
 
 	/* export/insert, view block name and anything else */
 	{ "",		KEY_C_B, -1,		PN(ins_bname),		0x00},
@@ -32,11 +32,26 @@ extern CONFIG cnf;
 /* local proto */
 static void set_color_attribute (WINDOW *win, int idx);
 static void map_match_to_out (const char *ibuff, int imatch_so, int imatch_eo, int *pos, int padsize, int focus, const char *obuff);
+static void show_matches (LINE *lp, const regex_t *reg, unsigned rgen, int eflags, int kind, int padsize, int focus, const char *obuff);
 static void text_line (LINE *lp, int lineno, int focus, int focus_flag);
 static const char *center_fname (const char *ibuff, const char *catbuff, int catlen, int padsize);
 static void shadow_empty_line (int focus, int count);
 #define empty_line(focus)	shadow_empty_line((focus), -1)
 
+/* match cache for text_line, per LINE slot, for highlight and search */
+#define HLC_SIZE	256		/* slots, power of 2 */
+#define HLC_STEPS	32		/* regexec steps per line, more is not cached */
+#define HLC_HIGHLIGHT	0
+#define HLC_SEARCH	1
+typedef struct {
+	LINE *lp;
+	unsigned lgen;		/* LINE content generation */
+	unsigned rgen;		/* regexp generation */
+	int nstep;		/* count of steps, -1 if not cached */
+	int step[HLC_STEPS][2];	/* match so and eo, relative to the previous step */
+} HLCACHE;
+static HLCACHE hlcache[2][HLC_SIZE];
+
 static void
 set_color_attribute (WINDOW *win, int idx)
 {
@@ -525,6 +540,71 @@ map_match_to_out (const char *ibuff, int imatch_so, int imatch_eo,
 	return;
 }
 
+/* tool for text_line: show the regexp matches in the line,
+* the match steps are cached per LINE slot until the line content or the regexp changes
+*/
+static void
+show_matches (LINE *lp, const regex_t *reg, unsigned rgen, int eflags, int kind,
+	int padsize, int focus, const char *obuff)
+{
+	const char *ibuff = lp->buff;
+	HLCACHE *hc = &hlcache[kind][((unsigned long)lp / sizeof(LINE)) & (HLC_SIZE-1)];
+	regmatch_t pmatch;
+	int i=0, pos=0, k=0, disp_rflag=0;
+
+	/* refill the slot */
+	if (hc->lp != lp || hc->lgen != lp->lgen || hc->rgen != rgen) {
+		hc->lp = lp;
+		hc->lgen = lp->lgen;
+		hc->rgen = rgen;
+		hc->nstep = 0;
+		while (i < lp->llen && !regexec(reg, &ibuff[i], 1, &pmatch, disp_rflag)) {
+			if (hc->nstep >= HLC_STEPS) {
+				hc->nstep = -1;
+				break;
+			}
+			hc->step[hc->nstep][0] = pmatch.rm_so;
+			hc->step[hc->nstep][1] = pmatch.rm_eo;
+			hc->nstep++;
+			i += (pmatch.rm_so < pmatch.rm_eo) ? pmatch.rm_eo : 1;
+			disp_rflag = eflags;
+		}
+		i = 0;
+		disp_rflag = 0;
+	}
+
+	if (hc->nstep >= 0) {
+		/* from the cache */
+		for (k=0; k < hc->nstep && (pos - CURR_FILE.lnoff < padsize); k++) {
+			if (hc->step[k][0] < hc->step[k][1]) {
+				map_match_to_out(&ibuff[i], hc->step[k][0], hc->step[k][1],
+					&pos, padsize, focus, obuff);
+				i += hc->step[k][1];
+			} else {
+				i++;
+				pos++;
+			}
+		}
+	} else {
+		/* too many steps, regexec again */
+		while ((pos - CURR_FILE.lnoff < padsize) &&
+			!regexec(reg, &ibuff[i], 1, &pmatch, disp_rflag))
+		{
+			if (pmatch.rm_so < pmatch.rm_eo) {
+				map_match_to_out(&ibuff[i], pmatch.rm_so, pmatch.rm_eo,
+					&pos, padsize, focus, obuff);
+				i += pmatch.rm_eo;
+			} else {
+				i++;
+				pos++;
+			}
+			disp_rflag = eflags;
+		}
+	}
+
+	return;
+}
+
 /* text line output formatter
 */
 static void
@@ -535,7 +615,6 @@ text_line (LINE *lp, int lineno, int focus, int focus_flag)
 	int lflag = lp->lflag;
 	int idx;
 
-	static regmatch_t pmatch;
 	static char obuff[CMDLINESIZE+1];
 	int i;			/* real, valid index of ibuff */
 	int pos;		/* virtual index of rendered output */
@@ -545,7 +624,6 @@ text_line (LINE *lp, int lineno, int focus, int focus_flag)
 	int cnt=0;		/* tabstop counter, rendering */
 	int bm_char = ' ';	/* bookmark indicator in prefix */
 	int alt_char = ' ';	/* alter/change indicator in prefix */
-	char disp_rflag = 0;
 
 	if (lflag & LSTAT_TAG1)
 		idx = COLOR_TAGGED_TEXT;
@@ -639,20 +717,9 @@ text_line (LINE *lp, int lineno, int focus, int focus_flag)
 			idx += COLOR_SELECT_FLAG;
 		set_color_attribute (stdscr, idx);
 
-		i = pos = disp_rflag = 0;
-		while ((pos - CURR_FILE.lnoff < padsize) &&
-			!regexec(&(CURR_FILE.highlight_reg), &ibuff[i], 1, &pmatch, disp_rflag))
-		{
-			if (pmatch.rm_so < pmatch.rm_eo) {
-				map_match_to_out(&ibuff[i], pmatch.rm_so, pmatch.rm_eo,
-					&pos, padsize, focus, obuff);
-				i += pmatch.rm_eo;
-			} else {
-				i++;
-				pos++;
-			}
-			disp_rflag = (CURR_FILE.fflag & FSTAT_TAG6) ? REG_NOTBOL : 0;
-		}
+		show_matches (lp, &(CURR_FILE.highlight_reg), CURR_FILE.highlight_gen,
+			((CURR_FILE.fflag & FSTAT_TAG6) ? REG_NOTBOL : 0), HLC_HIGHLIGHT,
+			padsize, focus, obuff);
 		wattrset (stdscr, A_NORMAL);
 	}
 
@@ -670,20 +737,9 @@ text_line (LINE *lp, int lineno, int focus, int focus_flag)
 			idx += COLOR_SELECT_FLAG;
 		set_color_attribute (stdscr, idx);
 
-		i = pos = disp_rflag = 0;
-		while ((pos - CURR_FILE.lnoff < padsize) &&
-			!regexec(&(CURR_FILE.search_reg), &ibuff[i], 1, &pmatch, disp_rflag))
-		{
-			if (pmatch.rm_so < pmatch.rm_eo) {
-				map_match_to_out(&ibuff[i], pmatch.rm_so, pmatch.rm_eo,
-					&pos, padsize, focus, obuff);
-				i += pmatch.rm_eo;
-			} else {
-				i++;
-				pos++;
-			}
-			disp_rflag = (CURR_FILE.fflag & FSTAT_TAG4) ? REG_NOTBOL : 0;
-		}
+		show_matches (lp, &(CURR_FILE.search_reg), CURR_FILE.search_gen,
+			((CURR_FILE.fflag & FSTAT_TAG4) ? REG_NOTBOL : 0), HLC_SEARCH,
+			padsize, focus, obuff);
 		wattrset (stdscr, A_NORMAL);
 	}
 
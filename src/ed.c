@@ -280,6 +280,7 @@ event_handler (void)
 	int clear_trace_next_time = 0;
 	char args_buff[CMDLINESIZE];
 	int last_ri = -1, ring_siz = 0;
+	int cmd_typed = 0;
 
 	wclear (stdscr);
 
@@ -408,6 +409,9 @@ event_handler (void)
 				if (check_files()) {
 					ch = REFRESH_EVENT;
 				}
+				if (tag_reload_check()) {
+					ch = REFRESH_EVENT;
+				}
 				delay_cnt_4stat = 0;
 			} else {
 				/* most free slots:
@@ -422,6 +426,7 @@ event_handler (void)
 			continue;
 		}
 		ret = 0;
+		cmd_typed = 0;
 
 		/*
 		 * input processing
@@ -430,6 +435,7 @@ event_handler (void)
 			/* cmdline intern editing, (ret 0/1) */
 			ret = ed_cmdline (ch);		/* 0/1 */
 			upd_event = ret;
+			cmd_typed = (ret && ch != KEY_RETURN);
 
 			if (ret && ch == KEY_RETURN) {
 				if (cnf.cmdline_len == 7 && !strncmp(cnf.cmdline_buff, "errdump", 7)) {
@@ -517,6 +523,11 @@ event_handler (void)
 			}
 		}
 
+		/* incremental search follows the typed search command */
+		if (cnf.ring_size > 0) {
+			incsearch_update (cmd_typed);
+		}
+
 	} /* while */
 	if (!cnf.noconfig) {
 		save_clhistory ();
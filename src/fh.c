@@ -972,10 +972,14 @@ scratch_buffer (const char *fname)
 	cnf.fdata[ring_i].pipe_output = 0;
 	cnf.fdata[ring_i].readbuff = NULL;
 	cnf.fdata[ring_i].chrw = -1;
+	cnf.fdata[ring_i].lindex = NULL;
+	cnf.fdata[ring_i].cblocks = NULL;
+	cnf.fdata[ring_i].lcache = NULL;
+	cnf.fdata[ring_i].openers = NULL;
 
 	if (!ret) {
 		cnf.fdata[ring_i].top = append_line (NULL, TOP_MARK);
-		if (cnf.fdata[ring_i].top != NULL) {
+		if (cnf.fdata[ring_i].top != NULL && !lll_index_init(ring_i, cnf.fdata[ring_i].top)) {
 			cnf.fdata[ring_i].top->lflag |= LSTAT_TOP;
 		} else {
 			ret=2;
@@ -1420,6 +1424,9 @@ clean_buffer (void)
 	if (CURR_FILE.fflag & FSTAT_TAG5) {
 		regfree(&CURR_FILE.highlight_reg);
 	}
+	cblocks_drop(cnf.ring_curr);
+	lcache_drop(cnf.ring_curr);
+	openers_drop(cnf.ring_curr);
 	/* remove bookmarks, etc */
 	clear_bookmarks(cnf.ring_curr);
 	mhist_clear(cnf.ring_curr);
@@ -1448,7 +1455,8 @@ drop_file (void)
 			reset_select();		/* in drop_file() */
 		}
 
-		/* remove all lines */
+		/* remove all lines, the index first */
+		lll_index_drop(ring_i);
 		lp = cnf.fdata[ring_i].curr_line;
 		while (lp != NULL)
 			lp = lll_rm(lp);		/* in: drop_file() */
@@ -1460,6 +1468,9 @@ drop_file (void)
 		if (cnf.fdata[ring_i].fflag & FSTAT_TAG5) {
 			regfree(&cnf.fdata[ring_i].highlight_reg);
 		}
+		cblocks_drop(ring_i);
+		lcache_drop(ring_i);
+		openers_drop(ring_i);
 
 		origin = cnf.fdata[ring_i].origin;
 
@@ -1516,7 +1527,8 @@ drop_all (void)
 		cnf.ring_curr = ri;
 		stop_bg_process();	/* drop_all() */
 
-		/* remove all lines */
+		/* remove all lines, the index first */
+		lll_index_drop(ri);
 		lp = cnf.fdata[ri].curr_line;
 		while (lp != NULL)
 			lp = lll_rm(lp);	/* drop_all() */
@@ -1528,6 +1540,9 @@ drop_all (void)
 		if (cnf.fdata[ri].fflag & FSTAT_TAG5) {
 			regfree(&cnf.fdata[ri].highlight_reg);
 		}
+		cblocks_drop(ri);
+		lcache_drop(ri);
+		openers_drop(ri);
 
 		cnf.fdata[ri].fflag = 0;
 		cnf.fdata[ri].fpath[0] = '\0';
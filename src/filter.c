@@ -23,6 +23,7 @@
 #include <config.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <syslog.h>
 #include "main.h"
 #include "proto.h"
@@ -34,6 +35,35 @@ extern CONFIG cnf;
 static int filter_func_eng_clang (int action, int fmask, char *symbol);
 static int filter_func_eng_other (int action, int fmask, char *symbol);
 static int filter_func_eng_easy (int action, int fmask, char *symbol);
+static int filter_combine (const char *arg, int intersect);
+static int filter_ranges (int action, int fmask, const char *list);
+static int range_cmp (const void *p1, const void *p2);
+static int view_path (int ri, const char *name, char *vfile, int vsize, char **fullpath);
+static int filter_context_eng (int nctx);
+static int cblocks_update (int ri);
+static int line_sinfo (int ri, LINE *lx, const regex_t *reg, int key);
+static LCACHE *lcache_slot (int ri, const LINE *lp);
+static OPENERS *openers_update (int ri, const regex_t *reg, int key);
+static int openers_find (const OPENERS *op, int lineno);
+static const int *line_skeleton (int ri, const LINE *lp, int kind);
+static int fold_indent_block (int fmask);
+static int fold_lines (LINE *lp_head, LINE *lp_end, int hidden_to_end, int fmask, int with_end);
+static int cblocks_match (int ri, LINE **io_lp, int *io_lineno, int *io_lncol);
+static int outline_line (LINE **lpp, const char *fname, int lineno, const LINE *lx);
+static int outline_clang (int ri, LINE **lpp, int *io_focus);
+static int outline_other (int ri, LINE **lpp, int *io_focus);
+
+/* the source of the *outline* buffer, the list is kept while the lgen of the source is the same */
+static int outline_ri = -1;
+static unsigned outline_gen = 0;
+static int outline_ftype = 0;
+static char outline_fname[FNAMESIZE];
+
+/* saved filter view file header, with the format version */
+#define VIEW_MAGIC	"EDAVIEW1"
+
+/* hash of the line pointer for the skeleton table */
+#define LCACHE_HASH(lp)	( (unsigned)(((unsigned long)(lp) / sizeof(LINE)) * 2654435761UL) )
 
 /*
 * base movement: move to next line point,
@@ -42,7 +72,7 @@ static int filter_func_eng_easy (int action, int fmask, char *symbol);
 int
 next_lp (int ri, LINE **linep_p, int *count)
 {
-	LINE *lx;
+	LINE *lx, *lp;
 	int cnt=0, fmask=0;
 
 	/* fmask for the lines */
@@ -54,12 +84,17 @@ next_lp (int ri, LINE **linep_p, int *count)
 		ERRLOG(0xE072); /* start line lx==NULL */
 		return (1);
 	}
-	while ( (lx->next != NULL) && !(lx->lflag & LSTAT_BOTTOM) ) {
-		lx = lx->next;
-		cnt++;
-		/* take it, if not masked */
-		if ( !(lx->lflag & fmask) )
-			break;
+	/* the hide bits of the line index skip the hidden lines */
+	if ((lp = lll_next_visible(lx, (fmask) ? cnf.fdata[ri].flevel : 0, &cnt)) != NULL) {
+		lx = lp;
+	} else {
+		while ( (lx->next != NULL) && !(lx->lflag & LSTAT_BOTTOM) ) {
+			lx = lx->next;
+			cnt++;
+			/* take it, if not masked */
+			if ( !HIDDEN_LINE(ri, lx) )
+				break;
+		}
 	}
 
 	*linep_p = lx;
@@ -75,7 +110,7 @@ next_lp (int ri, LINE **linep_p, int *count)
 int
 prev_lp (int ri, LINE **linep_p, int *count)
 {
-	LINE *lx;
+	LINE *lx, *lp;
 	int cnt=0, fmask=0;
 
 	/* fmask for the lines */
@@ -87,12 +122,17 @@ prev_lp (int ri, LINE **linep_p, int *count)
 		ERRLOG(0xE071); /* start line lx==NULL */
 		return (1);
 	}
-	while ( (lx->prev != NULL) && !(lx->lflag & LSTAT_TOP) ) {
-		lx = lx->prev;
-		cnt++;
-		/* take it, if not masked */
-		if ( !(lx->lflag & fmask) )
-			break;
+	/* the hide bits of the line index skip the hidden lines */
+	if ((lp = lll_prev_visible(lx, (fmask) ? cnf.fdata[ri].flevel : 0, &cnt)) != NULL) {
+		lx = lp;
+	} else {
+		while ( (lx->prev != NULL) && !(lx->lflag & LSTAT_TOP) ) {
+			lx = lx->prev;
+			cnt++;
+			/* take it, if not masked */
+			if ( !HIDDEN_LINE(ri, lx) )
+				break;
+		}
 	}
 
 	*linep_p = lx;
@@ -106,7 +146,8 @@ prev_lp (int ri, LINE **linep_p, int *count)
 /*
 ** filter_all - make all lines visible according to the parameter, those and only those;
 **	special arguments are "alter" meaning altered lines, "selection",
-**	"function" meaning functions and headers, and ":<linenumber>",
+**	"function" meaning functions and headers, ":<linenumber>" and range lists
+**	like ":10-200,5000-5100,tagged,bm" (tagged and bookmarked lines also),
 **	otherwise argument is handled as regexp
 */
 int
@@ -118,7 +159,8 @@ filter_all (const char *expr)
 /*
 ** filter_more - make more lines visible according to the parameter;
 **	special arguments are "alter" meaning altered lines, "selection",
-**	"function" meaning functions and headers, and ":<linenumber>",
+**	"function" meaning functions and headers, ":<linenumber>" and range lists
+**	like ":10-200,5000-5100,tagged,bm" (tagged and bookmarked lines also),
 **	otherwise the argument is handled as regexp
 */
 int
@@ -130,7 +172,8 @@ filter_more (const char *expr)
 /*
 ** filter_less - make less lines visible according to the parameter;
 **	special arguments are "alter" meaning altered lines, "selection",
-**	"function" meaning functions and headers, and ":<linenumber>",
+**	"function" meaning functions and headers, ":<linenumber>" and range lists
+**	like ":10-200,5000-5100,tagged,bm" (tagged and bookmarked lines also),
 **	otherwise the argument is handled as regexp
 */
 int
@@ -146,28 +189,54 @@ filter_less (const char *expr)
 int
 filter_m1 (void)
 {
-	int prev, masked;
-	int fmask;
-	LINE *lx;
+	return (filter_context_eng (1));
+}
 
-	/* activate filter */
-	CURR_FILE.fflag |= FMASK(CURR_FILE.flevel);
-	fmask = FMASK(CURR_FILE.flevel);
+/*
+** filter_context - make <n> lines more visible around sequences of visible lines,
+**	like the context lines of grep -C <n> (expand unhidden ranges)
+*/
+int
+filter_context (const char *arg)
+{
+	int nctx;
+
+	nctx = atoi(arg);
+	if (nctx < 1) {
+		tracemsg("number of context lines must be positive");
+		return (1);
+	}
+	return (filter_context_eng (nctx));
+}
 
-	lx = CURR_FILE.top->next;
-	prev = (lx->lflag & fmask);
+/*
+ * unhide nctx lines at both ends of the hidden runs, next to the visible lines;
+ * the runs are found in the hide bitset and unhidden in place, word-wide
+ */
+static int
+filter_context_eng (int nctx)
+{
+	int ri, level, end, from, first, last;
 
-	while (TEXT_LINE(lx)) {
-		masked = (lx->lflag & fmask);
-		if (prev != masked) {
-			if (masked) {
-				lx->lflag &= ~fmask;
-			} else {
-				lx->prev->lflag &= ~fmask;
-			}
+	/* activate filter */
+	CURR_FILE.fflag |= FMASK(CURR_FILE.flevel);
+	ri = cnf.ring_curr;
+	level = CURR_FILE.flevel;
+	end = CURR_FILE.num_lines+1;
+
+	from = 1;
+	while ((first = lll_hide_find(ri, level, from, end, 1)) < end) {
+		/* the hidden run is [first,last) */
+		last = lll_hide_find(ri, level, first, end, 0);
+		if (first > 1) {
+			/* after a visible line */
+			lll_hide_range(ri, level, first, MIN(first+nctx, last), 0);
 		}
-		prev = masked;
-		lx = lx->next;
+		if (last < end) {
+			/* before a visible line */
+			lll_hide_range(ri, level, MAX(last-nctx, first), last, 0);
+		}
+		from = last;
 	}
 
 	return (0);
@@ -178,7 +247,7 @@ filter_m1 (void)
 /*
 * filter engine for 'all', 'less' and 'more';
 * "all" will show all lines, "less" will show no lines, "more" will do nothing;
-* special arguments are "alter", "selection", "function" and ":<linenumber>",
+* special arguments are "alter", "selection", "function", ":<linenumber>" and ":<range-list>",
 * otherwise argument is handled as regexp
 */
 int
@@ -197,19 +266,11 @@ filter_base (int action, const char *expr)
 	if (len==0) {
 		if (action == FILTER_ALL) {
 			/* view all lines */
-			lx = CURR_FILE.top->next;
-			while (TEXT_LINE(lx)) {
-				lx->lflag &= ~fmask;
-				lx = lx->next;
-			}
+			lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, 1, CURR_FILE.num_lines+1, 0);
 			ret = 0;
 		} else if (action == FILTER_LESS) {
 			/* hide all lines */
-			lx = CURR_FILE.top->next;
-			while (TEXT_LINE(lx)) {
-				lx->lflag |= fmask;
-				lx = lx->next;
-			}
+			lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, 1, CURR_FILE.num_lines+1, 1);
 			ret = 0;
 		} else {
 			/* nothing to do for more */
@@ -224,11 +285,11 @@ filter_base (int action, const char *expr)
 			while (TEXT_LINE(lx)) {
 				if (lx->lflag & (LSTAT_ALTER | LSTAT_CHANGE)) {
 					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
+						lll_unhide(lx, fmask);
 					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
+						lll_hide(lx, fmask);
 				} else if (action & FILTER_ALL) {
-					lx->lflag |= fmask;
+					lll_hide(lx, fmask);
 				}
 				lx = lx->next;
 			}
@@ -240,11 +301,11 @@ filter_base (int action, const char *expr)
 			while (TEXT_LINE(lx)) {
 				if (lx->lflag & LSTAT_SELECT) {
 					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
+						lll_unhide(lx, fmask);
 					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
+						lll_hide(lx, fmask);
 				} else if (action & FILTER_ALL) {
-					lx->lflag |= fmask;
+					lll_hide(lx, fmask);
 				}
 				lx = lx->next;
 				lineno++;
@@ -257,11 +318,11 @@ filter_base (int action, const char *expr)
 			while (TEXT_LINE(lx)) {
 				if (alien_count(lx) > 0) {
 					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
+						lll_unhide(lx, fmask);
 					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
+						lll_hide(lx, fmask);
 				} else if (action & FILTER_ALL) {
-					lx->lflag |= fmask;
+					lll_hide(lx, fmask);
 				}
 				lx = lx->next;
 				lineno++;
@@ -271,25 +332,24 @@ filter_base (int action, const char *expr)
 		} else if (len >= 4 && strncmp(expr, "function", len)==0) {
 			ret = filter_func (action, fmask);
 
+		} else if (len >= 2 && expr[0] == ':' && expr[1+strspn(&expr[1], "0123456789")] != '\0') {
+			ret = filter_ranges (action, fmask, &expr[1]);
+
 		} else if (len >= 2 && expr[0] == ':') {
 			ret = 1;
 			lineno = atoi(&expr[1]);
 			if (lineno >= 1 && lineno <= CURR_FILE.num_lines) {
 				if (action & FILTER_ALL) {
-					lx = CURR_FILE.top->next;
-					while (TEXT_LINE(lx)) {
-						lx->lflag |= fmask;
-						lx = lx->next;
-					}
+					lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, 1, CURR_FILE.num_lines+1, 1);
 				}
 				lx = lll_goto_lineno (cnf.ring_curr, lineno);
 				if (TEXT_LINE(lx)) {
 					CURR_LINE = lx;
 					CURR_FILE.lineno = lineno;
 					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
+						lll_unhide(lx, fmask);
 					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
+						lll_hide(lx, fmask);
 					ret = 0;
 				}
 			}
@@ -327,6 +387,359 @@ filter_base (int action, const char *expr)
 	return (ret);
 } /* filter_base */
 
+/* sort the line ranges by the first line
+*/
+static int
+range_cmp (const void *p1, const void *p2)
+{
+	const int *r1=p1;
+	const int *r2=p2;
+	if (r1[0] < r2[0])
+		return -1;
+	if (r1[0] > r2[0])
+		return 1;
+	return 0;
+}
+
+/*
+* filter by range list, comma separated items of "<lineno>", "<from>-<to>", "tagged" and "bm",
+* the ranges are merged first and done word-wide, the tagged and bookmarked lines in one pass;
+* return 0 if ok, 1 if the list is invalid
+*/
+static int
+filter_ranges (int action, int fmask, const char *list)
+{
+	int *rg;
+	int nrg, i, j, from, to, lbits, len;
+	const char *item;
+	char *end;
+	LINE *lx;
+
+	for (nrg=1, i=0; list[i] != '\0'; i++) {
+		if (list[i] == ',')
+			nrg++;
+	}
+	if ((rg = (int *) MALLOC(sizeof(int) * 2 * (size_t)nrg)) == NULL) {
+		ERRLOG(0xE0D5);
+		return (1);
+	}
+
+	/* parse the items: ranges and line bits */
+	nrg = 0;
+	lbits = 0;
+	for (item = list; *item != '\0'; item += (*item == ',') ? 1 : 0) {
+		while (*item == ' ')
+			item++;
+		len = strcspn(item, ", ");
+		if (len >= 2 && strncmp(item, "tagged", (size_t)len) == 0) {
+			lbits |= LSTAT_TAG1;
+		} else if (len == 2 && strncmp(item, "bm", 2) == 0) {
+			lbits |= LSTAT_BM_BITS;
+		} else if (item[0] >= '0' && item[0] <= '9') {
+			from = to = (int) strtol(item, &end, 10);
+			if (*end == '-')
+				to = (int) strtol(end+1, &end, 10);
+			if (end != item+len || from < 1 || to < from) {
+				len = 0;
+			} else {
+				rg[2*nrg] = from;
+				rg[2*nrg+1] = to;
+				nrg++;
+			}
+		} else {
+			len = 0;
+		}
+		if (len == 0) {
+			tracemsg("invalid item in range list: %s", item);
+			FREE(rg);
+			return (1);
+		}
+		item += len;
+		while (*item == ' ')
+			item++;
+	}
+
+	/* merge the overlapping and adjacent ranges */
+	qsort(rg, (size_t)nrg, sizeof(int) * 2, range_cmp);
+	for (i=0, j=1; j < nrg; j++) {
+		if (rg[2*j] <= rg[2*i+1] + 1) {
+			if (rg[2*i+1] < rg[2*j+1])
+				rg[2*i+1] = rg[2*j+1];
+		} else {
+			i++;
+			rg[2*i] = rg[2*j];
+			rg[2*i+1] = rg[2*j+1];
+		}
+	}
+	if (nrg > 0)
+		nrg = i+1;
+
+	/* the ranges on the bits of the level */
+	if (action & FILTER_ALL)
+		lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, 1, CURR_FILE.num_lines+1, 1);
+	for (i=0; i < nrg && (action & (FILTER_MORE | FILTER_ALL | FILTER_LESS)); i++) {
+		lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, rg[2*i], rg[2*i+1]+1,
+			!(action & (FILTER_MORE | FILTER_ALL)));
+	}
+	FREE(rg);
+
+	/* one pass over the buffer for the line bits */
+	if (lbits) {
+		for (lx = CURR_FILE.top->next; TEXT_LINE(lx); lx = lx->next) {
+			if (lx->lflag & lbits) {
+				if (action & (FILTER_MORE | FILTER_ALL))
+					lll_unhide(lx, fmask);
+				else if (action & FILTER_LESS)
+					lll_hide(lx, fmask);
+			}
+		}
+	}
+
+	return (0);
+} /* filter_ranges */
+
+/*
+* the saved view file of the buffer in the ~/.eda/ directory, "<name>-<hash of the path>.view",
+* and the canonical path of the file (malloc'd) for the header;
+* return 0 if ok, 1 if the name is invalid or the path is not available
+*/
+static int
+view_path (int ri, const char *name, char *vfile, int vsize, char **fullpath)
+{
+	unsigned hash = 2166136261U;
+	int i;
+
+	for (i=0; name[i] != '\0'; i++) {
+		if (!((name[i] >= 'a' && name[i] <= 'z') || (name[i] >= 'A' && name[i] <= 'Z') ||
+		(name[i] >= '0' && name[i] <= '9') || name[i] == '_' || name[i] == '-' || name[i] == '.'))
+			return (1);
+	}
+	if (i == 0 || i > SHORTNAME/2 || name[0] == '.')
+		return (1);
+
+	if ((*fullpath = canonicalpath(cnf.fdata[ri].fpath)) == NULL)
+		return (1);
+	for (i=0; (*fullpath)[i] != '\0'; i++) {
+		hash = (hash ^ (unsigned char)(*fullpath)[i]) * 16777619U;
+	}
+	snprintf(vfile, (size_t)vsize, "%s%s-%08x.view", cnf.myhome, name, hash);
+
+	return (0);
+} /* view_path */
+
+/*
+* view_write - save the visibility of the lines on the current filter level of the buffer
+*	as a named view, run-length encoded, keyed by the path, mtime and size of the file;
+*	return 0 if ok, 1 if not possible (buffer changed), 2 if write failed
+*/
+int
+view_write (int ri, const char *name)
+{
+	char vfile[sizeof(cnf.myhome)+SHORTNAME];
+	char *fullpath=NULL;
+	FILE *fp;
+	int level, hidden, from, end, k, nruns, ret=0;
+
+	if ((cnf.fdata[ri].fflag & (FSTAT_SPECW | FSTAT_SCRATCH | FSTAT_CHANGE)) ||
+	cnf.fdata[ri].stat.st_mtime == 0) {
+		return (1);
+	}
+	if (view_path (ri, name, vfile, sizeof(vfile), &fullpath)) {
+		return (1);
+	}
+	if ((fp = fopen(vfile, "w")) == NULL) {
+		FREE(fullpath);
+		return (2);
+	}
+	fprintf(fp, "%s\n%s\n%lld %lld %d\n", VIEW_MAGIC, fullpath,
+		(long long)cnf.fdata[ri].stat.st_mtime, (long long)cnf.fdata[ri].stat.st_size,
+		cnf.fdata[ri].num_lines);
+	FREE(fullpath);
+
+	/* runs of visible and hidden lines, alternating, the first is visible (maybe 0) */
+	level = cnf.fdata[ri].flevel;
+	end = cnf.fdata[ri].num_lines+1;
+	hidden = 0;
+	from = 1;
+	nruns = 0;
+	do {
+		k = lll_hide_find(ri, level, from, end, !hidden);
+		fprintf(fp, "%d\n", k - from);
+		nruns++;
+		hidden = !hidden;
+		from = k;
+	} while (from < end);
+
+	if (ferror(fp)) {
+		ERRLOG(0xE0D6);
+		ret = 2;
+	}
+	if (fclose(fp) != 0) {
+		ret = 2;
+	}
+	if (ret) {
+		unlink(vfile);
+	} else {
+		FILT_LOG(LOG_NOTICE, "view %s saved, %d runs", name, nruns);
+	}
+
+	return (ret);
+} /* view_write */
+
+/*
+* view_read - restore the named view on the current filter level of the current buffer,
+*	if the file was not changed since the view was saved;
+*	return 0 if ok, 1 if there is no such view, 2 if the view is not valid for the file
+*/
+int
+view_read (const char *name)
+{
+	char vfile[sizeof(cnf.myhome)+SHORTNAME];
+	char str[FNAMESIZE+20];
+	char *fullpath=NULL;
+	FILE *fp;
+	LINE *lx;
+	int *runs;
+	int nruns, size, i, k, fmask, len, ret=0;
+	long long mtime, fsize;
+	int nlines;
+	void *ptr;
+
+	if ((CURR_FILE.fflag & (FSTAT_SPECW | FSTAT_SCRATCH)) ||
+	view_path (cnf.ring_curr, name, vfile, sizeof(vfile), &fullpath)) {
+		return (1);
+	}
+	if ((fp = fopen(vfile, "r")) == NULL) {
+		FREE(fullpath);
+		return (1);
+	}
+
+	/* header: magic, path, mtime size lines */
+	ret = 2;
+	if (fgets(str, sizeof(str), fp) != NULL && strncmp(str, VIEW_MAGIC "\n", sizeof(VIEW_MAGIC)) == 0 &&
+	fgets(str, sizeof(str), fp) != NULL)
+	{
+		len = strlen(str);
+		if (len > 0 && str[len-1] == '\n')
+			str[--len] = '\0';
+		if (strncmp(str, fullpath, sizeof(str)) == 0 && fgets(str, sizeof(str), fp) != NULL &&
+		sscanf(str, "%lld %lld %d", &mtime, &fsize, &nlines) == 3 &&
+		mtime == (long long)CURR_FILE.stat.st_mtime && fsize == (long long)CURR_FILE.stat.st_size &&
+		nlines == CURR_FILE.num_lines && !(CURR_FILE.fflag & FSTAT_CHANGE))
+		{
+			ret = 0;
+		}
+	}
+	FREE(fullpath);
+	if (ret) {
+		fclose(fp);
+		return (ret);
+	}
+
+	/* the runs, and the sum must be the line count */
+	runs = NULL;
+	nruns = size = 0;
+	k = 0;
+	while (fgets(str, sizeof(str), fp) != NULL) {
+		if (nruns >= size) {
+			size = size * 2 + 1024;
+			if ((ptr = REALLOC((void *)runs, sizeof(int) * (size_t)size)) == NULL) {
+				ERRLOG(0xE0D6);
+				ret = 2;
+				break;
+			}
+			runs = (int *) ptr;
+		}
+		runs[nruns] = atoi(str);
+		if (runs[nruns] < 0) {
+			ret = 2;
+			break;
+		}
+		k += runs[nruns++];
+	}
+	fclose(fp);
+	if (ret == 0 && k != CURR_FILE.num_lines) {
+		ret = 2;
+	}
+
+	if (ret == 0) {
+		/* activate filter */
+		fmask = FMASK(CURR_FILE.flevel);
+		CURR_FILE.fflag |= fmask;
+		for (i=0, k=1; i < nruns; k += runs[i], i++) {
+			lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, k, k + runs[i], (i & 1));
+		}
+		/* skip to next if line not visible */
+		if (HIDDEN_LINE(cnf.ring_curr,CURR_LINE)) {
+			lx = CURR_LINE;
+			next_lp (cnf.ring_curr, &lx, &k);
+			if (TEXT_LINE(lx)) {
+				CURR_LINE = lx;
+				CURR_FILE.lineno += k;
+			} else {
+				lx = CURR_LINE;
+				prev_lp (cnf.ring_curr, &lx, &k);
+				CURR_LINE = lx;
+				CURR_FILE.lineno -= k;
+			}
+		}
+	}
+	FREE(runs);
+
+	return (ret);
+} /* view_read */
+
+/*
+** view_save - save the visible lines of the current filter level as a named view (like "vsave errors"),
+**	the view can be restored by view_load later, while the file is unchanged
+*/
+int
+view_save (const char *name)
+{
+	int ret;
+
+	if (name[0] == '\0') {
+		tracemsg("view name missing");
+		return (0);
+	}
+	ret = view_write (cnf.ring_curr, name);
+	if (ret == 1) {
+		tracemsg("cannot save view %s, save the file first (or invalid name)", name);
+	} else if (ret) {
+		tracemsg("cannot save view %s", name);
+	} else {
+		tracemsg("view %s saved", name);
+	}
+
+	return (ret);
+} /* view_save */
+
+/*
+** view_load - restore the named view (saved by view_save) on the current filter level,
+**	the view is valid only while the file is unchanged
+*/
+int
+view_load (const char *name)
+{
+	int ret;
+
+	if (name[0] == '\0') {
+		tracemsg("view name missing");
+		return (0);
+	}
+	ret = view_read (name);
+	if (ret == 1) {
+		tracemsg("view %s not found", name);
+	} else if (ret) {
+		tracemsg("view %s is not valid, the file has changed", name);
+	} else {
+		update_focus(FOCUS_AVOID_BORDER, cnf.ring_curr);
+		CURR_FILE.lncol = get_col(CURR_LINE, CURR_FILE.curpos);
+	}
+
+	return (ret);
+} /* view_load */
+
 /*
 * view or hide function headers: more or less
 */
@@ -521,7 +934,7 @@ filter_func_eng_clang (int action, int fmask, char *symbol)
 		/* hide all lines */
 		lx = CURR_FILE.top->next;
 		while (TEXT_LINE(lx)) {
-			lx->lflag |= fmask;
+			lll_hide(lx, fmask);
 			lx = lx->next;
 		}
 	}
@@ -578,9 +991,9 @@ filter_func_eng_clang (int action, int fmask, char *symbol)
 	while (TEXT_LINE(lx)) {
 		if (lx->buff[0] == '}') {
 			if (action & (FILTER_MORE | FILTER_ALL))
-				lx->lflag &= ~fmask;
+				lll_unhide(lx, fmask);
 			else if (action & FILTER_LESS)
-				lx->lflag |= fmask;
+				lll_hide(lx, fmask);
 			lncol = 0;
 			lx = tomatch_eng (lx, &lno, &lncol, TOMATCH_DONT_SET_FOCUS | PURIFY_CLANG);
 			if (!(TEXT_LINE(lx) && lx->buff[lncol] == '{'))
@@ -626,9 +1039,9 @@ filter_func_eng_clang (int action, int fmask, char *symbol)
 				if (show_hide) {
 					/* set flag for hide or clear to make visible */
 					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
+						lll_unhide(lx, fmask);
 					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
+						lll_hide(lx, fmask);
 				}
 				if (!searching_for_header) {
 					if (action & FILTER_GET_SYMBOL) {
@@ -665,6 +1078,128 @@ filter_func_eng_clang (int action, int fmask, char *symbol)
 	return 0;
 }
 
+/*
+ * structure info of the line: indentation depth, blank line and header flags (SINFO_),
+ * cached in the line cache of the buffer until the line content changes
+ */
+static int
+line_sinfo (int ri, LINE *lx, const regex_t *reg, int key)
+{
+	LCACHE *lc;
+	regmatch_t pmatch;
+	int blanks, info;
+
+	lc = lcache_slot (ri, lx);
+	if (lc != NULL && lc->sgen == lx->lgen && (lc->sinfo & (SINFO_FTYPE | SINFO_ICASE)) == key)
+		return (lc->sinfo);
+
+	blanks = count_prefix_blanks (lx->buff, lx->llen);
+	if (!(lx->buff[blanks] > ' ')) {
+		info = key | SINFO_BLANK;
+	} else {
+		info = key | ((blanks < SINFO_INDENT) ? blanks : SINFO_INDENT);
+		if (!regexec(reg, lx->buff, 1, &pmatch, 0))
+			info |= SINFO_HEADER;
+	}
+	if (lc != NULL) {
+		lc->sinfo = info;
+		lc->sgen = lx->lgen;
+	}
+
+	return (info);
+}
+
+/*
+** openers_drop - free the block opener list of the buffer
+*/
+void
+openers_drop (int ri)
+{
+	OPENERS *op = cnf.fdata[ri].openers;
+
+	if (op != NULL) {
+		FREE(op->lines);
+		FREE(op->linenos);
+		FREE(op);
+		cnf.fdata[ri].openers = NULL;
+	}
+} /* openers_drop */
+
+/*
+ * bring the block opener list of the buffer up to date, after any change of the lines
+ * the headers are collected again, the regex runs only on the changed lines;
+ * return the list or NULL on failure
+ */
+static OPENERS *
+openers_update (int ri, const regex_t *reg, int key)
+{
+	OPENERS *op;
+	LINE *lx;
+	void *ptr;
+	int lno, size;
+
+	op = cnf.fdata[ri].openers;
+	if (op == NULL) {
+		if ((op = (OPENERS *) MALLOC(sizeof(OPENERS))) == NULL) {
+			ERRLOG(0xE0E4);
+			return (NULL);
+		}
+		memset(op, 0, sizeof(OPENERS));
+		cnf.fdata[ri].openers = op;
+	} else if (op->line_gen == cnf.fdata[ri].lgen && op->key == key) {
+		return (op);
+	}
+
+	op->count = 0;
+	lno = 1;
+	for (lx = cnf.fdata[ri].top->next; TEXT_LINE(lx); lx = lx->next, lno++) {
+		if (!(line_sinfo(ri, lx, reg, key) & SINFO_HEADER))
+			continue;
+		if (op->count >= op->size) {
+			size = op->size * 2 + 256;
+			if ((ptr = REALLOC((void *)op->lines, sizeof(LINE *) * (size_t)size)) == NULL)
+				break;
+			op->lines = (LINE **) ptr;
+			if ((ptr = REALLOC((void *)op->linenos, sizeof(int) * (size_t)size)) == NULL)
+				break;
+			op->linenos = (int *) ptr;
+			op->size = size;
+		}
+		op->lines[op->count] = lx;
+		op->linenos[op->count] = lno;
+		op->count++;
+	}
+	if (TEXT_LINE(lx)) {
+		ERRLOG(0xE0E4);
+		openers_drop(ri);
+		return (NULL);
+	}
+
+	op->line_gen = cnf.fdata[ri].lgen;
+	op->key = key;
+	return (op);
+} /* openers_update */
+
+/*
+ * index of the last block opener at or above the line, or -1 if there is none
+ */
+static int
+openers_find (const OPENERS *op, int lineno)
+{
+	int lo, hi, mid;
+
+	lo = 0;
+	hi = op->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (op->linenos[mid] <= lineno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo - 1);
+}
+
 /* the "main" is not necessarily a block, the source is often just flat,
 * so the only reliable pattern is the header line, use the regexp match
 */
@@ -672,23 +1207,16 @@ static int
 filter_func_eng_other (int action, int fmask, char *symbol)
 {
 	LINE *lx;
+	OPENERS *op;
 	regex_t reg1;
 	const char *expr;
 	regmatch_t pmatch[10];	/* match and sub match */
-	int lncol, lno, searching_for_brace;
+	int i, lncol, lno;
+	int key = SINFO_KEY(CURR_FILE.ftype);
 
 	if (CURR_FILE.num_lines < 1)
 		return 0;
 
-	if (action & FILTER_ALL) {
-		/* hide all lines */
-		lx = CURR_FILE.top->next;
-		while (TEXT_LINE(lx)) {
-			lx->lflag |= fmask;
-			lx = lx->next;
-		}
-	}
-
 	if (CURR_FILE.ftype == PERL_FILETYPE) {
 		expr = PERL_HEADER_PATTERN;
 		if (regcomp (&reg1, expr, REGCOMP_OPTION)) {
@@ -705,73 +1233,75 @@ filter_func_eng_other (int action, int fmask, char *symbol)
 		return 0;
 	}
 
-	if (action & FILTER_GET_SYMBOL) {
-		lx = CURR_LINE;
-		lno = CURR_FILE.lineno;
-		while ((symbol != NULL) && TEXT_LINE(lx)) {
-			if (!regexec(&reg1, lx->buff, 10, pmatch, 0)) {
-				int ix, iy, nsub;
-				// maybe 2 subpatterns
-				nsub = (pmatch[2].rm_so >= 0 && pmatch[2].rm_so < pmatch[2].rm_eo) ? 2 : 1;
-				// hack... sizeof(symbol) is TAGSTR_SIZE
-				for (iy=0, ix = pmatch[nsub].rm_so; ix < pmatch[nsub].rm_eo && iy < TAGSTR_SIZE-1; ix++)
-					symbol[iy++] = lx->buff[ix];
-				symbol[iy] = '\0';
-				// "reg1 nsub %d -- %ld %ld symbol [%s]",
-				// nsub, pmatch[nsub].rm_so, pmatch[nsub].rm_eo, symbol);
-				break;
-			}
+	if ((op = openers_update (cnf.ring_curr, &reg1, key)) == NULL) {
+		regfree (&reg1);
+		return 1;
+	}
 
-			lx = lx->prev;
-			lno--;
+	if (action & FILTER_GET_SYMBOL) {
+		i = openers_find (op, CURR_FILE.lineno);
+		if ((symbol != NULL) && i >= 0 && !regexec(&reg1, op->lines[i]->buff, 10, pmatch, 0)) {
+			int ix, iy, nsub;
+			lx = op->lines[i];
+			// maybe 2 subpatterns
+			nsub = (pmatch[2].rm_so >= 0 && pmatch[2].rm_so < pmatch[2].rm_eo) ? 2 : 1;
+			// hack... sizeof(symbol) is TAGSTR_SIZE
+			for (iy=0, ix = pmatch[nsub].rm_so; ix < pmatch[nsub].rm_eo && iy < TAGSTR_SIZE-1; ix++)
+				symbol[iy++] = lx->buff[ix];
+			symbol[iy] = '\0';
+			// "reg1 nsub %d -- %ld %ld symbol [%s]",
+			// nsub, pmatch[nsub].rm_so, pmatch[nsub].rm_eo, symbol);
 		}
 	} else {
-		lx = CURR_FILE.top->next;
-		lno = 1;
-		searching_for_brace = 0;
-		while (TEXT_LINE(lx)) {
-			if (!regexec(&reg1, lx->buff, 10, pmatch, 0)) {
-				if (action & (FILTER_MORE | FILTER_ALL))
-					lx->lflag &= ~fmask;
-				else if (action & FILTER_LESS)
-					lx->lflag |= fmask;
-				searching_for_brace = 1;
-			}
-
-			if (searching_for_brace) {
-				/* opening brace on the header line or later */
-				for (lncol = 0; lncol < lx->llen; lncol++) {
-					if (lx->buff[lncol] == '{')
-						break;
-				}
-				if (lx->buff[lncol] == '{') {
-					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
-					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
-					searching_for_brace = 0;
+		if (action & FILTER_ALL) {
+			/* hide all lines */
+			lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, 1, CURR_FILE.num_lines+1, 1);
+		}
 
-					lx = tomatch_eng (lx, &lno, &lncol, TOMATCH_DONT_SET_FOCUS | PURIFY_OTHER);
-					if (!(TEXT_LINE(lx) && lx->buff[lncol] == '}'))
-						break;
+		/* the header, the opening brace on the header or the next line, the closing brace;
+		 * headers inside the previous block are skipped
+		 */
+		lno = 0;
+		for (i=0; i < op->count; i++) {
+			if (op->linenos[i] <= lno)
+				continue;
+			lx = op->lines[i];
+			lno = op->linenos[i];
+			if (action & (FILTER_MORE | FILTER_ALL))
+				lll_unhide(lx, fmask);
+			else if (action & FILTER_LESS)
+				lll_hide(lx, fmask);
 
-					if (action & (FILTER_MORE | FILTER_ALL))
-						lx->lflag &= ~fmask;
-					else if (action & FILTER_LESS)
-						lx->lflag |= fmask;
-				} else if (++searching_for_brace > 2) {
-					/* checked the header and following line is enough */
-					searching_for_brace = 0;
-				}
+			for (lncol = 0; lncol < lx->llen && lx->buff[lncol] != '{'; lncol++)
+				;
+			if (lx->buff[lncol] != '{' && TEXT_LINE(lx->next)
+			&& !(i+1 < op->count && op->linenos[i+1] == lno+1)) {
+				lx = lx->next;
+				lno++;
+				for (lncol = 0; lncol < lx->llen && lx->buff[lncol] != '{'; lncol++)
+					;
 			}
+			if (lx->buff[lncol] != '{')
+				continue;
 
-			lx = lx->next;
-			lno++;
-		}
-	}
-	regfree (&reg1);
+			if (action & (FILTER_MORE | FILTER_ALL))
+				lll_unhide(lx, fmask);
+			else if (action & FILTER_LESS)
+				lll_hide(lx, fmask);
 
-	return 0;
+			lx = tomatch_eng (lx, &lno, &lncol, TOMATCH_DONT_SET_FOCUS | PURIFY_OTHER);
+			if (!(TEXT_LINE(lx) && lx->buff[lncol] == '}'))
+				break;
+
+			if (action & (FILTER_MORE | FILTER_ALL))
+				lll_unhide(lx, fmask);
+			else if (action & FILTER_LESS)
+				lll_hide(lx, fmask);
+		}
+	}
+	regfree (&reg1);
+
+	return 0;
 }
 
 /* no brace for hierarchy, use the regex pattern for match
@@ -780,9 +1310,12 @@ static int
 filter_func_eng_easy (int action, int fmask, char *symbol)
 {
 	LINE *lx;
+	OPENERS *op;
 	regex_t reg1;
 	const char *expr;
 	regmatch_t pmatch[10];	/* match and sub match */
+	int i;
+	int key = SINFO_KEY(CURR_FILE.ftype);
 
 	if (CURR_FILE.num_lines < 1)
 		return 0;
@@ -797,37 +1330,34 @@ filter_func_eng_easy (int action, int fmask, char *symbol)
 		return 0;
 	}
 
+	if ((op = openers_update (cnf.ring_curr, &reg1, key)) == NULL) {
+		regfree (&reg1);
+		return 1;
+	}
+
 	if (action & FILTER_GET_SYMBOL) {
-		lx = CURR_LINE;
-		while ((symbol != NULL) && TEXT_LINE(lx)) {
-			if (!regexec(&reg1, lx->buff, 10, pmatch, 0)) {
-				int ix, iy, nsub;
-				// even 3 subpatterns
-				nsub = (pmatch[3].rm_so >= 0 && pmatch[2].rm_so < pmatch[3].rm_eo) ? 3 :
-					((pmatch[2].rm_so >= 0 && pmatch[2].rm_so < pmatch[2].rm_eo) ? 2 : 1);
-				// hack... sizeof(symbol) is TAGSTR_SIZE
-				for (iy=0, ix = pmatch[nsub].rm_so; ix < pmatch[nsub].rm_eo && iy < TAGSTR_SIZE-1; ix++)
-					symbol[iy++] = lx->buff[ix];
-				symbol[iy] = '\0';
-				// "reg1 nsub %d -- %ld %ld symbol [%s]",
-				// nsub, pmatch[nsub].rm_so, pmatch[nsub].rm_eo, symbol);
-				break;
-			}
-			lx = lx->prev;
+		i = openers_find (op, CURR_FILE.lineno);
+		if ((symbol != NULL) && i >= 0 && !regexec(&reg1, op->lines[i]->buff, 10, pmatch, 0)) {
+			int ix, iy, nsub;
+			lx = op->lines[i];
+			// even 3 subpatterns
+			nsub = (pmatch[3].rm_so >= 0 && pmatch[2].rm_so < pmatch[3].rm_eo) ? 3 :
+				((pmatch[2].rm_so >= 0 && pmatch[2].rm_so < pmatch[2].rm_eo) ? 2 : 1);
+			// hack... sizeof(symbol) is TAGSTR_SIZE
+			for (iy=0, ix = pmatch[nsub].rm_so; ix < pmatch[nsub].rm_eo && iy < TAGSTR_SIZE-1; ix++)
+				symbol[iy++] = lx->buff[ix];
+			symbol[iy] = '\0';
+			// "reg1 nsub %d -- %ld %ld symbol [%s]",
+			// nsub, pmatch[nsub].rm_so, pmatch[nsub].rm_eo, symbol);
 		}
 	} else {
-		lx = CURR_FILE.top->next;
-		while (TEXT_LINE(lx)) {
-			if (!regexec(&reg1, lx->buff, 10, pmatch, 0)) {
-				if (action & (FILTER_MORE | FILTER_ALL))
-					lx->lflag &= ~fmask;
-				else if (action & FILTER_LESS)
-					lx->lflag |= fmask;
-			} else {
-				if (action & FILTER_ALL)
-					lx->lflag |= fmask;
-			}
-			lx = lx->next;
+		if (action & FILTER_ALL)
+			lll_hide_range(cnf.ring_curr, CURR_FILE.flevel, 1, CURR_FILE.num_lines+1, 1);
+		for (i=0; i < op->count; i++) {
+			if (action & (FILTER_MORE | FILTER_ALL))
+				lll_unhide(op->lines[i], fmask);
+			else if (action & FILTER_LESS)
+				lll_hide(op->lines[i], fmask);
 		}
 	}
 	regfree (&reg1);
@@ -888,6 +1418,309 @@ block_name (int ri)
 	return (symbol);
 } /* block_name */
 
+/*
+** outline - list the function, structure and class headers of the buffer in the *outline* buffer,
+**	the line action jumps to the header; the list is not rebuilt while the buffer does not change
+*/
+int
+outline (void)
+{
+	int ret=0, ri = cnf.ring_curr, oi, count, focus;
+	LINE *lp=NULL;
+	char one_line[FNAMESIZE+20];
+	long long t0 = msec_clock();
+
+	if (CURR_FILE.fflag & (FSTAT_SPECW | FSTAT_SCRATCH)) {
+		tracemsg("outline: not a regular file buffer");
+		return (0);
+	}
+	if (CURR_FILE.ftype == TEXT_FILETYPE) {
+		tracemsg("outline: no function headers in text buffer");
+		return (0);
+	}
+
+	oi = query_scratch_fname ("*outline*");
+	if (oi != -1 && cnf.fdata[oi].num_lines > 0 && outline_ri == ri && outline_gen == cnf.fdata[ri].lgen &&
+	outline_ftype == (int)CURR_FILE.ftype && strncmp(outline_fname, CURR_FILE.fname, FNAMESIZE) == 0)
+	{
+		/* nothing changed since the last run */
+		cnf.ring_curr = oi;
+		CURR_FILE.origin = ri;
+		CURR_FILE.fflag &= ~FSTAT_CMD;
+		return (0);
+	}
+
+	/* open or reopen the special buffer */
+	if ((ret = scratch_buffer("*outline*")) != 0) {
+		return (ret);
+	}
+	/* cnf.ring_curr is set now */
+	if (CURR_FILE.num_lines > 0) {
+		clean_buffer();
+	}
+	CURR_FILE.fflag |= FSTAT_SPECW;
+	CURR_FILE.fflag |= (FSTAT_NOEDIT | FSTAT_NOADDLIN);
+	CURR_FILE.origin = ri;
+
+	/* header
+	*/
+	snprintf(one_line, sizeof(one_line)-1, "$ outline %s\n", cnf.fdata[ri].fname);
+	if ((lp = insert_line_before (CURR_FILE.bottom, one_line)) != NULL) {
+		CURR_FILE.num_lines++;
+	} else {
+		return (2);
+	}
+
+	/* the focus goes to the last header before the focus line of the source */
+	focus = cnf.fdata[ri].lineno;
+	if (cnf.fdata[ri].ftype == C_FILETYPE) {
+		count = outline_clang (ri, &lp, &focus);
+	} else {
+		count = outline_other (ri, &lp, &focus);
+	}
+
+	/* pull and update
+	*/
+	focus = (focus > 0) ? focus + 1 : 1;
+	CURR_LINE = CURR_FILE.top;
+	CURR_FILE.lineno = 0;
+	CURR_LINE = lll_goto_lineno (cnf.ring_curr, focus);
+	CURR_FILE.lineno = focus;
+	update_focus(CENTER_FOCUSLINE, cnf.ring_curr);
+	CURR_FILE.fflag &= ~FSTAT_CMD;
+
+	if (count < 0) {
+		outline_ri = -1;
+		ret = 1;
+	} else {
+		outline_ri = ri;
+		outline_gen = cnf.fdata[ri].lgen;
+		outline_ftype = (int)cnf.fdata[ri].ftype;
+		strncpy(outline_fname, cnf.fdata[ri].fname, FNAMESIZE);
+		outline_fname[FNAMESIZE-1] = '\0';
+		tracemsg("outline: %d headers (%lld ms)", count, msec_clock() - t0);
+	}
+
+	return (ret);
+} /* outline */
+
+/*
+ * add the header line to the *outline* buffer after *lpp, in the "fname:lineno: text" form,
+ * return 0 if ok
+ */
+static int
+outline_line (LINE **lpp, const char *fname, int lineno, const LINE *lx)
+{
+	char one_line[FNAMESIZE+200];
+	int len;
+
+	len = lx->llen;
+	if (len > 0 && lx->buff[len-1] == '\n')
+		len--;
+	if (len > 160)
+		len = 160;
+	snprintf(one_line, sizeof(one_line)-1, "%s:%d: %.*s\n", fname, lineno, len, lx->buff);
+
+	if ((*lpp = append_line (*lpp, one_line)) == NULL)
+		return (1);
+	CURR_FILE.num_lines++;
+
+	return (0);
+} /* outline_line */
+
+/*
+* compile the four C header patterns into regs[], for c_header_test(),
+* return 0 if ok, 1 if regcomp failed
+*/
+int
+c_header_regcomp (regex_t *regs)
+{
+	const char *expr[4] = { C_HEADER_ONE_PATTERN, C_HEADER_TOP_PATTERN,
+		C_STRUCTURE_PATTERN, C_STRUCTURE_4PATTERN };
+	int i, j;
+
+	for (i=0; i < 4; i++) {
+		if (regcomp (&regs[i], expr[i], REGCOMP_OPTION)) {
+			for (j=0; j < i; j++)
+				regfree (&regs[j]);
+			return (1);
+		}
+	}
+	return (0);
+} /* c_header_regcomp */
+
+/*
+* free the regs[] of c_header_regcomp()
+*/
+void
+c_header_regfree (regex_t *regs)
+{
+	int i;
+
+	for (i=0; i < 4; i++)
+		regfree (&regs[i]);
+} /* c_header_regfree */
+
+/*
+* test the line for the header of a C block, the line is above the opening brace or
+* the brace is in the line at lncol (at_brace), pmatch[] shall have 10 items;
+* return 0 if not a header, -1 where the search upwards shall stop,
+* 1 to 4 for the matching pattern (function, top of function, structure, literal assignment),
+* 5 for the typedef of an anonymous structure
+*/
+int
+c_header_test (const char *buff, int llen, int lncol, int at_brace, const regex_t *regs, regmatch_t *pmatch)
+{
+	int n;
+
+	if (!at_brace) {
+		/* blank line, preprocessor line or end of statement, no header here */
+		for (n = llen; n > 0 && (buff[n-1] == '\n' || buff[n-1] == ' ' || buff[n-1] == '\t'); n--)
+			;
+		if (n == 0 || buff[0] == '#' || buff[n-1] == ';' || buff[n-1] == '}')
+			return (-1);
+	}
+	if ((llen > 1) && ((buff[0] == '*') || (buff[0] == ' ' && buff[1] == '*'))) {
+		/* not a function header, maybe a comment */
+		return (0);
+	}
+	if (at_brace && strncmp(buff, "typedef", 7) == 0) {
+		/* anonymous structure */
+		return (5);
+	}
+	if (!regexec(&regs[0], buff, 10, pmatch, 0))
+		return (1);
+	if (!regexec(&regs[1], buff, 10, pmatch, 0))
+		return (2);
+	if ((llen > 5) && (buff[0]=='t' || buff[0]=='s' || buff[0]=='e' || buff[0]=='u') &&
+	!regexec(&regs[2], buff, 10, pmatch, 0)) {
+		/* ^(?:typedef )?(struct|enum|union) */
+		return (3);
+	}
+	if (lncol > 5 &&
+	((buff[lncol-1] == '=') || (buff[lncol-2] == '=' && buff[lncol-1] == ' ')) &&
+	!regexec(&regs[3], buff, 10, pmatch, 0)) {
+		return (4);
+	}
+	return (0);
+} /* c_header_test */
+
+/*
+ * outline of the C source: the top level blocks are taken from the block structure index,
+ * the header is searched upwards from the opening brace like filter_func_eng_clang() does,
+ * return the number of headers, or -1 on failure; io_focus is the lineno in the source on input,
+ * the index of the last header before that on return
+ */
+static int
+outline_clang (int ri, LINE **lpp, int *io_focus)
+{
+	CBLOCKS *cb;
+	LINE *lx;
+	regex_t regs[4];
+	regmatch_t pmatch[10];	/* match and sub match */
+	int i, j, k, li, lncol, prev_end, count, focus, found;
+
+	if (cblocks_update(ri))
+		return (-1);
+	cb = cnf.fdata[ri].cblocks;
+
+	if (c_header_regcomp (regs)) {
+		ERRLOG(0xE0D4);
+		return (-1); /* internal regcomp failed */
+	}
+
+	count = focus = 0;
+	prev_end = 0;
+	for (i=0; i < cb->nbr; i++) {
+		if (cb->br[i].ch != '{')
+			continue;
+		li = cb->br[i].lidx;
+
+		/* the header is above the opening brace, but below the previous block */
+		found = 0;
+		for (k = li; !found && k >= prev_end; k--) {
+			lx = cb->lines[k];
+			lncol = (k == li) ? cb->br[i].col : 0;
+			found = c_header_test (lx->buff, lx->llen, lncol, (k == li), regs, pmatch);
+			if (found < 0)
+				break;
+			if (found) {
+				if (outline_line (lpp, cnf.fdata[ri].fname, k+1, lx)) {
+					count = -1;
+					break;
+				}
+				count++;
+				if (k+1 <= *io_focus)
+					focus = count;
+			}
+		}
+		if (count < 0)
+			break;
+
+		/* skip the nested blocks */
+		j = cb->br[i].pair;
+		if (j > i) {
+			prev_end = cb->br[j].lidx + 1;
+			i = j;
+		} else {
+			prev_end = li + 1;
+		}
+	}
+	c_header_regfree (regs);
+
+	*io_focus = focus;
+	return (count);
+} /* outline_clang */
+
+/*
+ * outline of the Perl, shell or Python source: the header lines from the block opener list,
+ * return the number of headers, or -1 on failure;
+ * io_focus is the same as for outline_clang()
+ */
+static int
+outline_other (int ri, LINE **lpp, int *io_focus)
+{
+	OPENERS *op;
+	regex_t reg1;
+	const char *expr;
+	int i, count, focus;
+	int key = SINFO_KEY(cnf.fdata[ri].ftype);
+
+	if (cnf.fdata[ri].ftype == PERL_FILETYPE) {
+		expr = PERL_HEADER_PATTERN;
+	} else if (cnf.fdata[ri].ftype == SHELL_FILETYPE) {
+		expr = SHELL_HEADER_PATTERN;
+	} else if (cnf.fdata[ri].ftype == PYTHON_FILETYPE) {
+		expr = PYTHON_HEADER_PATTERN;
+	} else {
+		*io_focus = 0;
+		return (0);
+	}
+	if (regcomp (&reg1, expr, REGCOMP_OPTION)) {
+		ERRLOG(0xE0D4);
+		return (-1); /* internal regcomp failed */
+	}
+
+	op = openers_update (ri, &reg1, key);
+	regfree (&reg1);
+	if (op == NULL)
+		return (-1);
+
+	count = focus = 0;
+	for (i=0; i < op->count; i++) {
+		if (outline_line (lpp, cnf.fdata[ri].fname, op->linenos[i], op->lines[i])) {
+			count = -1;
+			break;
+		}
+		count++;
+		if (op->linenos[i] <= *io_focus)
+			focus = count;
+	}
+
+	*io_focus = focus;
+	return (count);
+} /* outline_other */
+
 /* ------------------------------------------------------------------ */
 
 /*
@@ -927,7 +1760,7 @@ filter_expand_up (void)
 
 	if ( HIDDEN_LINE(cnf.ring_curr, CURR_LINE->prev) ) {
 		/* flevel bit is set, clean it */
-		(CURR_LINE->prev)->lflag &= ~LMASK(cnf.ring_curr);
+		lll_unhide(CURR_LINE->prev, LMASK(cnf.ring_curr));
 	}
 	/* prev line visible, go up */
 	CURR_LINE = CURR_LINE->prev;
@@ -951,7 +1784,7 @@ filter_expand_down (void)
 
 	if ( HIDDEN_LINE(cnf.ring_curr, CURR_LINE->next) ) {
 		/* flevel bit is set, clean it */
-		(CURR_LINE->next)->lflag &= ~LMASK(cnf.ring_curr);
+		lll_unhide(CURR_LINE->next, LMASK(cnf.ring_curr));
 	}
 	/* next line visible, go down */
 	CURR_LINE = CURR_LINE->next;
@@ -976,7 +1809,7 @@ filter_restrict (void)
 	}
 
 	/* set hide bit */
-	CURR_LINE->lflag |= LMASK(cnf.ring_curr);
+	lll_hide(CURR_LINE, LMASK(cnf.ring_curr));
 
 	/* skip to next, always */
 	next_lp (cnf.ring_curr, &(CURR_LINE), &cnt);
@@ -1023,7 +1856,6 @@ incr_filter_level (void)
 int
 incr2_filter_level (void)
 {
-	LINE *lx = NULL;
 	int fmask0, fmask1;
 	fmask0 = FMASK(CURR_FILE.flevel);
 
@@ -1040,16 +1872,8 @@ incr2_filter_level (void)
 		} else {
 			CURR_FILE.fflag &= ~fmask1;
 		}
-		lx = CURR_FILE.top->next;
-		while (TEXT_LINE(lx)) {
-			/* copy hide-line status bit */
-			if (lx->lflag & fmask0) {
-				lx->lflag |= fmask1;
-			} else {
-				lx->lflag &= ~fmask1;
-			}
-			lx = lx->next;
-		}
+		/* copy the hide bits */
+		lll_hide_copy(cnf.ring_curr, CURR_FILE.flevel, CURR_FILE.flevel-1);
 		/* keep focus */
 		tracemsg("filter level increased, filter bits copied");
 	}
@@ -1088,7 +1912,6 @@ decr_filter_level (void)
 int
 decr2_filter_level (void)
 {
-	LINE *lx = NULL;
 	int fmask0, fmask1;
 	fmask0 = FMASK(CURR_FILE.flevel);
 
@@ -1105,16 +1928,8 @@ decr2_filter_level (void)
 		} else {
 			CURR_FILE.fflag &= ~fmask1;
 		}
-		lx = CURR_FILE.top->next;
-		while (TEXT_LINE(lx)) {
-			/* copy hide-line status bit */
-			if (lx->lflag & fmask0) {
-				lx->lflag |= fmask1;
-			} else {
-				lx->lflag &= ~fmask1;
-			}
-			lx = lx->next;
-		}
+		/* copy the hide bits */
+		lll_hide_copy(cnf.ring_curr, CURR_FILE.flevel, CURR_FILE.flevel+1);
 		/* keep focus */
 		tracemsg("filter level decreased, filter bits copied");
 	}
@@ -1122,6 +1937,63 @@ decr2_filter_level (void)
 	return (0);
 } /* decr2_filter_level */
 
+/*
+** filter_intersect - keep visible only those lines, which are visible
+**	on the current and on the given filter level also
+*/
+int
+filter_intersect (const char *arg)
+{
+	return (filter_combine (arg, 1));
+} /* filter_intersect */
+
+/*
+** filter_union - make visible those lines, which are visible
+**	on the current or on the given filter level
+*/
+int
+filter_union (const char *arg)
+{
+	return (filter_combine (arg, 0));
+} /* filter_union */
+
+/*
+* combine the hide bits of the given level into the current level, word-wide
+*/
+static int
+filter_combine (const char *arg, int intersect)
+{
+	int level, fmask0, cnt;
+
+	level = atoi(arg);
+	if (level < 1 || FMASK(level) == 0 || level == CURR_FILE.flevel) {
+		tracemsg("filter level must be 1...7, other than the current %d", CURR_FILE.flevel);
+		return (1);
+	}
+	fmask0 = FMASK(CURR_FILE.flevel);
+
+	/* activate filter */
+	CURR_FILE.fflag |= fmask0;
+
+	lll_hide_combine(cnf.ring_curr, CURR_FILE.flevel, level, intersect);
+
+	/* focus line may be hidden */
+	if (HIDDEN_LINE(cnf.ring_curr,CURR_LINE)) {
+		next_lp (cnf.ring_curr, &(CURR_LINE), &cnt);
+		CURR_FILE.lineno += cnt;
+		if (!TEXT_LINE(CURR_LINE)) {
+			prev_lp (cnf.ring_curr, &(CURR_LINE), &cnt);
+			CURR_FILE.lineno -= cnt;
+		}
+		CURR_FILE.lncol = get_col(CURR_LINE, CURR_FILE.curpos);
+	}
+	update_focus(FOCUS_AVOID_BORDER, cnf.ring_curr);
+	tracemsg("filter level %d %s level %d", CURR_FILE.flevel,
+		(intersect ? "intersected with" : "united with"), level);
+
+	return (0);
+} /* filter_combine */
+
 /* ------------------------------------------------------------------ */
 
 /* re-allocate space for common tasks, never less
@@ -1180,6 +2052,305 @@ tomatch (void)
 	return (0);
 } /* tomatch */
 
+/*
+** lcache_drop - free the line cache of the buffer
+*/
+void
+lcache_drop (int ri)
+{
+	LCACHES *lc = cnf.fdata[ri].lcache;
+	int i;
+
+	if (lc != NULL) {
+		for (i=0; i < lc->size; i++) {
+			FREE(lc->tab[i].skel);
+		}
+		FREE(lc->tab);
+		FREE(lc);
+		cnf.fdata[ri].lcache = NULL;
+	}
+} /* lcache_drop */
+
+/*
+ * the slot of the line in the line cache of the buffer, a free slot is taken for the line
+ * with nothing cached; the table grows with the buffer, and it is emptied if the removed
+ * lines fill it up; return NULL on failure
+ */
+static LCACHE *
+lcache_slot (int ri, const LINE *lp)
+{
+	LCACHES *lc = cnf.fdata[ri].lcache;
+	LCACHE *tab;
+	unsigned h, mask;
+	int i, size;
+
+	if (lc == NULL) {
+		if ((lc = (LCACHES *) MALLOC(sizeof(LCACHES))) == NULL) {
+			ERRLOG(0xE0D3);
+			return (NULL);
+		}
+		memset(lc, 0, sizeof(LCACHES));
+		cnf.fdata[ri].lcache = lc;
+	}
+
+	if (2 * (lc->count + 1) > lc->size) {
+		size = (lc->size == 0) ? 1024 : lc->size;
+		if (lc->size == 0 || size < 4 * (cnf.fdata[ri].num_lines + 1)) {
+			/* grow and rehash */
+			if (lc->size != 0)
+				size *= 2;
+			if ((tab = (LCACHE *) MALLOC(sizeof(LCACHE) * (size_t)size)) == NULL) {
+				ERRLOG(0xE0D3);
+				return (NULL);
+			}
+			memset(tab, 0, sizeof(LCACHE) * (size_t)size);
+			mask = (unsigned)size - 1;
+			for (i=0; i < lc->size; i++) {
+				if (lc->tab[i].lp == NULL)
+					continue;
+				for (h = LCACHE_HASH(lc->tab[i].lp) & mask; tab[h].lp != NULL; h = (h+1) & mask)
+					;
+				tab[h] = lc->tab[i];
+			}
+			FREE(lc->tab);
+			lc->tab = tab;
+			lc->size = size;
+		} else {
+			/* mostly removed lines, start again */
+			for (i=0; i < lc->size; i++) {
+				FREE(lc->tab[i].skel);
+			}
+			memset(lc->tab, 0, sizeof(LCACHE) * (size_t)lc->size);
+			lc->count = 0;
+		}
+	}
+
+	mask = (unsigned)lc->size - 1;
+	for (h = LCACHE_HASH(lp) & mask; lc->tab[h].lp != NULL && lc->tab[h].lp != lp; h = (h+1) & mask)
+		;
+	if (lc->tab[h].lp == NULL) {
+		lc->tab[h].lp = lp;
+		lc->count++;
+	}
+	return (&lc->tab[h]);
+}
+
+/*
+ * bracket skeleton of the line: the block characters of the purified line with
+ * their positions, cached in the line cache of the buffer until the line content changes;
+ * return NULL on failure
+ */
+static const int *
+line_skeleton (int ri, const LINE *lp, int kind)
+{
+	LCACHE *ls;
+	int *skel;
+	int n, col;
+	char ch;
+	const char *blockchars = "(){}[]<>";
+
+	if ((ls = lcache_slot (ri, lp)) == NULL)
+		return (NULL);
+	if (ls->pgen == lp->lgen && ls->skel != NULL && SKEL_KIND(ls->skel[0]) == kind)
+		return (ls->skel);
+
+	if (common_space(lp->llen))
+		return (NULL);
+	if (kind & PURIFY_CLANG)
+		purify_for_matching_clang (cnf.temp_buffer, lp->buff, lp->llen);
+	else
+		purify_for_matching_other (cnf.temp_buffer, lp->buff, lp->llen);
+
+	n = 0;
+	for (col=0; col < lp->llen-1 && (ch = cnf.temp_buffer[col]) != '\0'; col++) {
+		if (strchr(blockchars, ch) != NULL)
+			n++;
+	}
+	skel = (int *) REALLOC((void *)ls->skel, sizeof(int) * (size_t)(n+1));
+	if (skel == NULL) {
+		ERRLOG(0xE0D3);
+		ls->pgen = 0;
+		return (NULL);
+	}
+	skel[0] = SKEL_HEADER(n, kind);
+	n = 0;
+	for (col=0; col < lp->llen-1 && (ch = cnf.temp_buffer[col]) != '\0'; col++) {
+		if (strchr(blockchars, ch) != NULL)
+			skel[++n] = SKEL_ENTRY(col, ch);
+	}
+	ls->pgen = lp->lgen;
+	ls->skel = skel;
+
+	return (skel);
+} /* line_skeleton */
+
+/*
+** cblocks_drop - free the block structure index of the buffer
+*/
+void
+cblocks_drop (int ri)
+{
+	CBLOCKS *cb = cnf.fdata[ri].cblocks;
+
+	if (cb != NULL) {
+		FREE(cb->lines);
+		FREE(cb->lgens);
+		FREE(cb->first_br);
+		FREE(cb->br);
+		FREE(cb);
+		cnf.fdata[ri].cblocks = NULL;
+	}
+} /* cblocks_drop */
+
+/*
+ * bring the block structure index of the C source up to date: lines before the first
+ * changed line are kept, the rest is taken from the line skeletons again, then the block
+ * characters are paired per type; return 0 if ok, 1 on failure
+ */
+static int
+cblocks_update (int ri)
+{
+	CBLOCKS *cb;
+	LINE *lx;
+	void *ptr;
+	int *stk;
+	const int *skel;
+	int k, n, i, j, sp, size;
+	char ch;
+	const char *open_close = "{}()[]";
+
+	cb = cnf.fdata[ri].cblocks;
+	if (cb == NULL) {
+		if ((cb = (CBLOCKS *) MALLOC(sizeof(CBLOCKS))) == NULL) {
+			ERRLOG(0xE0D1);
+			return (1);
+		}
+		memset(cb, 0, sizeof(CBLOCKS));
+		cnf.fdata[ri].cblocks = cb;
+	} else if (cb->line_gen == cnf.fdata[ri].lgen) {
+		return (0);
+	}
+
+	/* the first changed line */
+	k = 0;
+	lx = cnf.fdata[ri].top->next;
+	while (k < cb->nlines && TEXT_LINE(lx) && cb->lines[k] == lx && cb->lgens[k] == lx->lgen) {
+		k++;
+		lx = lx->next;
+	}
+
+	/* rescan from there downwards */
+	n = k;
+	cb->nbr = (k > 0) ? cb->first_br[k] : 0;
+	while (TEXT_LINE(lx)) {
+		if (n+2 > cb->lines_size) {
+			size = cb->lines_size * 2 + 1024;
+			if ((ptr = REALLOC((void *)cb->lines, sizeof(LINE *) * (size_t)size)) == NULL)
+				break;
+			cb->lines = (LINE **) ptr;
+			if ((ptr = REALLOC((void *)cb->lgens, sizeof(unsigned) * (size_t)size)) == NULL)
+				break;
+			cb->lgens = (unsigned *) ptr;
+			if ((ptr = REALLOC((void *)cb->first_br, sizeof(int) * (size_t)size)) == NULL)
+				break;
+			cb->first_br = (int *) ptr;
+			cb->lines_size = size;
+		}
+		if ((skel = line_skeleton (ri, lx, PURIFY_CLANG)) == NULL)
+			break;
+
+		cb->lines[n] = lx;
+		cb->lgens[n] = lx->lgen;
+		cb->first_br[n] = cb->nbr;
+		for (j=1; j <= SKEL_COUNT(skel[0]); j++) {
+			ch = SKEL_CH(skel[j]);
+			if (strchr(open_close, ch) == NULL)
+				continue;
+			if (cb->nbr >= cb->br_size) {
+				size = cb->br_size * 2 + 1024;
+				if ((ptr = REALLOC((void *)cb->br, sizeof(CBRACKET) * (size_t)size)) == NULL)
+					break;
+				cb->br = (CBRACKET *) ptr;
+				cb->br_size = size;
+			}
+			cb->br[cb->nbr].lidx = n;
+			cb->br[cb->nbr].col = SKEL_COL(skel[j]);
+			cb->br[cb->nbr].pair = -1;
+			cb->br[cb->nbr].ch = ch;
+			cb->nbr++;
+		}
+		if (j <= SKEL_COUNT(skel[0]))
+			break;
+		n++;
+		lx = lx->next;
+	}
+	if (TEXT_LINE(lx)) {
+		ERRLOG(0xE0D1);
+		cblocks_drop(ri);
+		return (1);
+	}
+	cb->nlines = n;
+	cb->first_br[n] = cb->nbr;
+
+	/* pair the block characters, separately for each type like tomatch_eng() does */
+	if ((stk = (int *) MALLOC(sizeof(int) * (size_t)(cb->nbr + 1))) == NULL) {
+		ERRLOG(0xE0D1);
+		cblocks_drop(ri);
+		return (1);
+	}
+	for (i=0; i < cb->nbr; i++)
+		cb->br[i].pair = -1;
+	for (k=0; open_close[k] != '\0'; k += 2) {
+		sp = 0;
+		for (i=0; i < cb->nbr; i++) {
+			if (cb->br[i].ch == open_close[k]) {
+				stk[sp++] = i;
+			} else if (cb->br[i].ch == open_close[k+1] && sp > 0) {
+				sp--;
+				cb->br[i].pair = stk[sp];
+				cb->br[stk[sp]].pair = i;
+			}
+		}
+	}
+	FREE(stk);
+
+	cb->line_gen = cnf.fdata[ri].lgen;
+	return (0);
+} /* cblocks_update */
+
+/*
+ * lookup the matching block character in the index,
+ * return 0 if found (and set the line, lineno, lncol), 1 if there is no match,
+ * 2 if the index cannot be used here
+ */
+static int
+cblocks_match (int ri, LINE **io_lp, int *io_lineno, int *io_lncol)
+{
+	CBLOCKS *cb;
+	int li, i, j;
+
+	if (cblocks_update(ri))
+		return (2);
+	cb = cnf.fdata[ri].cblocks;
+
+	li = *io_lineno - 1;
+	if (li < 0 || li >= cb->nlines || cb->lines[li] != *io_lp)
+		return (2);
+	for (i = cb->first_br[li]; i < cb->first_br[li+1]; i++) {
+		if (cb->br[i].col == *io_lncol)
+			break;
+	}
+	if (i == cb->first_br[li+1])
+		return (2);	/* not a block character in the purified line */
+	if ((j = cb->br[i].pair) < 0)
+		return (1);
+
+	*io_lp = cb->lines[cb->br[j].lidx];
+	*io_lineno = cb->br[j].lidx + 1;
+	*io_lncol = cb->br[j].col;
+	return (0);
+} /* cblocks_match */
+
 /*
 * tomatch_eng - (engine) go to the matching block character, skip char constants
 *	return the new line pointer (or NULL if anything failed) and set lineno, lncol
@@ -1192,7 +2363,8 @@ tomatch_eng (LINE *lp, int *io_lineno, int *io_lncol, int config_bits)
 	int fcnt, found;
 	char chcur, tofind, dir, delim, ch;
 	int fallback = !(config_bits & TOMATCH_WITH_PURIFY);
-	char *tmpbuff;
+	const int *skel;
+	int i;
 
 	/* initializing */
 	lineno = *io_lineno;
@@ -1219,33 +2391,65 @@ tomatch_eng (LINE *lp, int *io_lineno, int *io_lncol, int config_bits)
 		return (NULL);
 	}
 
+	/* C source without hidden lines, lookup in the block structure index */
+	if ((config_bits & PURIFY_CLANG) && chcur != '<' && chcur != '>' && LMASK(cnf.ring_curr) == 0) {
+		ret_lp = lp;
+		switch (cblocks_match (cnf.ring_curr, &ret_lp, &lineno, &lncol))
+		{
+		case 0:
+			if (config_bits & TOMATCH_SET_FOCUS) {
+				CURR_FILE.focus += lineno - *io_lineno;
+				if (CURR_FILE.focus < 0)
+					CURR_FILE.focus = 0;
+				else if (CURR_FILE.focus > TEXTROWS-1)
+					CURR_FILE.focus = TEXTROWS-1;
+				update_focus(FOCUS_AVOID_BORDER, cnf.ring_curr);
+			}
+			*io_lineno = lineno;
+			*io_lncol = lncol;
+			return (ret_lp);
+		case 1:
+			return (NULL);
+		default:
+			ret_lp = NULL;	/* go on with the scan */
+			break;
+		}
+	}
+
 	/* run to match */
 	if (dir == 1)
 	{
 		lncol++;	/* initial skip */
 		delim++;
 		while (TEXT_LINE(lp)) {
-			if (!fallback && !common_space(lp->llen)) {
-				tmpbuff = cnf.temp_buffer;
-				if (config_bits & PURIFY_CLANG)
-					purify_for_matching_clang (tmpbuff, lp->buff, lp->llen);
-				else
-					purify_for_matching_other (tmpbuff, lp->buff, lp->llen);
+			if (!fallback && (skel = line_skeleton (cnf.ring_curr, lp, config_bits & TOMATCH_WITH_PURIFY)) != NULL) {
+				/* search the block characters of the purified line */
+				for (i=1; i <= SKEL_COUNT(skel[0]); i++) {
+					if (SKEL_COL(skel[i]) < lncol)
+						continue;
+					ch = SKEL_CH(skel[i]);
+					if (ch == chcur) {
+						++delim;
+					} else if (ch == tofind && --delim == 0) {
+						lncol = SKEL_COL(skel[i]);
+						found=1;
+						break;
+					}
+				}
 			} else {
-				tmpbuff = lp->buff; /* failure */
-				fallback = 2;
-			}
-
-			/* search in this line (skip 0x0a) */
-			while (lncol < lp->llen-1) {
-				ch = tmpbuff[lncol];
-				if (ch == chcur) {
-					++delim;
-				} else if (ch == tofind && --delim == 0) {
-					found=1;
-					break;
+				fallback = 2; /* failure */
+
+				/* search in this line (skip 0x0a) */
+				while (lncol < lp->llen-1) {
+					ch = lp->buff[lncol];
+					if (ch == chcur) {
+						++delim;
+					} else if (ch == tofind && --delim == 0) {
+						found=1;
+						break;
+					}
+					lncol++;
 				}
-				lncol++;
 			}
 			if (found)
 				break;
@@ -1264,27 +2468,34 @@ tomatch_eng (LINE *lp, int *io_lineno, int *io_lncol, int config_bits)
 		lncol--;	/* initial skip */
 		delim++;
 		while (TEXT_LINE(lp)) {
-			if (!fallback && !common_space(lp->llen)) {
-				tmpbuff = cnf.temp_buffer;
-				if (config_bits & PURIFY_CLANG)
-					purify_for_matching_clang (tmpbuff, lp->buff, lp->llen);
-				else
-					purify_for_matching_other (tmpbuff, lp->buff, lp->llen);
+			if (!fallback && (skel = line_skeleton (cnf.ring_curr, lp, config_bits & TOMATCH_WITH_PURIFY)) != NULL) {
+				/* search the block characters of the purified line */
+				for (i = SKEL_COUNT(skel[0]); i >= 1; i--) {
+					if (SKEL_COL(skel[i]) > lncol)
+						continue;
+					ch = SKEL_CH(skel[i]);
+					if (ch == chcur) {
+						++delim;
+					} else if (ch == tofind && --delim == 0) {
+						lncol = SKEL_COL(skel[i]);
+						found=1;
+						break;
+					}
+				}
 			} else {
-				tmpbuff = lp->buff; /* failure */
-				fallback = 2;
-			}
-
-			/* search in this line */
-			while (lncol >= 0) {
-				ch = tmpbuff[lncol];
-				if (ch == chcur) {
-					++delim;
-				} else if (ch == tofind && --delim == 0) {
-					found=1;
-					break;
+				fallback = 2; /* failure */
+
+				/* search in this line */
+				while (lncol >= 0) {
+					ch = lp->buff[lncol];
+					if (ch == chcur) {
+						++delim;
+					} else if (ch == tofind && --delim == 0) {
+						found=1;
+						break;
+					}
+					lncol--;
 				}
-				lncol--;
 			}
 			if (found)
 				break;
@@ -1353,7 +2564,7 @@ forcematch (void)
 
 	if (lp != NULL) {
 		/* unhide */
-		lp->lflag &= ~fmask;
+		lll_unhide(lp, fmask);
 
 		CURR_LINE = lp;
 		CURR_FILE.lineno = lineno;
@@ -1407,16 +2618,19 @@ fold_block (void)
 			/* increase to come back */
 
 			/* unhide if one of the lines is hidden: first, first/next, current/prev */
-			if ( (lp->lflag & fmask) ||
-			((lp->next) && ((lp->next)->lflag & fmask)) ||
-			((CURR_LINE->prev)->lflag & fmask) )
+			if ( lll_hidden(lp, fmask) ||
+			((lp->next) && lll_hidden(lp->next, fmask)) ||
+			lll_hidden(CURR_LINE->prev, fmask) )
 				do_unhide = 1;
-			lp->lflag &= ~fmask;	/* unhide target, unconditionally */
+			lll_unhide(lp, fmask);	/* unhide target, unconditionally */
 
 			lp = lp->next;
 			lineno++;
 			while (TEXT_LINE(lp) && lineno < CURR_FILE.lineno) {
-				lp->lflag = (do_unhide) ? (lp->lflag & ~fmask) : (lp->lflag | fmask);
+				if (do_unhide)
+					lll_unhide(lp, fmask);
+				else
+					lll_hide(lp, fmask);
 				lp = lp->next;
 				lineno++;
 			}
@@ -1424,16 +2638,19 @@ fold_block (void)
 			/* decrease to come back */
 
 			/* unhide if one of the lines is hidden: last, last/prev, current/next */
-			if ( (lp->lflag & fmask) ||
-			((lp->prev) && ((lp->prev)->lflag & fmask)) ||
-			((CURR_LINE->next)->lflag & fmask) )
+			if ( lll_hidden(lp, fmask) ||
+			((lp->prev) && lll_hidden(lp->prev, fmask)) ||
+			lll_hidden(CURR_LINE->next, fmask) )
 				do_unhide = 1;
-			lp->lflag &= ~fmask;	/* unhide target, unconditionally */
+			lll_unhide(lp, fmask);	/* unhide target, unconditionally */
 
 			lp = lp->prev;
 			lineno--;
 			while (TEXT_LINE(lp) && lineno > CURR_FILE.lineno) {
-				lp->lflag = (do_unhide) ? (lp->lflag & ~fmask) : (lp->lflag | fmask);
+				if (do_unhide)
+					lll_unhide(lp, fmask);
+				else
+					lll_hide(lp, fmask);
 				lp = lp->prev;
 				lineno--;
 			}
@@ -1460,12 +2677,16 @@ fold_thisfunc (void)
 	LINE *lx=NULL;
 	int lineno, lncol;
 	int fmask=0;
-	int mask_active=0, do_unhide=0;
-	int hidden_to_end=0, hidden_to_head=0;
+	int mask_active=0;
+	int hidden_to_end=0;
 
 	fmask = FMASK(CURR_FILE.flevel);
 	mask_active = (LMASK(cnf.ring_curr) != 0);
 
+	/* no braces, the block is given by the indentation */
+	if (CURR_FILE.ftype == PYTHON_FILETYPE)
+		return (fold_indent_block (fmask));
+
 	/* try to find block end... */
 	lx = CURR_LINE;
 	lineno = CURR_FILE.lineno;
@@ -1475,7 +2696,7 @@ fold_thisfunc (void)
 			break;
 		lx = lx->next;
 		lineno++;
-		if (lx->lflag & fmask) hidden_to_end++;
+		if (lll_hidden(lx, fmask)) hidden_to_end++;
 	}
 	if (!TEXT_LINE(lx))
 		return (1);	/* block end not found */
@@ -1508,36 +2729,123 @@ fold_thisfunc (void)
 	if (mask_active)
 		CURR_FILE.fflag |= fmask;
 
+	return (fold_lines (lp_head, lp_end, hidden_to_end, fmask, 0));
+} /* fold_thisfunc */
+
+/*
+ * fold block content between lp_head and lp_end, the focus line is in the block;
+ * show header and footer lines first, change content visibility othervise;
+ * with_end if lp_end is the last content line, not a footer
+ */
+static int
+fold_lines (LINE *lp_head, LINE *lp_end, int hidden_to_end, int fmask, int with_end)
+{
+	LINE *lx=NULL, *lp_stop=NULL;
+	int do_unhide=0, hidden_to_head=0;
+
 	lx = lp_head;
 	while (TEXT_LINE(lx)) {
 		if (lx == CURR_LINE) {
 			break;
 		}
 		lx = lx->next;
-		if (lx->lflag & fmask) hidden_to_head++;
+		if (lll_hidden(lx, fmask)) hidden_to_head++;
 	}
 
-	if (((lp_head->lflag & fmask)==0) && ((lp_end->lflag & fmask)==0)) {
+	if ((lll_hidden(lp_head, fmask)==0) && (with_end || lll_hidden(lp_end, fmask)==0)) {
 		/* header and footer is visible, change internal lines */
 
 		do_unhide = (hidden_to_end + hidden_to_head > 0);
 
+		lp_stop = (with_end) ? lp_end->next : lp_end;
 		lx = lp_head->next;
-		while (TEXT_LINE(lx) && lx != lp_end) {
-			lx->lflag = (do_unhide) ?
-				(lx->lflag & ~fmask) : (lx->lflag | fmask);
+		while (TEXT_LINE(lx) && lx != lp_stop) {
+			if (do_unhide)
+				lll_unhide(lx, fmask);
+			else
+				lll_hide(lx, fmask);
 			lx = lx->next;
 		}
 	}
 
-	lp_head->lflag &= ~fmask;
+	lll_unhide(lp_head, fmask);
 	if (lp_head->prev)
-		(lp_head->prev)->lflag &= ~fmask;
+		lll_unhide(lp_head->prev, fmask);
 
-	lp_end->lflag &= ~fmask;
+	if (!with_end)
+		lll_unhide(lp_end, fmask);
 
-	CURR_LINE->lflag &= ~fmask;
+	lll_unhide(CURR_LINE, fmask);
 
 	/* current lineno/focus/lncol does not change */
 	return (0);
-} /* fold_thisfunc */
+} /* fold_lines */
+
+/*
+ * fold the indented block around the focus line, for sources without block characters;
+ * the header is the nearest block opener above with smaller indentation, the block lasts
+ * until the next non-blank line with the same or smaller indentation than the header
+ */
+static int
+fold_indent_block (int fmask)
+{
+	LINE *lx, *lp_head, *lp_end;
+	regex_t reg1;
+	int key, info, head_info=0, indent, in_block, hidden_to_end=0;
+
+	if (regcomp (&reg1, PYTHON_HEADER_PATTERN, REGCOMP_OPTION)) {
+		ERRLOG(0xE0D2);
+		return (1);
+	}
+	key = SINFO_KEY(CURR_FILE.ftype);
+
+	/* header: up from the focus line, blank lines do not count */
+	lp_head = NULL;
+	indent = SINFO_INDENT + 1;
+	for (lx = CURR_LINE; TEXT_LINE(lx); lx = lx->prev) {
+		info = line_sinfo (cnf.ring_curr, lx, &reg1, key);
+		if (info & SINFO_BLANK)
+			continue;
+		if ((info & SINFO_HEADER) && (lx == CURR_LINE || (info & SINFO_INDENT) < indent)) {
+			lp_head = lx;
+			head_info = info;
+			break;
+		}
+		if ((info & SINFO_INDENT) < indent)
+			indent = info & SINFO_INDENT;
+	}
+	if (lp_head == NULL) {
+		regfree (&reg1);
+		return (1);	/* not in a block */
+	}
+
+	/* block end: the last non-blank line with deeper indentation */
+	indent = head_info & SINFO_INDENT;
+	lp_end = lp_head;
+	for (lx = lp_head->next; TEXT_LINE(lx); lx = lx->next) {
+		info = line_sinfo (cnf.ring_curr, lx, &reg1, key);
+		if (info & SINFO_BLANK)
+			continue;
+		if ((info & SINFO_INDENT) <= indent)
+			break;
+		lp_end = lx;
+	}
+	regfree (&reg1);
+	if (lp_end == lp_head)
+		return (1);	/* empty block */
+
+	/* the focus line must be in the block, count hidden lines after it */
+	in_block = 0;
+	for (lx = lp_head; TEXT_LINE(lx); lx = lx->next) {
+		if (in_block && lll_hidden(lx, fmask))
+			hidden_to_end++;
+		if (lx == CURR_LINE)
+			in_block = 1;
+		if (lx == lp_end)
+			break;
+	}
+	if (!in_block)
+		return (1);	/* trailing blank line */
+
+	return (fold_lines (lp_head, lp_end, hidden_to_end, fmask, 1));
+} /* fold_indent_block */
@@ -22,12 +22,39 @@
 
 #include <config.h>
 #include <stdlib.h>	/* malloc, realloc, free */
+#include <string.h>	/* memmove, memset, memcpy */
 #include "main.h"
 #include "proto.h"
 
 /* global config */
 extern CONFIG cnf;
 
+/* the buffer of the line, the current one if the line is not indexed */
+#define LINE_RI(lp)	( ((lp) != NULL && (lp)->lri != 0) ? (int)(lp)->lri - 1 : cnf.ring_curr )
+
+/* hide bitsets */
+#define LIDX_WBITS	((int)(8 * sizeof(unsigned long)))
+#define LIDX_WORDS(n)	( ((size_t)(n) + (size_t)LIDX_WBITS - 1) / (size_t)LIDX_WBITS )
+#define BIT_GET(w,i)	( ((w)[(i) / LIDX_WBITS] >> ((i) % LIDX_WBITS)) & 1UL )
+#define BIT_SET(w,i)	( (w)[(i) / LIDX_WBITS] |= (1UL << ((i) % LIDX_WBITS)) )
+#define BIT_CLR(w,i)	( (w)[(i) / LIDX_WBITS] &= ~(1UL << ((i) % LIDX_WBITS)) )
+/* slot of the ordinal and ordinal of the slot */
+#define LIDX_SLOT(li,ord)	( ((ord) < (li)->gap) ? (ord) : (ord) + (li)->gaplen )
+#define LIDX_ORD(li,slot)	( ((slot) < (li)->gap) ? (slot) : (slot) - (li)->gaplen )
+#define LIDX_COUNT(li)		( (li)->size - (li)->gaplen )
+
+/* local proto */
+static LINDEX *lidx_of (const LINE *lp);
+static int lidx_grow (LINDEX *li);
+static void lidx_move_slots (LINDEX *li, int from, int to, int n);
+static void lidx_gap_move (LINDEX *li, int ord);
+static int lidx_insert (LINE *lp, int ri, int ord);
+static void lidx_remove (LINE *lp);
+static int bits_find (const unsigned long *w, int from, int to, int hidden);
+static int bits_rfind (const unsigned long *w, int from, int to, int hidden);
+static void bits_fill (unsigned long *w, int from, int to, int hidden);
+static unsigned long *lidx_level (LINDEX *li, int level);
+
 /*
  * add new element (after line_p if not NULL)
  * return with the pointer to this element
@@ -42,6 +69,8 @@ lll_add (LINE *line_p)
 		ERRLOG(0xE02C);
 		return NULL;
 	}
+	line_next->lidx = 0;
+	line_next->lri = 0;
 	if (line_p == NULL) {
 		/* root of chain */
 		line_next->next = NULL;
@@ -49,6 +78,7 @@ lll_add (LINE *line_p)
 		line_next->buff = NULL;
 		line_next->llen = 0;
 		line_next->lflag = 0;
+		line_next->lgen = ++cnf.line_gen;
 	} else {
 		/* bind-in after line_p */
 		line_next->next = line_p->next;	/*save*/
@@ -59,7 +89,13 @@ lll_add (LINE *line_p)
 		line_next->buff = NULL;
 		line_next->llen = 0;
 		line_next->lflag = 0;
+		line_next->lgen = ++cnf.line_gen;
+		if (lidx_of(line_p) != NULL && lidx_insert(line_next, LINE_RI(line_p), lll_lineno(line_p)+1)) {
+			lll_rm(line_next);
+			return NULL;
+		}
 	}
+	LINES_CHANGED(LINE_RI(line_p));
 
 	return line_next;
 }
@@ -91,6 +127,14 @@ lll_add_before (LINE *line_p)
 		line_prev->buff = NULL;
 		line_prev->llen = 0;
 		line_prev->lflag = 0;
+		line_prev->lidx = 0;
+		line_prev->lri = 0;
+		line_prev->lgen = ++cnf.line_gen;
+		if (lidx_of(line_p) != NULL && lidx_insert(line_prev, LINE_RI(line_p), lll_lineno(line_p))) {
+			lll_rm(line_prev);
+			return NULL;
+		}
+		LINES_CHANGED(LINE_RI(line_p));
 	}
 
 	return line_prev;
@@ -107,8 +151,12 @@ lll_rm (LINE *line_p)
 
 	if (line_p == NULL) {
 		return (NULL);
+	}
+	cnf.line_gen++;		/* line chain changed */
+	LINES_CHANGED(LINE_RI(line_p));
+	lidx_remove(line_p);
 
-	} else if (line_p->next != NULL) {
+	if (line_p->next != NULL) {
 		line_x = line_p->next;		/* save to return */
 		line_x->prev = line_p->prev;
 		if (line_x->prev != NULL)
@@ -134,7 +182,7 @@ lll_rm (LINE *line_p)
 }
 
 /*
- * move lp_src after lp_trg
+ * move lp_src after lp_trg, the hide bits go with the line
  * return with the pointer to this element (lp_src becomes lp_trg->next)
  * or NULL on error
  */
@@ -142,9 +190,15 @@ LINE *
 lll_mv (LINE *lp_src, LINE *lp_trg)
 {
 	LINE *line_x;
+	int hbits;
 
 	if (lp_src == NULL || lp_trg == NULL)
 		return (NULL);
+	cnf.line_gen++;		/* line chain changed */
+	LINES_CHANGED(LINE_RI(lp_src));
+	LINES_CHANGED(LINE_RI(lp_trg));
+	hbits = lll_hide_get(lp_src);
+	lidx_remove(lp_src);
 
 	/* link-out element */
 	if (lp_src->next != NULL) {
@@ -167,11 +221,14 @@ lll_mv (LINE *lp_src, LINE *lp_trg)
 	if (lp_src->next != NULL)
 		(lp_src->next)->prev = lp_src;
 
+	if (lidx_of(lp_trg) != NULL && lidx_insert(lp_src, LINE_RI(lp_trg), lll_lineno(lp_trg)+1) == 0)
+		lll_hide_put(lp_src, hbits);
+
 	return (lp_src);
 }
 
 /*
- * move lp_src before lp_trg
+ * move lp_src before lp_trg, the hide bits go with the line
  * return with the pointer to this element (lp_src becomes lp_trg->prev)
  * or NULL on error
  */
@@ -179,9 +236,15 @@ LINE *
 lll_mv_before (LINE *lp_src, LINE *lp_trg)
 {
 	LINE *line_x;
+	int hbits;
 
 	if (lp_src == NULL || lp_trg == NULL)
 		return (NULL);
+	cnf.line_gen++;		/* line chain changed */
+	LINES_CHANGED(LINE_RI(lp_src));
+	LINES_CHANGED(LINE_RI(lp_trg));
+	hbits = lll_hide_get(lp_src);
+	lidx_remove(lp_src);
 
 	/* link-out element */
 	if (lp_src->next != NULL) {
@@ -204,19 +267,21 @@ lll_mv_before (LINE *lp_src, LINE *lp_trg)
 	if (lp_src->prev != NULL)
 		(lp_src->prev)->next = lp_src;
 
+	if (lidx_of(lp_trg) != NULL && lidx_insert(lp_src, LINE_RI(lp_trg), lll_lineno(lp_trg)) == 0)
+		lll_hide_put(lp_src, hbits);
+
 	return (lp_src);
 }
 
 /*
  * go to absolute line number (counter start with 1, TOP is 0, BOTTOM is num_lines+1)
- * return with the pointer to this element or NULL if out of range
- * (optimized for speed)
+ * return with the pointer to this element or NULL if out of range,
+ * the line index gives the slot
  */
 LINE *
 lll_goto_lineno (int ri, int lineno)
 {
-	int cnt=0;
-	LINE *lp=NULL;
+	const LINDEX *li;
 
 	if (ri < 0 || ri >= RINGSIZE || !(cnf.fdata[ri].fflag & FSTAT_OPEN))
 		return NULL;
@@ -234,43 +299,600 @@ lll_goto_lineno (int ri, int lineno)
 		return (cnf.fdata[ri].curr_line);
 	}
 
-	/* loop stops if lp is top or bottom
-	*/
-	if (lineno < cnf.fdata[ri].lineno) {
-		/* target between top and curr_line */
-		if (lineno < cnf.fdata[ri].lineno - lineno) {
-			/* top: increment */
-			lp = cnf.fdata[ri].top->next;
-			cnt = 1;
-			for (; cnt<lineno && TEXT_LINE(lp); cnt++) {
-				lp = lp->next;
+	li = cnf.fdata[ri].lindex;
+	if (li == NULL || lineno >= LIDX_COUNT(li))
+		return NULL;
+	return (li->slots[LIDX_SLOT(li, lineno)]);
+}
+
+/*
+ * the buffer of the line, the current buffer if the line is not indexed
+ */
+int
+lll_ri (const LINE *lp)
+{
+	return (LINE_RI(lp));
+}
+
+/*
+ * line number of the line in its buffer (TOP is 0, BOTTOM is num_lines+1),
+ * or -1 if the line is not indexed
+ */
+int
+lll_lineno (const LINE *lp)
+{
+	const LINDEX *li = lidx_of(lp);
+
+	if (li == NULL)
+		return (-1);
+	return (LIDX_ORD(li, (int)lp->lidx));
+}
+
+/*
+ * create the line index of the buffer with the top line, the lines added after it
+ * go into the index; return 0 if ok, 1 on malloc failure
+ */
+int
+lll_index_init (int ri, LINE *top)
+{
+	LINDEX *li;
+
+	lll_index_drop(ri);
+	if ((li = (LINDEX *) MALLOC(sizeof(LINDEX))) == NULL) {
+		ERRLOG(0xE0E1);
+		return (1);
+	}
+	memset(li, 0, sizeof(LINDEX));
+	li->size = 1024;
+	if ((li->slots = (LINE **) MALLOC(sizeof(LINE *) * (size_t)li->size)) == NULL) {
+		ERRLOG(0xE0E1);
+		FREE(li);
+		return (1);
+	}
+	li->slots[0] = top;
+	li->gap = 1;
+	li->gaplen = li->size - 1;
+	top->lidx = 0;
+	top->lri = (unsigned)(ri+1) & 0x3f;
+	cnf.fdata[ri].lindex = li;
+
+	return (0);
+}
+
+/*
+ * free the line index of the buffer, the lines are not indexed after this
+ */
+void
+lll_index_drop (int ri)
+{
+	LINDEX *li = cnf.fdata[ri].lindex;
+	int level;
+
+	if (li != NULL) {
+		for (level=1; level <= LIDX_LEVELS; level++) {
+			FREE(li->hide[level]);
+		}
+		FREE(li->slots);
+		FREE(li);
+		cnf.fdata[ri].lindex = NULL;
+	}
+}
+
+/*
+ * the line index of the buffer of the line, or NULL
+ */
+static LINDEX *
+lidx_of (const LINE *lp)
+{
+	if (lp == NULL || lp->lri == 0)
+		return (NULL);
+	return (cnf.fdata[lp->lri - 1].lindex);
+}
+
+/*
+ * double the size of the index, the lines after the gap go to the end;
+ * return 0 if ok, 1 on malloc failure
+ */
+static int
+lidx_grow (LINDEX *li)
+{
+	LINE **slots;
+	unsigned long *w;
+	int size, level, tail;
+	size_t old_words;
+
+	size = li->size * 2;
+	if (size > 0x3ffffff) {
+		ERRLOG(0xE0E2);
+		return (1);
+	}
+	if ((slots = (LINE **) REALLOC((void *)li->slots, sizeof(LINE *) * (size_t)size)) == NULL) {
+		ERRLOG(0xE0E2);
+		return (1);
+	}
+	li->slots = slots;
+	old_words = LIDX_WORDS(li->size);
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if (li->hide[level] == NULL)
+			continue;
+		if ((w = (unsigned long *) REALLOC((void *)li->hide[level], sizeof(unsigned long) * LIDX_WORDS(size))) == NULL) {
+			ERRLOG(0xE0E2);
+			return (1);
+		}
+		memset(w + old_words, 0, sizeof(unsigned long) * (LIDX_WORDS(size) - old_words));
+		li->hide[level] = w;
+	}
+
+	tail = li->size - (li->gap + li->gaplen);
+	lidx_move_slots(li, li->gap + li->gaplen, size - tail, tail);
+	li->gaplen += size - li->size;
+	li->size = size;
+
+	return (0);
+}
+
+/*
+ * move n slots with the hide bits from slot "from" to slot "to", the ranges may overlap
+ */
+static void
+lidx_move_slots (LINDEX *li, int from, int to, int n)
+{
+	unsigned long *w;
+	int i, level;
+
+	if (n <= 0 || from == to)
+		return;
+	memmove(&li->slots[to], &li->slots[from], sizeof(LINE *) * (size_t)n);
+	for (i=0; i < n; i++) {
+		li->slots[to+i]->lidx = (unsigned)(to+i) & 0x3ffffff;
+	}
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if ((w = li->hide[level]) == NULL)
+			continue;
+		if (to > from) {
+			for (i=n-1; i >= 0; i--) {
+				if (BIT_GET(w, from+i))
+					BIT_SET(w, to+i);
+				else
+					BIT_CLR(w, to+i);
 			}
 		} else {
-			/* curr_line: decrement */
-			lp = cnf.fdata[ri].curr_line->prev;
-			cnt = cnf.fdata[ri].lineno-1;
-			for (; cnt>lineno && TEXT_LINE(lp); cnt--) {
-				lp = lp->prev;
+			for (i=0; i < n; i++) {
+				if (BIT_GET(w, from+i))
+					BIT_SET(w, to+i);
+				else
+					BIT_CLR(w, to+i);
 			}
 		}
-	} else if (lineno > cnf.fdata[ri].lineno) {
-		/* target between curr_line and bottom */
-		if (cnf.fdata[ri].num_lines - lineno < lineno - cnf.fdata[ri].lineno) {
-			/* bottom: decrement */
-			lp = cnf.fdata[ri].bottom->prev;
-			cnt = cnf.fdata[ri].num_lines;
-			for (; cnt>lineno && TEXT_LINE(lp); cnt--) {
-				lp = lp->prev;
+	}
+}
+
+/*
+ * move the gap in front of the ordinal
+ */
+static void
+lidx_gap_move (LINDEX *li, int ord)
+{
+	if (ord < li->gap) {
+		lidx_move_slots(li, ord, ord + li->gaplen, li->gap - ord);
+	} else if (ord > li->gap) {
+		lidx_move_slots(li, li->gap + li->gaplen, li->gap, ord - li->gap);
+	}
+	li->gap = ord;
+}
+
+/*
+ * insert the line into the index of the buffer at the ordinal, visible on all levels;
+ * return 0 if ok, 1 on malloc failure
+ */
+static int
+lidx_insert (LINE *lp, int ri, int ord)
+{
+	LINDEX *li = cnf.fdata[ri].lindex;
+	int level;
+
+	if (li == NULL)
+		return (0);
+	if (li->gaplen == 0 && lidx_grow(li))
+		return (1);
+	lidx_gap_move(li, ord);
+	li->slots[li->gap] = lp;
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if (li->hide[level] != NULL)
+			BIT_CLR(li->hide[level], li->gap);
+	}
+	lp->lidx = (unsigned)li->gap & 0x3ffffff;
+	lp->lri = (unsigned)(ri+1) & 0x3f;
+	li->gap++;
+	li->gaplen--;
+
+	return (0);
+}
+
+/*
+ * remove the line from the index of its buffer
+ */
+static void
+lidx_remove (LINE *lp)
+{
+	LINDEX *li = lidx_of(lp);
+	int ord;
+
+	if (li != NULL) {
+		ord = LIDX_ORD(li, (int)lp->lidx);
+		if (ord != li->gap) {
+			lidx_gap_move(li, ord+1);
+			li->gap--;
+		}
+		/* the slot after the gap joins the gap */
+		li->gaplen++;
+	}
+	lp->lri = 0;
+}
+
+/*
+ * the line is hidden on any of the filter levels in fmask (FMASK bits)
+ */
+int
+lll_hidden (const LINE *lp, int fmask)
+{
+	const LINDEX *li;
+	int level;
+
+	if (fmask == 0 || (li = lidx_of(lp)) == NULL)
+		return (0);
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if ((fmask & FMASK(level)) && li->hide[level] != NULL && BIT_GET(li->hide[level], (int)lp->lidx))
+			return (1);
+	}
+	return (0);
+}
+
+/*
+ * hide the line on the filter levels in fmask, not the top and bottom lines
+ */
+void
+lll_hide (LINE *lp, int fmask)
+{
+	LINDEX *li;
+	unsigned long *w;
+	int level;
+
+	if (fmask == 0 || (li = lidx_of(lp)) == NULL || (lp->lflag & (LSTAT_TOP | LSTAT_BOTTOM)))
+		return;
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if ((fmask & FMASK(level)) && (w = lidx_level(li, level)) != NULL)
+			BIT_SET(w, (int)lp->lidx);
+	}
+}
+
+/*
+ * unhide the line on the filter levels in fmask
+ */
+void
+lll_unhide (LINE *lp, int fmask)
+{
+	LINDEX *li;
+	int level;
+
+	if (fmask == 0 || (li = lidx_of(lp)) == NULL)
+		return;
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if ((fmask & FMASK(level)) && li->hide[level] != NULL)
+			BIT_CLR(li->hide[level], (int)lp->lidx);
+	}
+}
+
+/*
+ * the hide bits of the line, FMASK bits of the levels where the line is hidden
+ */
+int
+lll_hide_get (const LINE *lp)
+{
+	const LINDEX *li;
+	int level, fmask=0;
+
+	if ((li = lidx_of(lp)) == NULL)
+		return (0);
+	for (level=1; level <= LIDX_LEVELS; level++) {
+		if (li->hide[level] != NULL && BIT_GET(li->hide[level], (int)lp->lidx))
+			fmask |= FMASK(level);
+	}
+	return (fmask);
+}
+
+/*
+ * set the hide bits of the line on all levels, from lll_hide_get()
+ */
+void
+lll_hide_put (LINE *lp, int fmask)
+{
+	lll_unhide(lp, LSTAT_FMASK & ~fmask);
+	lll_hide(lp, fmask);
+}
+
+/*
+ * the bitset of the level, allocated on the first use with all lines visible;
+ * NULL on malloc failure
+ */
+static unsigned long *
+lidx_level (LINDEX *li, int level)
+{
+	if (li->hide[level] == NULL) {
+		li->hide[level] = (unsigned long *) MALLOC(sizeof(unsigned long) * LIDX_WORDS(li->size));
+		if (li->hide[level] == NULL) {
+			ERRLOG(0xE0E3);
+			return (NULL);
+		}
+		memset(li->hide[level], 0, sizeof(unsigned long) * LIDX_WORDS(li->size));
+	}
+	return (li->hide[level]);
+}
+
+/*
+ * first slot in [from,to) with the hide bit, or to; the words without it are skipped
+ */
+static int
+bits_find (const unsigned long *w, int from, int to, int hidden)
+{
+	unsigned long x, inv = hidden ? 0UL : ~0UL;
+	int i = from, b;
+
+	while (i < to) {
+		b = i % LIDX_WBITS;
+		x = (w[i / LIDX_WBITS] ^ inv) >> b;
+		if (x != 0) {
+			while (!(x & 1UL)) {
+				x >>= 1;
+				i++;
 			}
-		} else {
-			/* curr_line: increment */
-			lp = cnf.fdata[ri].curr_line->next;
-			cnt = cnf.fdata[ri].lineno+1;
-			for (; cnt<lineno && TEXT_LINE(lp); cnt++) {
-				lp = lp->next;
+			return ((i < to) ? i : to);
+		}
+		i += LIDX_WBITS - b;
+	}
+	return (to);
+}
+
+/*
+ * last slot in [from,to) with the hide bit, or from-1
+ */
+static int
+bits_rfind (const unsigned long *w, int from, int to, int hidden)
+{
+	unsigned long x, inv = hidden ? 0UL : ~0UL;
+	int i = to-1, b;
+
+	while (i >= from) {
+		b = i % LIDX_WBITS;
+		x = w[i / LIDX_WBITS] ^ inv;
+		if (b < LIDX_WBITS-1)
+			x &= (1UL << (b+1)) - 1;
+		if (x != 0) {
+			while (!((x >> b) & 1UL)) {
+				b--;
+				i--;
 			}
+			return ((i >= from) ? i : from-1);
 		}
+		i -= b + 1;
+	}
+	return (from-1);
+}
+
+/*
+ * set or clear the hide bits of the slots [from,to), word-wide
+ */
+static void
+bits_fill (unsigned long *w, int from, int to, int hidden)
+{
+	unsigned long m;
+	int i = from, b, e;
+
+	while (i < to) {
+		b = i % LIDX_WBITS;
+		e = (to - i + b < LIDX_WBITS) ? to - i + b : LIDX_WBITS;
+		m = (e == LIDX_WBITS) ? ~0UL : ((1UL << e) - 1);
+		m &= ~((1UL << b) - 1);
+		if (hidden)
+			w[i / LIDX_WBITS] |= m;
+		else
+			w[i / LIDX_WBITS] &= ~m;
+		i += e - b;
+	}
+}
+
+/*
+ * lll_hide_find - first text line ordinal in [from,to) with the hide state on the filter level,
+ *	or to; the bottom line follows the text lines, it is never hidden
+ */
+int
+lll_hide_find (int ri, int level, int from, int to, int hidden)
+{
+	const LINDEX *li = cnf.fdata[ri].lindex;
+	const unsigned long *w;
+	int end, r;
+
+	if (li == NULL)
+		return (to);
+	if (from < 1)
+		from = 1;
+	if (to > LIDX_COUNT(li)-1)
+		to = LIDX_COUNT(li)-1;
+	if (from >= to)
+		return (to);
+	if ((w = li->hide[level]) == NULL)
+		return ((hidden) ? to : from);
+
+	if (from < li->gap) {
+		end = MIN(to, li->gap);
+		if ((r = bits_find(w, from, end, hidden)) < end)
+			return (r);
+		from = end;
+		if (from >= to)
+			return (to);
+	}
+	return (bits_find(w, from + li->gaplen, to + li->gaplen, hidden) - li->gaplen);
+}
+
+/*
+ * lll_hide_rfind - last text line ordinal in [from,to) with the hide state on the filter level,
+ *	or from-1
+ */
+int
+lll_hide_rfind (int ri, int level, int from, int to, int hidden)
+{
+	const LINDEX *li = cnf.fdata[ri].lindex;
+	const unsigned long *w;
+	int start, r;
+
+	if (li == NULL)
+		return (from-1);
+	if (from < 1)
+		from = 1;
+	if (to > LIDX_COUNT(li)-1)
+		to = LIDX_COUNT(li)-1;
+	if (from >= to)
+		return (from-1);
+	if ((w = li->hide[level]) == NULL)
+		return ((hidden) ? from-1 : to-1);
+
+	if (to > li->gap) {
+		start = MAX(from, li->gap);
+		if ((r = bits_rfind(w, start + li->gaplen, to + li->gaplen, hidden)) >= start + li->gaplen)
+			return (r - li->gaplen);
+		to = start;
+		if (from >= to)
+			return (from-1);
+	}
+	return (bits_rfind(w, from, to, hidden));
+}
+
+/*
+ * lll_hide_range - hide or unhide the text lines [from,to) of the buffer on the filter level,
+ *	word-wide
+ */
+void
+lll_hide_range (int ri, int level, int from, int to, int hidden)
+{
+	LINDEX *li = cnf.fdata[ri].lindex;
+	unsigned long *w;
+	int end;
+
+	if (li == NULL)
+		return;
+	if (from < 1)
+		from = 1;
+	if (to > LIDX_COUNT(li)-1)
+		to = LIDX_COUNT(li)-1;
+	if (from >= to)
+		return;
+	if (li->hide[level] == NULL && !hidden)
+		return;
+	if ((w = lidx_level(li, level)) == NULL)
+		return;
+
+	if (from < li->gap) {
+		end = MIN(to, li->gap);
+		bits_fill(w, from, end, hidden);
+		from = end;
 	}
+	if (from < to)
+		bits_fill(w, from + li->gaplen, to + li->gaplen, hidden);
+}
+
+/*
+ * lll_next_visible - the next line after lp not hidden on the filter level or the bottom line,
+ *	count is the number of lines stepped over; NULL if the line is not indexed
+ */
+LINE *
+lll_next_visible (const LINE *lp, int level, int *count)
+{
+	const LINDEX *li = lidx_of(lp);
+	int ord, r;
 
-	return (lp);
+	if (li == NULL)
+		return (NULL);
+	ord = LIDX_ORD(li, (int)lp->lidx);
+	if (ord >= LIDX_COUNT(li)-1)
+		r = ord;
+	else
+		r = lll_hide_find((int)lp->lri - 1, level, ord+1, LIDX_COUNT(li)-1, 0);
+	*count = r - ord;
+	return (li->slots[LIDX_SLOT(li, r)]);
+}
+
+/*
+ * lll_prev_visible - the previous line before lp not hidden on the filter level or the top line,
+ *	count is the number of lines stepped over; NULL if the line is not indexed
+ */
+LINE *
+lll_prev_visible (const LINE *lp, int level, int *count)
+{
+	const LINDEX *li = lidx_of(lp);
+	int ord, r;
+
+	if (li == NULL)
+		return (NULL);
+	ord = LIDX_ORD(li, (int)lp->lidx);
+	if (ord <= 0)
+		r = ord;
+	else
+		r = lll_hide_rfind((int)lp->lri - 1, level, 1, ord, 0);
+	*count = ord - r;
+	return (li->slots[LIDX_SLOT(li, r)]);
+}
+
+/*
+ * lll_hide_copy - copy the hide bits of the src filter level to the dst level, word-wide
+ */
+void
+lll_hide_copy (int ri, int dst, int src)
+{
+	LINDEX *li = cnf.fdata[ri].lindex;
+	unsigned long *w;
+
+	if (li == NULL || dst == src)
+		return;
+	if (li->hide[src] == NULL) {
+		if (li->hide[dst] != NULL)
+			memset(li->hide[dst], 0, sizeof(unsigned long) * LIDX_WORDS(li->size));
+		return;
+	}
+	if ((w = lidx_level(li, dst)) == NULL)
+		return;
+	memcpy(w, li->hide[src], sizeof(unsigned long) * LIDX_WORDS(li->size));
+}
+
+/*
+ * lll_hide_combine - combine the hide bits of the src filter level into the dst level, word-wide;
+ *	intersect keeps visible the lines visible on both levels, otherwise the lines visible on any
+ */
+void
+lll_hide_combine (int ri, int dst, int src, int intersect)
+{
+	LINDEX *li = cnf.fdata[ri].lindex;
+	unsigned long *w;
+	const unsigned long *s;
+	size_t i, nw;
+
+	if (li == NULL || dst == src)
+		return;
+	nw = LIDX_WORDS(li->size);
+	if ((s = li->hide[src]) == NULL) {
+		/* all lines visible on src */
+		if (!intersect && li->hide[dst] != NULL)
+			memset(li->hide[dst], 0, sizeof(unsigned long) * nw);
+		return;
+	}
+	if (li->hide[dst] == NULL && !intersect)
+		return;
+	if ((w = lidx_level(li, dst)) == NULL)
+		return;
+	if (intersect) {
+		for (i=0; i < nw; i++)
+			w[i] |= s[i];
+	} else {
+		for (i=0; i < nw; i++)
+			w[i] &= s[i];
+	}
 }
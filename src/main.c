@@ -368,9 +368,12 @@ leave (const char *reason)
 	FREE(cnf.name_hash);
 	cnf.name_hash = NULL;
 
-	/* tags -- cnf.taglist */
+	/* tags -- cnf.tagdb */
 	tag_rm_all();
 
+	/* project search index */
+	pindex_drop();
+
 	/* motion history -- cnf.mhistory */
 	mhist_clear(-1);
 
@@ -470,6 +473,8 @@ set_defaults(void)
 	cnf.head = (cnf.gstat & GSTAT_TABHEAD) ? 2 : 1;
 	cnf.pref = (cnf.gstat & GSTAT_PREFIX) ? PREFIXSIZE : 0;
 	cnf.gstat |= GSTAT_FIXCR;	/* explicit on */
+	cnf.gstat |= GSTAT_PINDEX;	/* explicit on, used with projects only */
+	cnf.gstat |= GSTAT_INCSEARCH;	/* explicit on */
 
 	cnf.cpal = (CPAL) { "default", { 0x02, 0x06, 0x07, 0x01, 0x42, 0x46, 0x47, 0x41, 0x10, 0x14, 0x38, 0x08, 0x18, 0x1c, 0x38, 0x08, 0x27, 0x30, 0x02, 0x27 } };
 	cnf.palette_array = NULL;
@@ -495,6 +500,10 @@ set_defaults(void)
 		cnf.fdata[i].pipe_output = 0;
 		cnf.fdata[i].pipe_input = 0;
 		cnf.fdata[i].readbuff = NULL;
+		cnf.fdata[i].lindex = NULL;
+		cnf.fdata[i].cblocks = NULL;
+		cnf.fdata[i].lcache = NULL;
+		cnf.fdata[i].openers = NULL;
 		cnf.fdata[i].rb_nexti = 0;
 	}
 
@@ -511,7 +520,7 @@ set_defaults(void)
 	cnf.cloff = 0;
 
 	/* tags info tree */
-	cnf.taglist = NULL;
+	cnf.tagdb = NULL;
 
 	/* bookmarking */
 	for(i=0; i < 10; i++)
@@ -92,6 +92,17 @@
 #define ZOMBIE_DELAY	(1000/CUST_WTIMEOUT*1)	/* check process alive, 1 second */
 #define REFRESH_EVENT	(-2)		/* force display refresh */
 
+/* parallel regex filter */
+#define FILTER_PAR_LINES	100000	/* use worker threads above this buffer size */
+#define FILTER_PAR_THREADS	8	/* max number of worker threads */
+#define FILTER_PAR_STEP		4096	/* lines between progress updates in workers */
+#define TAGS_PAR_SIZE		0x800000	/* parse the tags file on worker threads above this size (8M) */
+#define TAGS_PAR_THREADS	8	/* max number of tags parser threads */
+#define TAGS_MK_MAXFSIZE	0x1000000	/* 16M, larger sources are skipped by the tags generator */
+#define TAGS_MK_MAXDEPTH	32	/* directory depth limit of the tags generator */
+#define TAG_FUZZY_MAX		16	/* choices of the ranked symbol completion */
+#define TAGS_POS_CACHE		64	/* slots of the resolved positions of the pattern tags */
+
 /* bit masks for global flags */
 #define GSTAT_PREFIX	0x00000001	/* view prefix area */
 #define GSTAT_TABHEAD	0x00000002	/* view tab header under status line */
@@ -116,6 +127,9 @@
 #define GSTAT_UPDNONE	0x00040000	/* no screen update required */
 #define GSTAT_UPDFOCUS	0x00080000	/* only focus line update required */
 #define GSTAT_REDRAW	0x00100000	/* force redraw flag */
+// other switches
+#define GSTAT_PINDEX	0x00200000	/* use the project search index for find/locate */
+#define GSTAT_INCSEARCH	0x00400000	/* incremental search while typing the search command */
 
 #define TOP_MARK	"<<top>>\n"		/* pass LINESIZE_MIN */
 #define BOTTOM_MARK	"<<eof>>\n"		/* pass LINESIZE_MIN */
@@ -159,12 +173,29 @@
 #define LSTAT_TOP	0x00000020	/* top mark bit */
 #define LSTAT_BOTTOM	0x00000040	/* bottom mark bit */
 /*			0x00000080 */
-#define LSTAT_FMASK	FSTAT_FMASK	/* filter mask-bits (for hide), placeholder for the hide bits per line */
+#define LSTAT_FMASK	FSTAT_FMASK	/* filter mask-bits of all levels, the hide bits are in the line index (see lll_hidden) */
 /*			0x00008000 */
 #define LSTAT_BM_BITS	0x000f0000	/* mask for bookmark index, placeholder for 15, we use 9 only (see BM_BIT_SHIFT) */
 /* bookmarks */
 #define BM_BIT_SHIFT	(4*4)		/* bit shift count, to convert index<-->mask, bm_i <--> bm_bits (see LSTAT_BM_BITS) */
 
+/* structure info of the line (see LCACHE), valid while the lgen of the line is the same */
+#define SINFO_INDENT	0x0000ffff	/* indentation depth, prefix blanks */
+#define SINFO_BLANK	0x00010000	/* only white characters in the line */
+#define SINFO_HEADER	0x00020000	/* block opener, function header */
+#define SINFO_ICASE	0x00040000	/* header checked case insensitive */
+#define SINFO_FTYPE	0x00f00000	/* file type the header checked for */
+#define SINFO_KEY(ftype)	( (((int)(ftype) << 20) & SINFO_FTYPE) | ((cnf.gstat & GSTAT_CASES) ? 0 : SINFO_ICASE) )
+
+/* bracket skeleton of the purified line (see LCACHE), valid while the lgen of the line is the same;
+ * skel[0] is the header with count and purify kind, then one entry per block character */
+#define SKEL_COUNT(h)		( (h) & 0x00ffffff )
+#define SKEL_KIND(h)		( ((h) >> 24) & 0xff )
+#define SKEL_HEADER(n,kind)	( ((n) & 0x00ffffff) | ((kind) << 24) )
+#define SKEL_COL(e)		( (e) >> 8 )
+#define SKEL_CH(e)		( (char)((e) & 0xff) )
+#define SKEL_ENTRY(col,ch)	( ((col) << 8) | ((ch) & 0xff) )
+
 /* bit masks for command (table) flags */
 #define TSTAT_ARGS	0x0001		/* cmd requires argument */
 #define TSTAT_EDIT	FSTAT_NOEDIT	/* cmd can edit the line buffer */
@@ -190,7 +221,10 @@
 /* effective mask for lines (.lflag) depending on .fflag AND .flevel -- bit in .fflag for temporary switch */
 #define LMASK(ri)		( cnf.fdata[(ri)].fflag & (FMASK(cnf.fdata[(ri)].flevel)) )
 /* invisible line query */
-#define HIDDEN_LINE(ri,lp)	( (lp)->lflag & LMASK(ri) )
+#define HIDDEN_LINE(ri,lp)	( lll_hidden((lp), LMASK(ri)) )
+/* lines of the buffer changed, after the cnf.line_gen bump; the line primitives mark the
+ * buffer of the line, the callers changing the line content in another buffer mark that one also */
+#define LINES_CHANGED(ri)	( cnf.fdata[(ri)].lgen = cnf.line_gen )
 
 /* regcomp options */
 #define REGCOMP_OPTION	(REG_EXTENDED | REG_NEWLINE | ((cnf.gstat & GSTAT_CASES) ? 0 : REG_ICASE))
@@ -245,8 +279,16 @@ typedef struct key_string_tag KEYS;
 typedef struct macros_tag MACROS;
 typedef struct macroitems_tag MACROITEMS;
 typedef struct tagstru_tag TAG;
+typedef struct tagfile_tag TAGFILE;
+typedef struct tagdb_tag TAGDB;
 typedef struct bookmark_tag BOOKMARK;
 typedef struct motion_history_tag MHIST;
+typedef struct lindex_tag LINDEX;
+typedef struct cbracket_tag CBRACKET;
+typedef struct cblocks_tag CBLOCKS;
+typedef struct lcache_tag LCACHE;
+typedef struct lcaches_tag LCACHES;
+typedef struct openers_tag OPENERS;
 
 /* the command line */
 struct cmdline_tag
@@ -264,7 +306,76 @@ struct line_tag
 	LINE *next;		/* NULL if last line */
 	char *buff;		/* malloc() and free() */
 	int llen;		/* line length, characters in the line */
-	int lflag;		/* LSTAT_ (various flags w/ filter mask and bookmark bits) */
+	int lflag;		/* LSTAT_ (various flags w/ bookmark bits) */
+	unsigned lidx:26;	/* slot in the line index of the buffer */
+	unsigned lri:6;		/* the buffer of the line, ring index+1, or 0 if not indexed */
+	unsigned lgen;		/* generation of the buff content, see cnf.line_gen */
+};
+
+/* line index of a buffer: the lines in chain order by slot, with the gap [gap,gap+gaplen) for
+ * the inserts; the ordinal of the line (top is 0, bottom is num_lines+1) follows from the slot,
+ * the hide bits of the filter levels are dense bitsets by slot, the bit is set if hidden */
+#define LIDX_LEVELS	7
+struct lindex_tag
+{
+	LINE **slots;		/* malloc and free */
+	int size;		/* allocated slots */
+	int gap;		/* first slot of the gap */
+	int gaplen;		/* free slots in the gap */
+	unsigned long *hide[LIDX_LEVELS+1];	/* by filter level, NULL if no line hidden there (malloc and free) */
+};
+
+/* a block character in the purified C source */
+struct cbracket_tag
+{
+	int lidx;		/* line index, lineno-1 */
+	int col;		/* character position in the line */
+	int pair;		/* index of the matching block character, or -1 */
+	char ch;
+};
+
+/* block structure index of a C source buffer, for tomatch_eng() */
+struct cblocks_tag
+{
+	unsigned line_gen;	/* valid while equal to the lgen of the buffer */
+	int nlines;
+	int lines_size;		/* allocated items in lines[], lgens[] and first_br[] */
+	LINE **lines;		/* the lines of the buffer at build time */
+	unsigned *lgens;	/* lgen of the lines at build time */
+	int *first_br;		/* index of the first block character in the line, nlines+1 items */
+	int nbr;
+	int br_size;		/* allocated items in br[] */
+	CBRACKET *br;		/* block characters in buffer order */
+};
+
+/* cached data of a line in the line cache of the buffer */
+struct lcache_tag
+{
+	const LINE *lp;		/* the key, only compared, NULL if the slot is free */
+	unsigned pgen;		/* lgen of the line for the skel, 0 if none */
+	int *skel;		/* bracket skeleton of the purified line, or NULL (malloc and free) */
+	unsigned sgen;		/* lgen of the line for the sinfo, 0 if none */
+	int sinfo;		/* SINFO_ (indentation depth and header flag) */
+};
+
+/* line cache of a buffer, open addressing by the line pointer; allocated on the first use
+ * (tomatch, C block index, header lines), emptied when it gets full */
+struct lcaches_tag
+{
+	int size;		/* power of 2 */
+	int count;
+	LCACHE *tab;		/* malloc and free */
+};
+
+/* block openers (header lines) of a PERL, SHELL or PYTHON buffer in line order */
+struct openers_tag
+{
+	unsigned line_gen;	/* valid while equal to the lgen of the buffer */
+	int key;		/* SINFO_KEY() at build time */
+	int count;
+	int size;		/* allocated items in lines[] and linenos[] */
+	LINE **lines;		/* malloc and free */
+	int *linenos;		/* malloc and free */
 };
 
 typedef enum filetype_enum
@@ -308,6 +419,13 @@ struct fdata_tag
 	char search_expr[SEARCHSTR_SIZE];	/* the last search expression */
 	char replace_expr[SEARCHSTR_SIZE];	/* the last replace expression */
 	regex_t highlight_reg;	/* regexp for word highlighting (with FSTAT_TAG5) */
+	unsigned search_gen;	/* generation of search_reg, see cnf.regex_gen */
+	unsigned highlight_gen;	/* generation of highlight_reg */
+	LINDEX *lindex;		/* line index with the hide bits, or NULL (malloc and free) */
+	CBLOCKS *cblocks;	/* block structure index of C sources, or NULL (malloc and free) */
+	LCACHES *lcache;	/* cached data of the lines, or NULL (malloc and free) */
+	OPENERS *openers;	/* block openers, or NULL (malloc and free) */
+	unsigned lgen;		/* cnf.line_gen at the last change of the lines, see LINES_CHANGED() */
 
 	int	pipe_opts;	/* options for pipe in/out processing */
 	int	chrw;		/* child pid r/w */
@@ -380,6 +498,8 @@ struct config_tag
 	int ring_curr;		/* 0 ... ring_size-1 */
 	int ring_size;		/* 0 if nothing, else 1 ... RINGSIZE */
 	FDATA fdata[RINGSIZE];
+	unsigned line_gen;	/* counter for LINE changes, the identity of line content (and line chain changes) */
+	unsigned regex_gen;	/* counter for search/highlight regcomp, the identity of the regexp */
 
 	/* command key and name hashes */
 	short int *fkey_hash;	/* malloc and free */
@@ -400,7 +520,7 @@ struct config_tag
 
 	char find_path[SHORTNAME];
 	char find_opts[FNAMESIZE];
-	char tags_file[SHORTNAME];
+	char tags_file[FNAMESIZE];	/* colon separated list of tags files */
 	char vcs_tool[10][SHORTNAME];		/* vcs tools, extension */
 	char vcs_path[10][SHORTNAME];		/* vcs tools, extension */
 	char make_path[SHORTNAME];
@@ -424,9 +544,7 @@ struct config_tag
 
 	NODE *seq_tree;		/* key sequence tree */
 
-	char tag_j2path[FNAMESIZE];
-	int tag_j2len;
-	TAG *taglist;		/* 'tags' info tree */
+	TAGDB *tagdb;		/* 'tags' info, the loaded tags files */
 
 	MHIST *mhistory;	/* push/pop list */
 
@@ -463,6 +581,9 @@ struct change_data_tag
 	int rflag;		/* 1=backref, 0=no-backref */
 	char *rep_buff;		/* replacement buffer (malloc/free) */
 	int rep_length;		/* actual size of rep_buff[] */
+	regex_t *reg;		/* compiled search expression */
+	const char *repl_expr;	/* replace expression, for accum_replacement() */
+	int anchor;		/* 1 if search expression has BoL or EoL anchor */
 };
 
 /* for the key and command handler */
@@ -514,16 +635,42 @@ typedef enum tagtype_enum
 	TAG_UNDEF	= '?'
 } TAGTYPE;
 
+/* strings point into the string arenas of the parsed tags file or into the mapped cache file */
 struct tagstru_tag
 {
-	TAG *next;
 	char *symbol;
-	char *fname;
+	char *fname;		/* interned, one of the files[] */
 	TAGTYPE type;
 	int lineno;
 	char *pattern;
 };
 
+struct tagfile_tag
+{
+	char path[FNAMESIZE];	/* the tags file */
+	char j2path[FNAMESIZE];	/* the directory of the tags file with '/', prefix of the relative file names */
+	int j2len;
+	char *map;		/* the cache file mapped read-only, or NULL */
+	size_t mapsize;
+	char *strs[TAGS_PAR_THREADS];	/* the strings of the parsed tags file, one arena per parser chunk (malloc/free) */
+	size_t strsize;		/* used bytes of the arenas */
+	TAG *tags;		/* tag records in file order, NULL if the file was not loaded */
+	int ntags;
+	char **files;		/* the interned file names */
+	int nfiles;
+	time_t mtime;		/* the tags file at load time */
+	off_t fsize;
+	int mkflag;		/* generated by tag_make(), 1 in memory, 2 written also */
+};
+
+struct tagdb_tag
+{
+	TAGFILE *tf;		/* the tags files, in list order */
+	int ntf;
+	TAG **index;		/* the tags of all files sorted by symbol, in list and file order within the same symbol */
+	int ntags;
+};
+
 struct motion_history_tag
 {
 	MHIST *prev;		/* NULL, at first */
@@ -0,0 +1,1215 @@
+/*
+* pindex.c
+* project search index, trigram postings and modification times of the project source files,
+* saved in the ~/.eda/ directory and used by find and locate to select the candidate files
+*
+* Copyright 2003-2016 Attila Gy. Molnar
+*
+* This file is part of eda project.
+*
+* Eda is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Eda is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Eda.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <syslog.h>
+#include <dirent.h>		/* opendir readdir */
+#include <fnmatch.h>
+#include <sys/mman.h>		/* mmap munmap */
+#include "main.h"
+#include "proto.h"
+
+/* global config */
+extern CONFIG cnf;
+
+#define PIX_MAGIC	"EDAPIX02"	/* index file magic, with the format version */
+#define PIX_MAXDEPTH	32		/* directory depth limit for the walk */
+#define PIX_MAXFSIZE	0x1000000	/* 16M, larger files are not indexed */
+#define PIX_MAXNAMES	16		/* name patterns taken from find_opts */
+#define PIX_MAXTRI	64		/* trigrams used from one pattern */
+#define PIX_TRISPACE	0x1000000	/* three bytes */
+#define PIX_NONE	0xffffffffU
+#define PIX_BINARY	0x1		/* file flag, not a text file */
+
+/* index file layout: header, file table, trigram table, postings, string table
+*/
+typedef struct pix_head_tag {
+	char magic[8];
+	uint32_t nfiles;	/* entries in the file table, sorted by name */
+	uint32_t ntri;		/* entries in the trigram table, sorted by trigram */
+	uint32_t npost;		/* postings, file ids */
+	uint32_t strsize;	/* size of the string table */
+	uint32_t build_msec;	/* elapsed time of the last write */
+	uint32_t reserved;
+} PIX_HEAD;
+
+typedef struct pix_file_tag {
+	int64_t mtime;		/* nanoseconds */
+	int64_t size;
+	uint32_t name;		/* offset in the string table */
+	uint32_t flags;		/* PIX_BINARY */
+} PIX_FILE;
+
+typedef struct pix_tri_tag {
+	uint32_t tri;		/* three bytes, lowercase */
+	uint32_t first;		/* index of the first posting */
+	uint32_t count;		/* number of postings */
+} PIX_TRI;
+
+/* file entry, collected by the walk */
+typedef struct pix_ent_tag {
+	char *name;
+	int64_t mtime;
+	int64_t size;
+	uint32_t flags;
+	uint32_t oldid;		/* id in the mapped index, or PIX_NONE if (re)scanned */
+	uint32_t *tri;		/* trigrams of the scanned file (malloc/free) */
+	unsigned ntri;
+} PIX_ENT;
+
+/* directory of the last walk, new and removed files change its mtime */
+typedef struct pix_dir_tag {
+	char *name;
+	int64_t mtime;
+} PIX_DIR;
+
+/* the mapped index, with statistics of the last refresh and query
+*/
+static struct pix_tag {
+	char path[FNAMESIZE+SHORTNAME];
+	char *map;
+	size_t mapsize;
+	const PIX_HEAD *head;
+	const PIX_FILE *files;
+	const PIX_TRI *tris;
+	const uint32_t *post;
+	const char *strs;
+	unsigned char *cand;	/* candidate flags by file id (malloc/free) */
+	unsigned candidates;
+	unsigned scanned;	/* files scanned by the last refresh */
+	long long refresh_msec;
+	long long query_msec;
+} pix;
+
+/* walk data */
+static PIX_ENT *ents = NULL;
+static unsigned nents = 0, ents_size = 0;
+static PIX_DIR *dirs = NULL;
+static unsigned ndirs = 0, dirs_size = 0;
+static char name_pattern[PIX_MAXNAMES][SHORTNAME];
+static int name_flags[PIX_MAXNAMES];
+static int nnames = 0;
+
+/* local proto */
+static int pix_map (void);
+static void pix_unmap (void);
+static int pix_check (void);
+static int pix_find_opts (char *root, int rootsize, int *word);
+static int pix_name_match (const char *fname);
+static int pix_stale (void);
+static int pix_walk (const char *dir, int depth);
+static int pix_add_ent (const char *name, const struct stat *st);
+static int pix_add_dir (const char *name, const struct stat *st);
+static void pix_free_dirs (void);
+static int64_t pix_mtime (const struct stat *st);
+static int pix_scan (PIX_ENT *ep, unsigned char *bitmap);
+static int pix_write (void);
+static int pix_lookup (const char *name);
+static const char *pix_relname (const char *fpath);
+static int pix_pattern_tri (const char *pattern, uint32_t *tri, int max);
+static int pix_cmp_ent (const void *a, const void *b);
+static int pix_cmp_u64 (const void *a, const void *b);
+
+/*
+* pindex_active - the project search index is used for projects only
+*/
+int
+pindex_active (void)
+{
+	return ((cnf.gstat & GSTAT_PINDEX) && cnf.project[0] != '\0');
+}
+
+/*
+* map the index file, validate header and sizes
+*/
+static int
+pix_map (void)
+{
+	int fd;
+	struct stat st;
+	void *p;
+	const PIX_HEAD *hp;
+	size_t off, expected;
+
+	if ((fd = open(pix.path, O_RDONLY)) == -1) {
+		return (1);
+	}
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PIX_HEAD)) {
+		close(fd);
+		return (1);
+	}
+	p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return (2);
+	}
+
+	hp = (const PIX_HEAD *)p;
+	expected = sizeof(PIX_HEAD) + (size_t)hp->nfiles * sizeof(PIX_FILE) +
+		(size_t)hp->ntri * sizeof(PIX_TRI) + (size_t)hp->npost * sizeof(uint32_t) +
+		(size_t)hp->strsize;
+	if (memcmp(hp->magic, PIX_MAGIC, 8) != 0 || expected != (size_t)st.st_size) {
+		munmap(p, (size_t)st.st_size);
+		return (3);
+	}
+
+	pix.map = (char *)p;
+	pix.mapsize = (size_t)st.st_size;
+	pix.head = hp;
+	off = sizeof(PIX_HEAD);
+	pix.files = (const PIX_FILE *)(const void *)(pix.map + off);
+	off += (size_t)hp->nfiles * sizeof(PIX_FILE);
+	pix.tris = (const PIX_TRI *)(const void *)(pix.map + off);
+	off += (size_t)hp->ntri * sizeof(PIX_TRI);
+	pix.post = (const uint32_t *)(const void *)(pix.map + off);
+	off += (size_t)hp->npost * sizeof(uint32_t);
+	pix.strs = pix.map + off;
+
+	/* the ids and the offsets are used as indexes, a stale or broken file is not available */
+	if (pix_check()) {
+		pix_unmap();
+		return (3);
+	}
+
+	return (0);
+}
+
+/*
+* check the trigram ranges, the postings and the name offsets of the mapped index,
+* return 0 if ok, 1 if any of them is out of range
+*/
+static int
+pix_check (void)
+{
+	const PIX_HEAD *hp = pix.head;
+	unsigned i;
+
+	if (hp->nfiles > 0 && (hp->strsize == 0 || pix.strs[hp->strsize-1] != '\0'))
+		return (1);
+	for (i=0; i < hp->nfiles; i++) {
+		if (pix.files[i].name >= hp->strsize)
+			return (1);
+	}
+	for (i=0; i < hp->ntri; i++) {
+		if ((uint64_t)pix.tris[i].first + pix.tris[i].count > hp->npost)
+			return (1);
+	}
+	for (i=0; i < hp->npost; i++) {
+		if (pix.post[i] >= hp->nfiles)
+			return (1);
+	}
+
+	return (0);
+}
+
+/*
+* unmap the index file and drop the candidate flags
+*/
+static void
+pix_unmap (void)
+{
+	if (pix.map != NULL) {
+		munmap(pix.map, pix.mapsize);
+	}
+	pix.map = NULL;
+	pix.mapsize = 0;
+	pix.head = NULL;
+	pix.files = NULL;
+	pix.tris = NULL;
+	pix.post = NULL;
+	pix.strs = NULL;
+	FREE(pix.cand);
+	pix.cand = NULL;
+	pix.candidates = 0;
+}
+
+/*
+* pindex_drop - release the index, before exit
+*/
+void
+pindex_drop (void)
+{
+	pix_unmap();
+	pix_free_dirs();
+}
+
+/*
+* take the search root and the name patterns from find_opts,
+* like ". -type f ( -name '*.[ch]' -o -name '*.sh' ) -exec egrep -nH -w";
+* the whole word option of egrep goes to *word, return 0 if ok,
+* 1 if find_opts has other tests or options, the index cannot give the same answer
+*/
+static int
+pix_find_opts (char *root, int rootsize, int *word)
+{
+	char opts[FNAMESIZE];
+	char *args[MAXARGS];
+	const char *p;
+	int argc, i, ret=0;
+
+	strncpy(root, ".", (size_t)rootsize);
+	nnames = 0;
+	*word = 0;
+
+	strncpy(opts, cnf.find_opts, sizeof(opts));
+	opts[sizeof(opts)-1] = '\0';
+	argc = parse_args(opts, args);
+
+	for (i=0; i < argc && args[i] != NULL; i++) {
+		if (i == 0 && args[i][0] != '-' && args[i][0] != '(') {
+			strncpy(root, args[i], (size_t)rootsize);
+			root[rootsize-1] = '\0';
+		} else if (strncmp(args[i], "-exec", 6) == 0) {
+			break;
+		} else if ((!strncmp(args[i], "-name", 6) || !strncmp(args[i], "-iname", 7)) &&
+			i+1 < argc && nnames < PIX_MAXNAMES)
+		{
+			name_flags[nnames] = (args[i][1] == 'i') ? FNM_CASEFOLD : 0;
+			/* quotes removed by parse_args() */
+			strncpy(name_pattern[nnames], args[++i], SHORTNAME);
+			name_pattern[nnames][SHORTNAME-1] = '\0';
+			nnames++;
+		} else if (strncmp(args[i], "-type", 6) == 0 && i+1 < argc && strncmp(args[i+1], "f", 2) == 0) {
+			i++;
+		} else if (strcmp(args[i], "(") && strcmp(args[i], ")") && strcmp(args[i], "-o") && strcmp(args[i], "-or")) {
+			ret = 1;	/* other tests, like -prune or -path */
+		}
+	}
+
+	/* egrep and its options, the pattern and {} are added by find_cmd */
+	if (i+1 >= argc || strncmp(args[i+1], "egrep", 6) != 0) {
+		return (1);
+	}
+	for (i += 2; i < argc && args[i] != NULL; i++) {
+		if (args[i][0] != '-' || args[i][1] == '\0')
+			return (1);
+		for (p = args[i]+1; *p != '\0'; p++) {
+			if (*p == 'w')
+				*word = 1;
+			else if (*p != 'n' && *p != 'H' && *p != 's')
+				return (1);
+		}
+	}
+
+	return (ret);
+}
+
+/*
+* the file name matches the name patterns of the last refresh
+*/
+static int
+pix_name_match (const char *fname)
+{
+	const char *base;
+	int i;
+
+	base = strrchr(fname, '/');
+	base = (base == NULL) ? fname : base+1;
+	for (i=0; i < nnames; i++) {
+		if (fnmatch(name_pattern[i], base, name_flags[i]) == 0)
+			break;
+	}
+
+	return (nnames == 0 || i < nnames);
+}
+
+/*
+* collect the regular files under dir, skip dot files and directories,
+* filenames are relative to the search root
+*/
+static int
+pix_walk (const char *dir, int depth)
+{
+	DIR *dp = NULL;
+	struct dirent *de = NULL;
+	struct stat st;
+	char path[FNAMESIZE];
+	int ret=0;
+
+	if (depth > PIX_MAXDEPTH) {
+		return (0);
+	}
+	/* before the read, a file added meanwhile changes the mtime again */
+	if (stat(dir, &st) == 0 && pix_add_dir(dir, &st)) {
+		return (-1);
+	}
+	if ((dp = opendir(dir)) == NULL) {
+		return (0);	/* like find, skip unreadable directories */
+	}
+
+	while (ret == 0 && (de = readdir(dp)) != NULL) {
+		if (de->d_name[0] == '.') {
+			continue;
+		}
+		if (dir[0] == '.' && dir[1] == '\0') {
+			snprintf(path, sizeof(path), "%s", de->d_name);
+		} else {
+			snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		}
+		if (lstat(path, &st) != 0) {
+			continue;
+		}
+
+		if (S_ISDIR(st.st_mode)) {
+			ret = pix_walk(path, depth+1);
+		} else if (S_ISREG(st.st_mode) && st.st_size < PIX_MAXFSIZE) {
+			if (pix_name_match(de->d_name)) {
+				ret = pix_add_ent(path, &st);
+			}
+		}
+	}
+	closedir(dp);
+
+	return (ret);
+}
+
+/*
+* add new file entry to the list
+*/
+static int
+pix_add_ent (const char *name, const struct stat *st)
+{
+	PIX_ENT *px = NULL;
+	unsigned len;
+
+	if (nents >= ents_size) {
+		px = (PIX_ENT *) REALLOC((void *)ents, sizeof(PIX_ENT) * (ents_size + 1024));
+		if (px == NULL) {
+			ERRLOG(0xE0C0);
+			return (-1);
+		}
+		ents = px;
+		ents_size += 1024;
+	}
+
+	len = strlen(name);
+	if ((ents[nents].name = (char *) MALLOC(len+1)) == NULL) {
+		ERRLOG(0xE0C1);
+		return (-1);
+	}
+	strncpy(ents[nents].name, name, len+1);
+	ents[nents].mtime = pix_mtime(st);
+	ents[nents].size = (int64_t)st->st_size;
+	ents[nents].flags = 0;
+	ents[nents].oldid = PIX_NONE;
+	ents[nents].tri = NULL;
+	ents[nents].ntri = 0;
+	nents++;
+
+	return (0);
+}
+
+/*
+* add directory to the list of the walk
+*/
+static int
+pix_add_dir (const char *name, const struct stat *st)
+{
+	PIX_DIR *px = NULL;
+	unsigned len;
+
+	if (ndirs >= dirs_size) {
+		px = (PIX_DIR *) REALLOC((void *)dirs, sizeof(PIX_DIR) * (dirs_size + 256));
+		if (px == NULL) {
+			ERRLOG(0xE0DF);
+			return (-1);
+		}
+		dirs = px;
+		dirs_size += 256;
+	}
+
+	len = strlen(name);
+	if ((dirs[ndirs].name = (char *) MALLOC(len+1)) == NULL) {
+		ERRLOG(0xE0E0);
+		return (-1);
+	}
+	strncpy(dirs[ndirs].name, name, len+1);
+	dirs[ndirs].mtime = pix_mtime(st);
+	ndirs++;
+
+	return (0);
+}
+
+/*
+* drop the directory list, the next search walks the tree again
+*/
+static void
+pix_free_dirs (void)
+{
+	unsigned d;
+
+	for (d=0; d < ndirs; d++) {
+		FREE(dirs[d].name);
+		dirs[d].name = NULL;
+	}
+	FREE(dirs);
+	dirs = NULL;
+	ndirs = dirs_size = 0;
+}
+
+/*
+* modification time in nanoseconds, a change within the same second is also seen
+*/
+static int64_t
+pix_mtime (const struct stat *st)
+{
+	return ((int64_t)st->st_mtim.tv_sec * 1000000000 + (int64_t)st->st_mtim.tv_nsec);
+}
+
+/*
+* read the file and collect its distinct trigrams, lowercase, not crossing newlines,
+* the bitmap is clean on entry and on return
+*/
+static int
+pix_scan (PIX_ENT *ep, unsigned char *bitmap)
+{
+	unsigned char buff[0x10000];
+	ssize_t n, i;
+	int fd, ret=0;
+	uint32_t w=0;
+	unsigned run=0, size=0, k;
+	uint32_t *list=NULL, *px=NULL;
+	unsigned char c;
+
+	if ((fd = open(ep->name, O_RDONLY)) == -1) {
+		ep->flags |= PIX_BINARY;
+		return (0);
+	}
+
+	while (ret == 0 && (n = read(fd, buff, sizeof(buff))) > 0) {
+		for (i=0; i < n; i++) {
+			c = buff[i];
+			if (c == '\0') {
+				/* not a text file */
+				ep->flags |= PIX_BINARY;
+				break;
+			} else if (c == '\n') {
+				run = 0;
+				continue;
+			}
+			if (c >= 'A' && c <= 'Z')
+				c = (unsigned char)(c + 'a' - 'A');
+			w = ((w << 8) | c) & (PIX_TRISPACE-1);
+			if (++run < 3)
+				continue;
+			if (bitmap[w >> 3] & (1 << (w & 7)))
+				continue;
+			bitmap[w >> 3] |= (unsigned char)(1 << (w & 7));
+			if (ep->ntri >= size) {
+				px = (uint32_t *) REALLOC((void *)list, sizeof(uint32_t) * (size + 1024));
+				if (px == NULL) {
+					ERRLOG(0xE0C2);
+					ret = -1;
+					break;
+				}
+				list = px;
+				size += 1024;
+			}
+			list[ep->ntri++] = w;
+		}
+		if (ep->flags & PIX_BINARY)
+			break;
+	}
+	close(fd);
+
+	/* clean up the bitmap */
+	for (k=0; k < ep->ntri; k++) {
+		bitmap[list[k] >> 3] = 0;
+	}
+	if (ret || (ep->flags & PIX_BINARY)) {
+		FREE(list);
+		list = NULL;
+		ep->ntri = 0;
+	}
+	ep->tri = list;
+
+	return (ret);
+}
+
+static int
+pix_cmp_ent (const void *a, const void *b)
+{
+	return strcmp(((const PIX_ENT *)a)->name, ((const PIX_ENT *)b)->name);
+}
+
+static int
+pix_cmp_u64 (const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return ((x > y) - (x < y));
+}
+
+/*
+* write the new index file from the walk entries, the postings of unchanged files
+* are taken over from the mapped index, the new file replaces the old one by rename
+*/
+static int
+pix_write (void)
+{
+	char tmppath[sizeof(pix.path)+4];
+	uint64_t *pairs=NULL;
+	PIX_TRI *tris=NULL;
+	uint32_t *old2new=NULL;
+	uint32_t buff[1024];
+	size_t npairs=0, maxpairs=0, i, j, k;
+	unsigned ntri=0, strsize=0, e;
+	uint32_t nid, t;
+	PIX_HEAD head;
+	PIX_FILE fi;
+	FILE *fp=NULL;
+	int ret=0;
+	long long t0 = msec_clock();
+
+	/* the postings, as (trigram, file id) pairs */
+	for (e=0; e < nents; e++) {
+		maxpairs += ents[e].ntri;
+	}
+	if (pix.head != NULL) {
+		maxpairs += pix.head->npost;
+		if ((old2new = (uint32_t *) MALLOC(sizeof(uint32_t) * (pix.head->nfiles+1))) == NULL) {
+			ERRLOG(0xE0C3);
+			return (-1);
+		}
+		memset(old2new, 0xff, sizeof(uint32_t) * (pix.head->nfiles+1));
+		for (e=0; e < nents; e++) {
+			if (ents[e].oldid != PIX_NONE)
+				old2new[ents[e].oldid] = e;
+		}
+	}
+	if ((pairs = (uint64_t *) MALLOC(sizeof(uint64_t) * (maxpairs+1))) == NULL) {
+		ERRLOG(0xE0C4);
+		FREE(old2new);
+		return (-1);
+	}
+	if (pix.head != NULL) {
+		for (i=0; i < pix.head->ntri; i++) {
+			t = pix.tris[i].tri;
+			for (k = pix.tris[i].first; k < (size_t)pix.tris[i].first + pix.tris[i].count; k++) {
+				nid = old2new[pix.post[k]];
+				if (nid != PIX_NONE)
+					pairs[npairs++] = ((uint64_t)t << 32) | nid;
+			}
+		}
+	}
+	FREE(old2new);
+	for (e=0; e < nents; e++) {
+		for (k=0; k < ents[e].ntri; k++) {
+			pairs[npairs++] = ((uint64_t)ents[e].tri[k] << 32) | e;
+		}
+	}
+	qsort(pairs, npairs, sizeof(uint64_t), pix_cmp_u64);
+
+	/* the trigram table */
+	for (i=0; i < npairs; i++) {
+		if (i == 0 || (pairs[i] >> 32) != (pairs[i-1] >> 32))
+			ntri++;
+	}
+	if ((tris = (PIX_TRI *) MALLOC(sizeof(PIX_TRI) * (ntri+1))) == NULL) {
+		ERRLOG(0xE0C5);
+		FREE(pairs);
+		return (-1);
+	}
+	for (i=0, j=0; i < npairs; i++) {
+		if (i == 0 || (pairs[i] >> 32) != (pairs[i-1] >> 32)) {
+			tris[j].tri = (uint32_t)(pairs[i] >> 32);
+			tris[j].first = (uint32_t)i;
+			tris[j].count = 0;
+			j++;
+		}
+		tris[j-1].count++;
+	}
+
+	for (e=0; e < nents; e++) {
+		strsize += strlen(ents[e].name) + 1;
+	}
+
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, PIX_MAGIC, 8);
+	head.nfiles = nents;
+	head.ntri = ntri;
+	head.npost = (uint32_t)npairs;
+	head.strsize = strsize;
+
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", pix.path);
+	if ((fp = fopen(tmppath, "w")) == NULL) {
+		FREE(tris);
+		FREE(pairs);
+		return (1);
+	}
+
+	if (fwrite(&head, sizeof(head), 1, fp) != 1)
+		ret = 2;
+	for (e=0, strsize=0; ret == 0 && e < nents; e++) {
+		memset(&fi, 0, sizeof(fi));
+		fi.mtime = ents[e].mtime;
+		fi.size = ents[e].size;
+		fi.name = strsize;
+		fi.flags = ents[e].flags;
+		strsize += strlen(ents[e].name) + 1;
+		if (fwrite(&fi, sizeof(fi), 1, fp) != 1)
+			ret = 2;
+	}
+	if (ret == 0 && ntri > 0 && fwrite(tris, sizeof(PIX_TRI), ntri, fp) != ntri)
+		ret = 2;
+	for (i=0; ret == 0 && i < npairs; ) {
+		for (j=0; j < 1024 && i < npairs; j++, i++) {
+			buff[j] = (uint32_t)(pairs[i] & PIX_NONE);
+		}
+		if (fwrite(buff, sizeof(uint32_t), j, fp) != j)
+			ret = 2;
+	}
+	for (e=0; ret == 0 && e < nents; e++) {
+		if (fwrite(ents[e].name, strlen(ents[e].name) + 1, 1, fp) != 1)
+			ret = 2;
+	}
+
+	/* update the build time in place */
+	head.build_msec = (uint32_t)(msec_clock() - t0);
+	if (ret == 0 && (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&head, sizeof(head), 1, fp) != 1))
+		ret = 2;
+	if (fclose(fp) != 0)
+		ret = 2;
+
+	FREE(tris);
+	FREE(pairs);
+
+	if (ret) {
+		unlink(tmppath);
+		return (ret);
+	}
+
+	/* the old mapping remains valid until unmap */
+	if (rename(tmppath, pix.path) != 0) {
+		unlink(tmppath);
+		return (3);
+	}
+
+	return (0);
+}
+
+/*
+* pindex_refresh - walk the project tree, rescan new and changed files by mtime and size,
+*	rewrite the index file if anything changed, force a full rebuild on request
+*/
+int
+pindex_refresh (int force)
+{
+	char root[FNAMESIZE];
+	unsigned char *bitmap = NULL;
+	unsigned e;
+	int id, ret=0;
+	int word;
+	long long t0 = msec_clock();
+
+	if (cnf.project[0] == '\0') {
+		return (1);
+	}
+	snprintf(pix.path, sizeof(pix.path), "%s%s.pidx", cnf.myhome, cnf.project);
+
+	if (pix.head == NULL && !force) {
+		pix_map();	/* maybe first time */
+	}
+
+	if (pix_find_opts(root, sizeof(root), &word)) {
+		/* the index would not give the same answer as the find pipe */
+		PD_LOG(LOG_INFO, "project index: find_opts not supported [%s]", cnf.find_opts);
+		pix_free_dirs();
+		return (1);
+	}
+	pix_free_dirs();
+	nents = 0;
+	ret = pix_walk(root, 0);
+	if (ret == 0 && nents > 1) {
+		qsort(ents, nents, sizeof(PIX_ENT), pix_cmp_ent);
+	}
+
+	pix.scanned = 0;
+	for (e=0; ret == 0 && e < nents; e++) {
+		id = (force || pix.head == NULL) ? -1 : pix_lookup(ents[e].name);
+		if (id >= 0 && pix.files[id].mtime == ents[e].mtime && pix.files[id].size == ents[e].size) {
+			ents[e].oldid = (uint32_t)id;
+			ents[e].flags = pix.files[id].flags;
+			continue;
+		}
+		if (bitmap == NULL) {
+			if ((bitmap = (unsigned char *) MALLOC(PIX_TRISPACE / 8)) == NULL) {
+				ERRLOG(0xE0C6);
+				ret = -1;
+				break;
+			}
+			memset(bitmap, 0, PIX_TRISPACE / 8);
+		}
+		ret = pix_scan(&ents[e], bitmap);
+		pix.scanned++;
+	}
+	FREE(bitmap);
+
+	if (ret == 0 && (force || pix.head == NULL || pix.scanned > 0 || nents != pix.head->nfiles)) {
+		ret = pix_write();
+		if (ret == 0) {
+			pix_unmap();
+			ret = pix_map();
+		}
+	}
+
+	for (e=0; e < nents; e++) {
+		FREE(ents[e].name);
+		FREE(ents[e].tri);
+	}
+	FREE(ents);
+	ents = NULL;
+	nents = ents_size = 0;
+	if (ret) {
+		pix_free_dirs();
+	}
+
+	pix.refresh_msec = msec_clock() - t0;
+	PD_LOG(LOG_INFO, "project index refresh: ret=%d, scanned %u files, %lld ms", ret, pix.scanned, pix.refresh_msec);
+
+	return (ret);
+}
+
+/*
+* the index is stale if it is not mapped, the tree was not walked in this session,
+* a directory of the walk or an indexed file has another mtime (or size) on the disk;
+* stat only, without reading the directories
+*/
+static int
+pix_stale (void)
+{
+	struct stat st;
+	unsigned d, i;
+
+	if (pix.head == NULL || ndirs == 0) {
+		return (1);
+	}
+	for (d=0; d < ndirs; d++) {
+		if (stat(dirs[d].name, &st) != 0 || pix_mtime(&st) != dirs[d].mtime)
+			return (1);
+	}
+	for (i=0; i < pix.head->nfiles; i++) {
+		if (stat(pix.strs + pix.files[i].name, &st) != 0 || pix_mtime(&st) != pix.files[i].mtime ||
+		(int64_t)st.st_size != pix.files[i].size)
+			return (1);
+	}
+	return (0);
+}
+
+/*
+* pindex_update - check the index for find and locate on every query, walk the tree
+*	and rescan the changed files only if it is stale; return 0 if the index is available
+*/
+int
+pindex_update (void)
+{
+	if (pix_stale()) {
+		return (pindex_refresh(0));
+	}
+	return (0);
+}
+
+/*
+* pindex_find_opts - check the find settings, the index gives the same answer only for
+*	the plain find program with the tests and egrep options of pix_find_opts();
+*	the whole word option goes to *word, return 0 if ok, 1 if the find pipe has to run
+*/
+int
+pindex_find_opts (int *word)
+{
+	char root[FNAMESIZE];
+	const char *p;
+
+	p = strrchr(cnf.find_path, '/');
+	p = (p == NULL) ? cnf.find_path : p+1;
+	if (strncmp(p, "find", 5) != 0) {
+		return (1);	/* a find script, with its own exclusions */
+	}
+	return (pix_find_opts(root, sizeof(root), word));
+}
+
+/*
+* binary search in the file table, return the file id or -1
+*/
+static int
+pix_lookup (const char *name)
+{
+	int lo, hi, mid, cmp;
+
+	if (pix.head == NULL) {
+		return (-1);
+	}
+	lo = 0;
+	hi = (int)pix.head->nfiles - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		cmp = strcmp(pix.strs + pix.files[mid].name, name);
+		if (cmp == 0) {
+			return (mid);
+		} else if (cmp < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return (-1);
+}
+
+/*
+* the filename relative to the working directory, like in the index
+*/
+static const char *
+pix_relname (const char *fpath)
+{
+	if (fpath[0] == '.' && fpath[1] == '/') {
+		return (fpath+2);
+	}
+	if (cnf.l1_pwd > 0 && strncmp(fpath, cnf._pwd, cnf.l1_pwd) == 0 && fpath[cnf.l1_pwd] == '/') {
+		return (fpath + cnf.l1_pwd + 1);
+	}
+	return (fpath);
+}
+
+/*
+* collect the trigrams of the literal parts of the regexp pattern, those are mandatory
+* for a match; only top level runs are used, alternation disables the preselection,
+* return the number of distinct trigrams
+*/
+static int
+pix_pattern_tri (const char *pattern, uint32_t *tri, int max)
+{
+	char lit[CMDLINESIZE];
+	int ll=0, depth=0, n=0, i, j;
+	const char *p;
+	uint32_t t;
+
+	for (p = pattern; ; p++) {
+		if (*p == '|' && depth == 0) {
+			return (0);
+		}
+		if (*p == '\0' || strchr("\\[()*?{+.^$|", *p) != NULL) {
+			/* special character, or the end */
+			if (*p == '*' || *p == '?' || *p == '{') {
+				/* the previous character is optional */
+				if (ll > 0)
+					ll--;
+			}
+			/* flush the literal run */
+			for (i=0; i+2 < ll && n < max; i++) {
+				t = ((uint32_t)(unsigned char)lit[i] << 16) |
+					((uint32_t)(unsigned char)lit[i+1] << 8) |
+					(uint32_t)(unsigned char)lit[i+2];
+				for (j=0; j < n && tri[j] != t; j++)
+					;
+				if (j == n)
+					tri[n++] = t;
+			}
+			ll = 0;
+
+			if (*p == '\0') {
+				break;
+			} else if (*p == '\\') {
+				if (p[1] == '\0') {
+					break;
+				} else if (strchr(".[]()*+?{}|^$\\/", p[1]) != NULL && depth == 0) {
+					/* escaped special character is literal, but the anchors
+					* like \< \> \` \' and the classes end the run */
+					lit[ll++] = (p[1] >= 'A' && p[1] <= 'Z') ? (char)(p[1] + 'a' - 'A') : p[1];
+				}
+				p++;
+			} else if (*p == '[') {
+				/* skip bracket expression */
+				p++;
+				if (*p == '^')
+					p++;
+				if (*p == ']')
+					p++;
+				while (*p != '\0' && *p != ']') {
+					if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+						p = strchr(p+2, ']');
+						if (p == NULL)
+							return (0);
+					}
+					p++;
+				}
+				if (*p == '\0')
+					break;
+			} else if (*p == '{') {
+				p = strchr(p, '}');
+				if (p == NULL)
+					break;
+			} else if (*p == '(') {
+				depth++;
+			} else if (*p == ')') {
+				if (depth > 0)
+					depth--;
+			}
+		} else if (depth == 0 && ll < (int)sizeof(lit)) {
+			lit[ll++] = (*p >= 'A' && *p <= 'Z') ? (char)(*p + 'a' - 'A') : *p;
+		}
+	}
+
+	return (n);
+}
+
+/*
+* pindex_query - select the candidate files of the pattern in the mapped index,
+*	return the number of candidates, or -1 if the index is not available
+*/
+int
+pindex_query (const char *pattern)
+{
+	uint32_t tri[PIX_MAXTRI];
+	int ntri, i, lo, hi, mid;
+	unsigned f, k;
+	const PIX_TRI *tp;
+	long long t0 = msec_clock();
+
+	if (pix.head == NULL) {
+		return (-1);
+	}
+	FREE(pix.cand);
+	if ((pix.cand = (unsigned char *) MALLOC(pix.head->nfiles+1)) == NULL) {
+		ERRLOG(0xE0C7);
+		return (-1);
+	}
+	memset(pix.cand, 0, pix.head->nfiles+1);
+	pix.candidates = 0;
+
+	ntri = pix_pattern_tri(pattern, tri, PIX_MAXTRI);
+	if (ntri == 0) {
+		/* every text file is a candidate */
+		for (f=0; f < pix.head->nfiles; f++) {
+			pix.cand[f] = (pix.files[f].flags & PIX_BINARY) ? 0 : 1;
+		}
+	} else {
+		/* intersection, the counter must be equal with the number of trigrams */
+		for (i=0; i < ntri; i++) {
+			lo = 0;
+			hi = (int)pix.head->ntri - 1;
+			tp = NULL;
+			while (lo <= hi) {
+				mid = (lo + hi) / 2;
+				if (pix.tris[mid].tri == tri[i]) {
+					tp = &pix.tris[mid];
+					break;
+				} else if (pix.tris[mid].tri < tri[i]) {
+					lo = mid + 1;
+				} else {
+					hi = mid - 1;
+				}
+			}
+			if (tp == NULL) {
+				memset(pix.cand, 0, pix.head->nfiles);
+				break;
+			}
+			for (k = tp->first; k < tp->first + tp->count; k++) {
+				if (pix.cand[pix.post[k]] == i)
+					pix.cand[pix.post[k]]++;
+			}
+		}
+		for (f=0; f < pix.head->nfiles; f++) {
+			pix.cand[f] = (pix.cand[f] == ntri) ? 1 : 0;
+		}
+	}
+
+	for (f=0; f < pix.head->nfiles; f++) {
+		pix.candidates += pix.cand[f];
+	}
+	pix.query_msec = msec_clock() - t0;
+
+	return ((int)pix.candidates);
+}
+
+/*
+* pindex_candidate - check the file against the last query,
+*	return 0 only if the file is indexed with the same mtime and cannot match
+*/
+int
+pindex_candidate (const char *fpath, const struct stat *st)
+{
+	int id;
+
+	if (pix.head == NULL || pix.cand == NULL) {
+		return (1);
+	}
+	id = pix_lookup(pix_relname(fpath));
+	if (id < 0 || pix.files[id].mtime != pix_mtime(st)) {
+		return (1);
+	}
+	return (pix.cand[id]);
+}
+
+/*
+* pindex_search - search pattern in the candidate files of the index, read the files from disk,
+*	append "fname:lineno:line" lines to the current buffer, like find/egrep does;
+*	word flag is for the whole word match (egrep -w)
+*/
+int
+pindex_search (const char *pattern, int word)
+{
+	int ret=0, rret=0, lineno, hits=0, files=0, found;
+	regex_t reg;
+	char errbuff[ERRBUFF_SIZE];
+	regmatch_t pmatch;
+	LINE *lp=NULL, *lx=NULL;
+	char one_line[1024];
+	FILE *fp=NULL;
+	char *buff=NULL;
+	size_t bsize=0;
+	ssize_t blen;
+	unsigned f;
+	regoff_t off;
+	const char *name;
+	long long t0 = msec_clock();
+
+	if (pindex_query(pattern) < 0) {
+		tracemsg("search index not available");
+		return (1);
+	}
+
+	memset (errbuff, 0, ERRBUFF_SIZE);
+	ret = regcomp (&reg, pattern, REGCOMP_OPTION);
+	if (ret) {
+		regerror(ret, &reg, errbuff, ERRBUFF_SIZE);
+		tracemsg("pattern [%s]: failed: %s", pattern, errbuff);
+		return (1);
+	}
+
+	/* header
+	*/
+	memset (one_line, 0, sizeof(one_line));
+	snprintf(one_line, sizeof(one_line)-1, "find %s\n", pattern);
+	if ((lp = insert_line_before (CURR_FILE.bottom, one_line)) != NULL) {
+		CURR_FILE.num_lines++;
+	} else {
+		ret = 2;
+	}
+
+	/* verify the candidates
+	*/
+	for (f=0; ret == 0 && f < pix.head->nfiles; f++) {
+		if (!pix.cand[f])
+			continue;
+		name = pix.strs + pix.files[f].name;
+		if ((fp = fopen(name, "r")) == NULL)
+			continue;
+		files++;
+		lineno = 0;
+		while (ret == 0 && (blen = getline(&buff, &bsize, fp)) > 0) {
+			lineno++;
+			found = 0;
+			off = 0;
+			while (off < blen) {
+				rret = regexec(&reg, buff + off, 1, &pmatch, (off > 0) ? REG_NOTBOL : 0);
+				if (rret != 0 || pmatch.rm_so < 0)
+					break;
+				pmatch.rm_so += off;
+				pmatch.rm_eo += off;
+				if (!word || ((pmatch.rm_so == 0 || !IS_ID(buff[pmatch.rm_so-1])) &&
+					!IS_ID(buff[pmatch.rm_eo])))
+				{
+					found = 1;
+					break;
+				}
+				off = pmatch.rm_so + 1;
+			}
+			if (!found)
+				continue;
+
+			snprintf(one_line, sizeof(one_line)-1, "%s:%d:\n", name, lineno);
+			if ((lx = append_line (lp, one_line)) == NULL) {
+				ret = 2;
+			} else {
+				CURR_FILE.num_lines++;
+				lp = lx;
+				if (buff[blen-1] == '\n')
+					blen--;
+				if (milbuff (lp, lp->llen-1, 0, buff, (int)blen)) {
+					ret = 2;
+				}
+				hits++;
+			}
+		}
+		fclose(fp);
+	}
+	FREE(buff);
+	regfree (&reg);
+
+	/* footer
+	*/
+	if (ret==0 && append_line (lp, "\n") != NULL) {
+		CURR_FILE.num_lines++;
+	}
+
+	/* pull and update
+	*/
+	CURR_LINE = CURR_FILE.bottom->prev;
+	CURR_FILE.lineno = CURR_FILE.num_lines;
+	update_focus(FOCUS_ON_LASTBUT1_LINE, cnf.ring_curr);
+
+	tracemsg("find: %d lines in %d of %u files (%lld ms, index query %lld ms)",
+		hits, files, pix.head->nfiles, msec_clock() - t0, pix.query_msec);
+
+	return (ret);
+}
+
+/*
+** pindex_cmd - refresh the project search index and show its statistics,
+**	rebuild from scratch with the "rebuild" argument
+*/
+int
+pindex_cmd (const char *args)
+{
+	char root[FNAMESIZE];
+	int ret=0, word;
+
+	if (cnf.project[0] == '\0') {
+		tracemsg("no project, no search index");
+		return (1);
+	}
+	if (pix_find_opts(root, sizeof(root), &word)) {
+		tracemsg("no search index with these find_opts [%s]", cnf.find_opts);
+		return (1);
+	}
+
+	ret = pindex_refresh(strncmp(args, "rebuild", 7) == 0);
+	if (ret || pix.head == NULL) {
+		tracemsg("search index refresh failed [%s]", pix.path);
+		return (1);
+	}
+
+	tracemsg("search index [%s]: %u files, %u trigrams, %u postings, %lu bytes",
+		pix.path, pix.head->nfiles, pix.head->ntri, pix.head->npost, (unsigned long)pix.mapsize);
+	tracemsg("last refresh %lld ms (%u files scanned, write %u ms), last query %lld ms (%u candidates)",
+		pix.refresh_msec, pix.scanned, pix.head->build_msec, pix.query_msec, pix.candidates);
+
+	return (0);
+}
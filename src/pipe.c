@@ -47,6 +47,7 @@ static int filter_cmd_eng (const char *ext_cmd, int opts);
 static int fork_exec (const char *ext_cmd, const char *ext_argstr, int *in_pipe, int *out_pipe, int opts);
 static int finish_in_fg (void);
 static int getxline (char *buff, int *count, int max, int fd);
+static int find_buffer (int ring_i);
 
 /*
 ** shell_cmd - launch shell to run given command with the optional arguments and catch output to buffer
@@ -148,6 +149,8 @@ find_cmd (const char *ext_cmd)
 	char temp[CMDLINESIZE];
 	char *word=NULL;
 	char delim;
+	int ring_i = cnf.ring_curr;
+	int whole=0;
 
 	if (cnf.find_path[0] == '\0') {
 		tracemsg("find path not configured");
@@ -167,9 +170,10 @@ find_cmd (const char *ext_cmd)
 				return (1);
 			}
 		}
+		strncpy (temp, ((word[0] == '.' || word[0] == '>') ? word+1 : word), sizeof(temp));
+		temp[sizeof(temp)-1] = '\0';
 		snprintf(ext_argstr, sizeof(ext_argstr)-1, "find %s %s '%s' {} ;",
-			cnf.find_opts, ((cnf.gstat & GSTAT_CASES) ? "" : "-i"),
-			((word[0] == '.' || word[0] == '>') ? word+1 : word));
+			cnf.find_opts, ((cnf.gstat & GSTAT_CASES) ? "" : "-i"), temp);
 		FREE(word); word = NULL;
 	} else {
 		/* arg. from commandline */
@@ -180,6 +184,19 @@ find_cmd (const char *ext_cmd)
 			cnf.find_opts, ((cnf.gstat & GSTAT_CASES) ? "" : "-i"), delim, temp, delim);
 	}
 
+	if (pindex_active() && pindex_find_opts(&whole) == 0 && pindex_update() == 0) {
+		/* answer from the project search index, verify the candidate files only
+		*/
+		if ((ret = find_buffer(ring_i)) != 0) {
+			return ((ret == -1) ? 0 : ret);
+		}
+		ret = pindex_search (temp, whole);
+		if (ret) {
+			ret |= drop_file();
+		}
+		return (ret);
+	}
+
 	ret = read_pipe ("*find*", cnf.find_path, ext_argstr, OPT_REDIR_ERR);
 
 	return (ret);
@@ -222,6 +239,77 @@ locate_cmd (const char *expr)
 		regexp_shorthands (temp, pattern, sizeof(pattern));
 	}
 
+	if ((ret = find_buffer(ring_i)) != 0) {
+		return ((ret == -1) ? 0 : ret);
+	}
+
+	/* start the engine
+	*/
+	ret = internal_search (pattern);
+
+	if (ret) {
+		ret |= drop_file();
+	}
+
+	return (ret);
+}
+
+/*
+** refs_cmd - search the references of the symbol in the source files of the loaded tags,
+**	literal whole word match on worker threads, the hits are streamed into the *find* buffer;
+**	the symbol is the argument or the word under the cursor
+*/
+int
+refs_cmd (const char *symbol)
+{
+	int ret=0;
+	char temp[TAGSTR_SIZE];
+	char *word=NULL;
+	int ring_i = cnf.ring_curr;
+
+	if (cnf.tagdb == NULL) {
+		tracemsg ("tags file [%s] not loaded", cnf.tags_file);
+		return (1);
+	}
+
+	if (symbol[0] == '\0') {
+		word = select_word(CURR_LINE, CURR_FILE.lncol);
+		if (word == NULL || word[0] == '\0') {
+			FREE(word); word = NULL;
+			tracemsg ("no symbol given");
+			return (1);
+		}
+		strncpy (temp, ((word[0] == '.' || word[0] == '>') ? word+1 : word), sizeof(temp));
+		temp[sizeof(temp)-1] = '\0';
+		FREE(word); word = NULL;
+	} else {
+		cut_delimiters (symbol, temp, sizeof(temp));
+	}
+
+	if ((ret = find_buffer(ring_i)) != 0) {
+		return ((ret == -1) ? 0 : ret);
+	}
+
+	/* start the engine
+	*/
+	ret = tag_refs_search (temp);
+
+	if (ret) {
+		ret |= drop_file();
+	}
+
+	return (ret);
+}
+
+/*
+* open or switch to the *find* buffer for internal search,
+* return -1 if a background process is still running there
+*/
+static int
+find_buffer (int ring_i)
+{
+	int ret=0;
+
 	/* open or switch to */
 	if ((ret = scratch_buffer("*find*")) != 0) {
 		return (ret);
@@ -230,7 +318,7 @@ locate_cmd (const char *expr)
 	if (CURR_FILE.pipe_output != 0) {
 		tracemsg("background process still running!");
 		cnf.ring_curr = ring_i;
-		return (0);
+		return (-1);
 	}
 	/* additional flags */
 	CURR_FILE.fflag |= FSTAT_SPECW;
@@ -242,15 +330,7 @@ locate_cmd (const char *expr)
 		CURR_FILE.origin = ring_i;
 	}
 
-	/* start the engine
-	*/
-	ret = internal_search (pattern);
-
-	if (ret) {
-		ret |= drop_file();
-	}
-
-	return (ret);
+	return (0);
 }
 
 /*
@@ -833,7 +913,7 @@ read_pipe (const char *sbufname, const char *ext_cmd, const char *ext_argstr, in
 			/* append goes after bottom->prev, so force pull up current */
 			CURR_FILE.curr_line = CURR_FILE.bottom->prev;
 			CURR_FILE.lineno = CURR_FILE.num_lines;
-			CURR_LINE->lflag &= ~LMASK(cnf.ring_curr);	/* unhide */
+			lll_unhide(CURR_LINE, LMASK(cnf.ring_curr));	/* unhide */
 			update_focus(INCR_FOCUS, cnf.ring_curr);
 		}
 
@@ -925,6 +1005,7 @@ readout_pipe (int ring_i)
 				if ((lx = append_line (lp, rb)) != NULL) {
 					lp = lx;
 					cnf.fdata[ring_i].num_lines++;
+					LINES_CHANGED(ring_i);
 				} else {
 					ret = -1;
 				}
@@ -950,6 +1031,7 @@ readout_pipe (int ring_i)
 				*/
 				if (insert_line_before (cnf.fdata[ring_i].bottom, "\n") != NULL) {
 					cnf.fdata[ring_i].num_lines++;
+					LINES_CHANGED(ring_i);
 				} else {
 					ret = -1;
 				}
@@ -968,7 +1050,7 @@ readout_pipe (int ring_i)
 		if (ret==0 && pull) {
 			cnf.fdata[ring_i].curr_line = cnf.fdata[ring_i].bottom->prev;
 			cnf.fdata[ring_i].lineno = cnf.fdata[ring_i].num_lines;
-			cnf.fdata[ring_i].curr_line->lflag &= ~LMASK(cnf.ring_curr);
+			lll_unhide(cnf.fdata[ring_i].curr_line, LMASK(cnf.ring_curr));
 			update_focus(FOCUS_ON_LASTBUT1_LINE, ring_i);
 		}
 	}
@@ -218,13 +218,18 @@ extern int filter_all (const char *expr);		/* public, macro */
 extern int filter_more (const char *expr);		/* public, macro */
 extern int filter_less (const char *expr);		/* public, macro */
 extern int filter_m1 (void);				/* public */
+extern int filter_context (const char *arg);		/* public */
 extern int filter_base (int action, const char *expr);
 #define PURIFY_CLANG 2
 #define PURIFY_OTHER 4
 extern int filter_func (int action, int fmask);
 extern void purify_for_matching_clang (char *outb, const char *inbuff, int len);
 extern void purify_for_matching_other (char *outb, const char *inbuff, int len);
+extern int c_header_regcomp (regex_t *regs);
+extern void c_header_regfree (regex_t *regs);
+extern int c_header_test (const char *buff, int llen, int lncol, int at_brace, const regex_t *regs, regmatch_t *pmatch);
 extern char *block_name (int ri);
+extern int outline (void);				/* public */
 extern int filter_tmp_all (void);			/* public */
 extern int filter_expand_up (void);			/* public */
 extern int filter_expand_down (void);			/* public */
@@ -233,7 +238,16 @@ extern int incr_filter_level (void);			/* public */
 extern int incr2_filter_level (void);			/* public */
 extern int decr_filter_level (void);			/* public */
 extern int decr2_filter_level (void);			/* public */
+extern int filter_intersect (const char *arg);		/* public */
+extern int filter_union (const char *arg);		/* public */
+extern int view_write (int ri, const char *name);
+extern int view_read (const char *name);
+extern int view_save (const char *name);		/* public */
+extern int view_load (const char *name);		/* public */
 extern int common_space (int length);
+extern void cblocks_drop (int ri);
+extern void lcache_drop (int ri);
+extern void openers_drop (int ri);
 extern int tomatch (void);				/* public */
 #define TOMATCH_DONT_SET_FOCUS 0
 #define TOMATCH_SET_FOCUS 1
@@ -250,6 +264,22 @@ extern LINE *lll_rm (LINE *line_p);
 extern LINE *lll_mv (LINE *lp_src, LINE *lp_trg);
 extern LINE *lll_mv_before (LINE *lp_src, LINE *lp_trg);
 extern LINE *lll_goto_lineno (int ri, int lineno);
+extern int lll_ri (const LINE *lp);
+extern int lll_lineno (const LINE *lp);
+extern int lll_index_init (int ri, LINE *top);
+extern void lll_index_drop (int ri);
+extern int lll_hidden (const LINE *lp, int fmask);
+extern void lll_hide (LINE *lp, int fmask);
+extern void lll_unhide (LINE *lp, int fmask);
+extern int lll_hide_get (const LINE *lp);
+extern void lll_hide_put (LINE *lp, int fmask);
+extern int lll_hide_find (int ri, int level, int from, int to, int hidden);
+extern int lll_hide_rfind (int ri, int level, int from, int to, int hidden);
+extern void lll_hide_range (int ri, int level, int from, int to, int hidden);
+extern void lll_hide_copy (int ri, int dst, int src);
+extern void lll_hide_combine (int ri, int dst, int src, int intersect);
+extern LINE *lll_next_visible (const LINE *lp, int level, int *count);
+extern LINE *lll_prev_visible (const LINE *lp, int level, int *count);
 
 /* main.c */
 extern void tracemsg (const char *format, ...);
@@ -262,6 +292,7 @@ extern int make_cmd (const char *opts);			/* public */
 extern int vcstool (const char *ext_cmd);		/* public */
 extern int find_cmd (const char *ext_cmd);		/* public */
 extern int locate_cmd (const char *expr);		/* public */
+extern int refs_cmd (const char *symbol);		/* public */
 extern int filter_cmd (const char *ext_cmd);		/* public */
 extern int filter_shadow_cmd (const char *ext_cmd);	/* public */
 extern int lsdir_cmd (const char *ext_cmd);		/* public */
@@ -274,6 +305,17 @@ extern int background_pipes (void);
 extern int wait4_bg (int ring_i);
 extern int stop_bg_process (void);			/* public */
 
+/* pindex.c */
+extern int pindex_active (void);
+extern void pindex_drop (void);
+extern int pindex_refresh (int force);
+extern int pindex_update (void);
+extern int pindex_find_opts (int *word);
+extern int pindex_query (const char *pattern);
+extern int pindex_candidate (const char *fpath, const struct stat *st);
+extern int pindex_search (const char *pattern, int word);
+extern int pindex_cmd (const char *args);		/* public */
+
 /* rc.c */
 extern int set (const char *argz);			/* public */
 extern int process_rcfile (int noconfig);
@@ -283,6 +325,7 @@ extern void drop_macros (void);
 extern int reload_macros (void);			/* public */
 extern int process_project (int noconfig);
 extern int save_project (const char *projectname);	/* public */
+extern char *project_filelist (void);
 extern int load_rcfile (void);				/* public */
 extern int load_keyfile (void);				/* public */
 extern int load_macrofile (void);			/* public */
@@ -307,6 +350,7 @@ extern int filter_regex (int action, int fmask, const char *expr);
 extern int regexp_match (const char *buff, const char *expr, int nsub, char *match);
 extern int internal_search (const char *pattern);
 extern LINE *search_goto_pattern (int ri, const char *pattern, int *new_lineno);
+extern int search_line_pattern (const LINE *lx, const char *pattern);
 extern int color_tag (const char *expr);		/* public */
 extern int highlight_word (const char *expr);		/* public */
 extern void cut_delimiters (const char *expr, char *expr_new, int length);
@@ -315,8 +359,10 @@ extern int tag_focusline (void);			/* public */
 extern int search (const char *expr);			/* public */
 extern int reset_search (void);
 extern int repeat_search (void);			/* public */
+extern void incsearch_update (int typed);
 extern int change (const char *argz);			/* public */
 extern int repeat_change (int ch);
+extern int changeall (const char *argz);		/* public */
 
 /* select.c */
 extern int line_select (void);				/* public */
@@ -351,9 +397,13 @@ extern int join_block (const char *separator);		/* public */
 /* tags.c */
 extern int tag_load_file (const char *tags_file);	/* public */
 extern int tag_rm_all (void);
+extern int tag_reload_check (void);
 extern int tag_view_info (const char *arg_symbol);	/* public */
 extern int tag_jump_to (const char *arg_symbol);	/* public */
 extern int tag_jump_back (void);			/* public */
+extern int tag_make (const char *args);			/* public */
+extern int tag_complete (char *word, unsigned maxsize, char **choices);
+extern int tag_refs_search (const char *symbol);
 
 /* util.c */
 extern int get_rest_of_line (char **, int *, const char *, int, int);
@@ -378,5 +428,6 @@ extern char *canonicalpath (const char *path);
 extern int parse_args (char *input, char **args);
 extern int pidof (const char *progname);
 extern int is_process_alive (int pid);
+extern long long msec_clock (void);
 
 #endif
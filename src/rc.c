@@ -83,16 +83,18 @@ set_usage (int show_what)
 			cnf.make_path, cnf.make_opts);
 		tracemsg ("sh path %s diff path [%s]",
 			cnf.sh_path, cnf.diff_path);
-		tracemsg ("tags file [%s] lsdirsort %d",
-			cnf.tags_file, cnf.lsdirsort); 
+		tracemsg ("tags file [%s] lsdirsort %d project_index %d incsearch %d",
+			cnf.tags_file, cnf.lsdirsort,
+			(cnf.gstat & GSTAT_PINDEX) ? 1 : 0,
+			(cnf.gstat & GSTAT_INCSEARCH) ? 1 : 0);
 		tracemsg ("...see other settings in rcfile");
 	} else if (show_what == SHOW_USAGE) {
 		tracemsg ("set {prefix | tabhead | shadow | smartindent | move_reset | case_sensitive} {on|off}");
 		tracemsg ("set {tabsize COUNT} | {indent {tab|space} COUNT}");
-		tracemsg ("set {autotitle | backup_nokeep | close_over | save_inode } {yes|no}");
+		tracemsg ("set {autotitle | backup_nokeep | close_over | save_inode | project_index | incsearch} {yes|no}");
 		tracemsg ("set {find_opts OPTIONS}");
 		tracemsg ("set {make_opts OPTS}");
-		tracemsg ("set {tags_file FILE}");
+		tracemsg ("set {tags_file FILE[:FILE...]}");
 		tracemsg ("...other settings in rcfile");
 	}
 }
@@ -248,6 +250,14 @@ set (const char *argz)
 		SET_CHECK_B( GSTAT_SAV_INODE );
 		if (cnf.bootup) tracemsg ("save_inode %d", (cnf.gstat & GSTAT_SAV_INODE) ? 1 : 0);
 
+	} else if (strncmp(token, "project_index", 13)==0) {
+		SET_CHECK_B( GSTAT_PINDEX );
+		if (cnf.bootup) tracemsg ("project_index %d", (cnf.gstat & GSTAT_PINDEX) ? 1 : 0);
+
+	} else if (strncmp(token, "incsearch", 9)==0) {
+		SET_CHECK_B( GSTAT_INCSEARCH );
+		if (cnf.bootup) tracemsg ("incsearch %d", (cnf.gstat & GSTAT_INCSEARCH) ? 1 : 0);
+
 	} else if (strncmp(token, "tabsize", 4)==0) {
 		/* decimal */
 		if (sublen > 0) {
@@ -932,6 +942,13 @@ process_project (int noconfig)
 				}
 				continue;
 			}
+			/* settings after a filename: saved filter view, ignored if the file changed */
+			if (strncmp(str, "view=", 5) == 0) {
+				if (cnf.ring_size > 0 && CURR_FILE.fflag & FSTAT_OPEN) {
+					view_read(str+5);
+				}
+				continue;
+			}
 			/**/
 			ret = simple_parser(str, SIMPLE_PARSER_JUMP);
 			if (ret) ret += 200;
@@ -941,13 +958,18 @@ process_project (int noconfig)
 
 	if (ret) {
 		fprintf(stderr, "eda: processing [%s] failed (ret=%d), line=%d\n", projfile, ret, pline);
+	} else if (pindex_active()) {
+		/* incremental update of the search index, not fatal */
+		if (pindex_refresh(0)) {
+			fprintf(stderr, "eda: project search index refresh failed\n");
+		}
 	}
 	return (ret);
 }/* process_project */
 
 /*
 ** save_project - save project file in the ~/.eda/ directory,
-**	last used project name can be omitted
+**	last used project name can be omitted; the filter view of the filtered buffers is saved also
 */
 int
 save_project (const char *projectname)
@@ -1045,6 +1067,12 @@ save_project (const char *projectname)
 				snprintf(str, sizeof(str)-1, "%s:%d\nfocus=%d\n",
 					cnf.fdata[ri].fname, cnf.fdata[ri].lineno, cnf.fdata[ri].focus);
 				len = strlen(str);
+				/* the filtered view of the unchanged file */
+				if (LMASK(ri) && view_write(ri, (projectname[0] != '\0') ? projectname : cnf.project) == 0) {
+					snprintf(str+len, sizeof(str)-1-len, "view=%s\n",
+						(projectname[0] != '\0') ? projectname : cnf.project);
+					len = strlen(str);
+				}
 				if (fwrite (str, sizeof(char), len, fp) != len) {
 					ERRLOG(0xE0A4);
 					ret = 2;
@@ -1069,6 +1097,73 @@ save_project (const char *projectname)
 	return (ret);
 }/* save_project */
 
+/*
+* project_filelist - collect the filenames from the files section of the current project file,
+* return them newline separated in a malloc'd buffer, or NULL if not available
+*/
+char *
+project_filelist (void)
+{
+	char projfile[sizeof(cnf.myhome)+SHORTNAME];
+	FILE *fp;
+	char str[CMDLINESIZE];
+	char *list=NULL, *s;
+	unsigned als=0, dlen=0;
+	int section = 0;	/* 2 for project files */
+	int len, i;
+
+	if (cnf.project[0] == '\0') {
+		return (NULL);
+	}
+	strncpy(projfile, cnf.myhome, sizeof(projfile));
+	strncat(projfile, cnf.project, SHORTNAME-6);
+	strncat(projfile, ".proj", 6);
+
+	if ((fp = fopen(projfile, "r")) == NULL) {
+		return (NULL);
+	}
+
+	while (fgets (str, CMDLINESIZE, fp) != NULL) {
+		len = strlen(str);
+		if (len > 0 && str[len-1] == '\n')
+			str[--len] = '\0';
+		strip_blanks (STRIP_BLANKS_FROM_END|STRIP_BLANKS_FROM_BEGIN, str, &len);
+		if (section == 0) {
+			if (strncmp(str, PROJECT_FILES, strlen(PROJECT_FILES)) == 0)
+				section = 2;
+			continue;
+		}
+		if (len == 0 || str[0] == '#' || strncmp(str, "focus=", 6) == 0) {
+			continue;
+		}
+		/* cut the line number, filename:12345 */
+		for (i=len-1; i > 0 && str[i] >= '0' && str[i] <= '9'; i--)
+			;
+		if (i > 0 && i < len-1 && str[i] == ':') {
+			str[i] = '\0';
+			len = i;
+		}
+		if (dlen + (unsigned)len + 2 > als) {
+			als = ALLOCSIZE(dlen + (unsigned)len + 2);
+			s = (char *) REALLOC((void *)list, als);
+			if (s == NULL) {
+				ERRLOG(0xE0CC);
+				FREE(list);
+				list = NULL;
+				break;
+			}
+			list = s;
+		}
+		memcpy(list+dlen, str, (size_t)len);
+		dlen += (unsigned)len;
+		list[dlen++] = '\n';
+		list[dlen] = '\0';
+	}
+	fclose(fp);
+
+	return (list);
+}/* project_filelist */
+
 /*
 ** load_rcfile - open ~/.eda/edarc resource file,
 **	changes in the file are activated at next run
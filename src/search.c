@@ -23,7 +23,12 @@
 #include <config.h>
 #include <string.h>
 #include <stdlib.h>	/* atoi */
+#include <stdio.h>
+#include <sys/stat.h>
 #include <syslog.h>
+#include <time.h>
+#include <unistd.h>	/* sysconf */
+#include <pthread.h>
 #include "main.h"
 #include "proto.h"
 
@@ -36,24 +41,201 @@ extern CONFIG cnf;
 
 /* local proto */
 static int repeat_search_eng (void);
+static int split_change_args (char *expr_tmp, char **expr, char **repl_expr);
+static int incsearch_match (LINE *lx, int xcol, regmatch_t *pmatch);
+static int incsearch_narrows (const char *old_expr, const char *new_expr);
+static void incsearch_origin (void);
+static void incsearch_drop (int restore);
 static int search_for_replace (CHDATA *chp);
+static int match_for_replace (CHDATA *chp);
+static int replace_rest (CHDATA *chp);
+static int replace_line (CHDATA *chp, char **outp, unsigned *alsp, int *olenp);
 static int accum_replacement (CHDATA *chp);
 static int do_replacement (CHDATA *chp);
+static int changeall_chdata (CHDATA *chp);
+static int changeall_list_line (CHDATA *chp, const char *fname, int lineno, LINE **lpp, char **outp, unsigned *alsp);
+static int changeall_scan_file (CHDATA *chp, const char *fname, LINE **lpp, int *nlines);
+static int changeall_save_file (const struct stat *sp);
+static int changeall_find_file (const struct stat *sp);
+static int changeall_preview (void);
+static int changeall_apply (void);
 
 /* regexp specials are ^.[$()|*+?{\\ and maybe }] */
 /* regexp shorthands (extensions like in other regex tools) are \w \W \s \S \d \D and \t */
 static int repeat_search_initial_call=0;
 
+/* incremental search session, while the search command is typed */
+typedef struct {
+	LINE *lx;
+	int lineno;
+} INCMATCH;
+static int inc_ri = -1;			/* ring index of the session, -1 if none */
+static LINE *inc_origin_lx = NULL;	/* the position before the session */
+static int inc_origin_lineno=0, inc_origin_lncol=0, inc_origin_focus=0;
+static int inc_num_lines=0, inc_fmask=0;	/* the match set is valid for these */
+static char inc_expr[XPATTERN_SIZE];	/* pattern of the match set, empty if none */
+static INCMATCH *inc_set = NULL;	/* matching visible lines, in buffer order */
+static int inc_nset=0, inc_aset=0;
+
+/* the changeall waiting for confirmation */
+static int ca_pending=0;		/* 1 for open buffers, 2 with project files */
+static regex_t ca_reg;
+static int ca_anchor=0;
+static char ca_repl[XPATTERN_SIZE];
+static char ca_args[CMDLINESIZE];
+static unsigned ca_lgen[RINGSIZE];	/* lgen of the target buffers at the preview, 0 for others */
+
+/* the project files with match in the preview, with their state on disk */
+typedef struct {
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtim;
+	off_t size;
+} CAFILE;
+static CAFILE *ca_files = NULL;
+static int ca_nfiles=0, ca_afiles=0;
+
+/* one chunk of lines for the parallel regex filter */
+typedef struct {
+	pthread_t tid;
+	LINE **lines;		/* the lines of the buffer, shared */
+	char *hits;		/* match results, shared, each worker writes its own range */
+	int from, to;		/* the range [from,to) */
+	const char *expr;	/* the expanded pattern, each worker compiles its own regex_t */
+	int cflags;
+	int done;		/* lines done, with fpar_lock */
+	int finished;		/* worker returned, with fpar_lock */
+	int err;		/* regcomp failed in the worker, the hits of the chunk are not valid */
+	int started;
+} FPARCHUNK;
+static pthread_mutex_t fpar_lock = PTHREAD_MUTEX_INITIALIZER;
+static int fpar_cancel=0;	/* with fpar_lock */
+
+/*
+ * worker thread of the parallel regex filter, evaluate the pattern on the chunk
+ */
+static void *
+filter_regex_worker (void *arg)
+{
+	FPARCHUNK *chunk = (FPARCHUNK *) arg;
+	regex_t reg;
+	regmatch_t pmatch;
+	int i, stop=0;
+
+	if (regcomp (&reg, chunk->expr, chunk->cflags) == 0) {
+		for (i = chunk->from; i < chunk->to && !stop; i++) {
+			chunk->hits[i] = (regexec(&reg, chunk->lines[i]->buff, 1, &pmatch, 0) == 0 &&
+				pmatch.rm_so >= 0 && (pmatch.rm_eo == 0 || pmatch.rm_so < pmatch.rm_eo));
+			if ((i - chunk->from) % FILTER_PAR_STEP == FILTER_PAR_STEP-1) {
+				pthread_mutex_lock (&fpar_lock);
+				chunk->done = i - chunk->from + 1;
+				stop = fpar_cancel;
+				pthread_mutex_unlock (&fpar_lock);
+			}
+		}
+		regfree (&reg);
+	} else {
+		chunk->err = 1;
+	}
+
+	pthread_mutex_lock (&fpar_lock);
+	chunk->done = chunk->to - chunk->from;
+	chunk->finished = 1;
+	pthread_mutex_unlock (&fpar_lock);
+	return (NULL);
+}
+
+/*
+ * parallel regex filter for large buffers: split the lines into contiguous chunks,
+ * evaluate the pattern on worker threads, show progress and cancel on keypress,
+ * the hide bits are set by the caller from the hits[] array, valid only if 0 is returned;
+ * return 0 if ok, 1 if cancelled, 2 on error (the caller may go on sequentially)
+ */
+static int
+filter_regex_par (const char *expr_new, LINE **lines, char *hits, int nlines)
+{
+	FPARCHUNK chunk[FILTER_PAR_THREADS];
+	int nth, i, done, finished, ret=0;
+	long ncpu;
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	nth = (ncpu > FILTER_PAR_THREADS) ? FILTER_PAR_THREADS : (int)ncpu;
+	if (nth < 2)
+		return (2);
+
+	fpar_cancel = 0;
+	memset (chunk, 0, sizeof(chunk));
+	for (i=0; i < nth; i++) {
+		chunk[i].lines = lines;
+		chunk[i].hits = hits;
+		chunk[i].from = (int)((long long)nlines * i / nth);
+		chunk[i].to = (int)((long long)nlines * (i+1) / nth);
+		chunk[i].expr = expr_new;
+		chunk[i].cflags = REGCOMP_OPTION;
+		if (pthread_create (&chunk[i].tid, NULL, filter_regex_worker, &chunk[i]) != 0) {
+			ERRLOG(0xE0CF);
+			ret = 2;
+			break;
+		}
+		chunk[i].started = 1;
+	}
+	if (ret) {
+		pthread_mutex_lock (&fpar_lock);
+		fpar_cancel = 1;
+		pthread_mutex_unlock (&fpar_lock);
+	}
+
+	/* progress and cancel, wgetch() waits for CUST_WTIMEOUT */
+	for (;;) {
+		done = finished = 0;
+		pthread_mutex_lock (&fpar_lock);
+		for (i=0; i < nth; i++) {
+			done += chunk[i].done;
+			finished += (!chunk[i].started || chunk[i].finished);
+		}
+		pthread_mutex_unlock (&fpar_lock);
+		if (finished == nth)
+			break;
+		if (ret == 0 && cnf.bootup) {
+			tracemsg("filter: %d%% of %d lines, %d threads -- press any key to cancel",
+				(int)((long long)done * 100 / nlines), nlines, nth);
+			upd_trace ();
+			doupdate ();
+			if (wgetch (stdscr) != ERR) {
+				pthread_mutex_lock (&fpar_lock);
+				fpar_cancel = 1;
+				pthread_mutex_unlock (&fpar_lock);
+				ret = 1;
+			}
+		} else {
+			usleep (CUST_WTIMEOUT * 1000);
+		}
+	}
+	for (i=0; i < nth; i++) {
+		if (chunk[i].started)
+			pthread_join (chunk[i].tid, NULL);
+		if (ret == 0 && chunk[i].err) {
+			ERRLOG(0xE0DD);
+			ret = 2;
+		}
+	}
+
+	FILT_LOG(LOG_INFO, "parallel filter: ret=%d, %d lines, %d threads", ret, nlines, nth);
+	return (ret);
+}
+
 /*
  * filtering with regular expression
  */
 int
 filter_regex (int action, int fmask, const char *expr)
 {
-	int ret=0;
+	int ret=0, i, nlines;
 	regex_t reg;
 	char errbuff[ERRBUFF_SIZE];
 	LINE *lx;
+	LINE **lines;
+	char *hits;
 	regmatch_t pmatch;
 	char expr_tmp[XPATTERN_SIZE];
 	char expr_new[XPATTERN_SIZE];
@@ -66,22 +248,65 @@ filter_regex (int action, int fmask, const char *expr)
 		regerror(ret, &reg, errbuff, ERRBUFF_SIZE);
 		/* external */
 		tracemsg("pattern [%s]: failed: %s", expr_new, errbuff);
-	} else {
-		lx = CURR_FILE.top->next;
-		while (TEXT_LINE(lx)) {
-			ret = regexec(&reg, lx->buff, 1, &pmatch, 0);
-			if (ret == 0 && pmatch.rm_so >= 0 &&
-				(pmatch.rm_eo == 0 || pmatch.rm_so < pmatch.rm_eo))
-			{
-				if (action & (FILTER_MORE | FILTER_ALL))
-					lx->lflag &= ~fmask;
-				else if (action & FILTER_LESS)
-					lx->lflag |= fmask;
-			} else if (action & FILTER_ALL) {
-				lx->lflag |= fmask;
+		regfree (&reg);
+		return (0);
+	}
+
+	/* large buffer: match on worker threads, apply the bits here */
+	nlines = CURR_FILE.num_lines;
+	if (nlines >= FILTER_PAR_LINES) {
+		lines = (LINE **) MALLOC(sizeof(LINE *) * (size_t)nlines);
+		hits = (char *) MALLOC((size_t)nlines);
+		if (lines != NULL && hits != NULL) {
+			memset (hits, 0, (size_t)nlines);
+			nlines = 0;
+			lx = CURR_FILE.top->next;
+			while (TEXT_LINE(lx) && nlines < CURR_FILE.num_lines) {
+				lines[nlines++] = lx;
+				lx = lx->next;
 			}
-			lx = lx->next;
+			ret = filter_regex_par (expr_new, lines, hits, nlines);
+			if (ret == 0) {
+				for (i=0; i < nlines; i++) {
+					if (hits[i]) {
+						if (action & (FILTER_MORE | FILTER_ALL))
+							lll_unhide(lines[i], fmask);
+						else if (action & FILTER_LESS)
+							lll_hide(lines[i], fmask);
+					} else if (action & FILTER_ALL) {
+						lll_hide(lines[i], fmask);
+					}
+				}
+			} else if (ret == 1) {
+				tracemsg("filter cancelled, lines unchanged");
+			}
+		} else {
+			ERRLOG(0xE0D0);
+			ret = 2;
+		}
+		FREE(lines);
+		FREE(hits);
+		if (ret != 2) {
+			regfree (&reg);
+			return (0);
+		}
+	}
+
+	/* sequential */
+	lx = CURR_FILE.top->next;
+	while (TEXT_LINE(lx)) {
+		ret = regexec(&reg, lx->buff, 1, &pmatch, 0);
+		if (ret == 0 && pmatch.rm_so >= 0 &&
+			(pmatch.rm_eo == 0 || pmatch.rm_so < pmatch.rm_eo))
+		{
+			if (action & (FILTER_MORE | FILTER_ALL))
+				lll_unhide(lx, fmask);
+			else if (action & FILTER_LESS)
+				lll_hide(lx, fmask);
+		} else if (action & FILTER_ALL) {
+			lll_hide(lx, fmask);
 		}
+		lx = lx->next;
 	}
 	regfree (&reg);
 
@@ -152,7 +377,7 @@ internal_search (const char *pattern)
 	regex_t reg;
 	char errbuff[ERRBUFF_SIZE];
 	regmatch_t pmatch;
-	int ri, ri_lineno;
+	int ri, ri_lineno, use_index=0;
 	LINE *lp=NULL, *lx=NULL, *ri_lp=NULL;
 	char one_line[1024];
 
@@ -178,11 +403,19 @@ internal_search (const char *pattern)
 		ret = 2;
 	}
 
-	/* scan all lines of regular files in the ring
+	/* preselect files with the project search index
+	*/
+	if (pindex_active() && pindex_update() == 0) {
+		use_index = (pindex_query(pattern) >= 0);
+	}
+
+	/* scan all lines of regular files in the ring,
+	* skip unchanged buffers if the index says the file has no match
 	*/
 	lp = CURR_LINE = CURR_FILE.bottom->prev;
 	for (ri=0; ret==0 && ri<RINGSIZE; ri++) {
-		if ((cnf.fdata[ri].fflag & FSTAT_OPEN) && !(cnf.fdata[ri].fflag & FSTAT_SPECW))
+		if ((cnf.fdata[ri].fflag & FSTAT_OPEN) && !(cnf.fdata[ri].fflag & FSTAT_SPECW) &&
+		(!use_index || (cnf.fdata[ri].fflag & FSTAT_CHANGE) || pindex_candidate(cnf.fdata[ri].fpath, &cnf.fdata[ri].stat)))
 		{
 			ri_lp = cnf.fdata[ri].top->next;
 			ri_lineno = 1;
@@ -275,6 +508,34 @@ search_goto_pattern (int ri, const char *pattern, int *new_lineno)
 	return (lx);	/* *new_lineno also */
 }
 
+/*
+ * check one line against the pattern, prepared like for search_goto_pattern()
+ * return 1 if the line matches, 0 otherwise
+ */
+int
+search_line_pattern (const LINE *lx, const char *pattern)
+{
+	int ret=1;
+	regex_t reg;
+	char expr_tmp[XPATTERN_SIZE];
+	char expr_new[XPATTERN_SIZE];
+
+	if (!TEXT_LINE(lx) || pattern == NULL)
+		return 0;
+
+	/* no delimiters, just copy */
+	strncpy (expr_tmp, pattern, sizeof(expr_tmp));
+	expr_tmp[sizeof(expr_tmp)-1] = '\0';
+
+	regexp_shorthands (expr_tmp, expr_new, sizeof(expr_new));
+	if (regcomp (&reg, expr_new, REG_NOSUB | REG_NEWLINE) == 0) {
+		ret = regexec(&reg, lx->buff, 0, NULL, 0);
+		regfree (&reg);
+	}
+
+	return (ret == 0);
+}
+
 /*
 ** color_tag - mark lines with color in different ways, if argument is missing the focus word is used;
 **	with arguments "alter", "selection", ":<lineno>" the mentioned lines are tagged,
@@ -441,6 +702,7 @@ highlight_word (const char *expr)
 
 	memset (errbuff, 0, ERRBUFF_SIZE);
 	ret = regcomp (&(CURR_FILE.highlight_reg), expr_new, REGCOMP_OPTION);
+	CURR_FILE.highlight_gen = ++cnf.regex_gen;
 	if (ret) {
 		regerror(ret, &(CURR_FILE.highlight_reg), errbuff, ERRBUFF_SIZE);
 		/* external */
@@ -630,6 +892,11 @@ search (const char *expr)
 	char expr_tmp[XPATTERN_SIZE];
 	char expr_new[XPATTERN_SIZE];
 
+	/* start from the original position, not from the incremental match */
+	if (inc_ri == cnf.ring_curr) {
+		incsearch_drop (1);
+	}
+
 	/* reset regexp */
 	reset_search();
 
@@ -649,6 +916,7 @@ search (const char *expr)
 	regexp_shorthands (expr_tmp, expr_new, sizeof(expr_new));
 	memset (errbuff, 0, ERRBUFF_SIZE);
 	ret = regcomp (&(CURR_FILE.search_reg), expr_new, REGCOMP_OPTION);
+	CURR_FILE.search_gen = ++cnf.regex_gen;
 	if (ret) {
 		regerror(ret, &(CURR_FILE.search_reg), errbuff, ERRBUFF_SIZE);
 		/* external */
@@ -817,6 +1085,251 @@ repeat_search (void)
 	return (ret);
 } /* repeat_search */
 
+/*
+ * the first acceptable match in the line from xcol (same rules as in repeat_search_eng),
+ * return 0 if found (columns in pmatch), 1 if not
+ */
+static int
+incsearch_match (LINE *lx, int xcol, regmatch_t *pmatch)
+{
+	int search_rflag = 0;
+
+	if (xcol < lx->llen) {
+		search_rflag = (xcol>0) && (CURR_FILE.fflag & FSTAT_TAG4) ? REG_NOTBOL : 0;
+		if (regexec(&(CURR_FILE.search_reg), lx->buff+xcol, 1, pmatch, search_rflag) == 0 && pmatch->rm_so >= 0) {
+			pmatch->rm_so += xcol;
+			pmatch->rm_eo += xcol;
+			if ((CURR_FILE.fflag & FSTAT_TAG4) && pmatch->rm_so == pmatch->rm_eo) {
+				if (pmatch->rm_so == 0 || pmatch->rm_so == lx->llen-1)
+					return (0);
+			} else if (pmatch->rm_so < pmatch->rm_eo) {
+				return (0);
+			}
+		}
+	}
+
+	return (1);
+}
+
+/*
+ * the new pattern is the old one with one more literal character,
+ * and the old one cannot match empty or alternate, so the new matching lines are subset of the old ones
+ */
+static int
+incsearch_narrows (const char *old_expr, const char *new_expr)
+{
+	int len = strlen(old_expr);
+
+	if (len == 0 || strncmp(old_expr, new_expr, (size_t)len) != 0 ||
+	new_expr[len] == '\0' || new_expr[len+1] != '\0')
+		return (0);
+	if (strchr("^.[]$()|*+?{}\\", new_expr[len]) != NULL)
+		return (0);
+	if (strpbrk(old_expr, "*?{|") != NULL)
+		return (0);
+
+	return (1);
+}
+
+/*
+ * restore the position of the incremental search origin
+ */
+static void
+incsearch_origin (void)
+{
+	CURR_LINE = inc_origin_lx;
+	CURR_FILE.lineno = inc_origin_lineno;
+	CURR_FILE.lncol = inc_origin_lncol;
+	CURR_FILE.focus = inc_origin_focus;
+	update_curpos(cnf.ring_curr);
+	/* update full page */
+	cnf.gstat &= ~(GSTAT_UPDNONE | GSTAT_UPDFOCUS);
+}
+
+/*
+ * finish the incremental search session, restore the original position and drop the search if requested
+ */
+static void
+incsearch_drop (int restore)
+{
+	if (inc_ri == -1) {
+		return;
+	}
+	if (restore && inc_ri == cnf.ring_curr) {
+		reset_search();
+		incsearch_origin();
+	}
+	FREE(inc_set);
+	inc_set = NULL;
+	inc_nset = inc_aset = 0;
+	inc_expr[0] = '\0';
+	inc_ri = -1;
+}
+
+/*
+** incsearch_update - incremental search while the search command is typed on the command line,
+**	highlight the matches and show the first one after the original position,
+**	the set of matching lines is narrowed if the pattern only grew by one literal character;
+**	leaving the command line keeps the position and the search, removing the search command restores them
+*/
+void
+incsearch_update (int typed)
+{
+	char expr_tmp[XPATTERN_SIZE];
+	char expr_new[XPATTERN_SIZE];
+	regmatch_t pmatch;
+	LINE *lx=NULL;
+	INCMATCH *s=NULL;
+	int i, j, lineno, cnt, narrow=0;
+
+	if (inc_ri != -1 && (!typed || inc_ri != cnf.ring_curr || !(CURR_FILE.fflag & FSTAT_CMD))) {
+		incsearch_drop (0);
+		return;
+	}
+	if (!typed || !(cnf.gstat & GSTAT_INCSEARCH)) {
+		return;
+	}
+	if (cnf.cmdline_buff[0] != '/') {
+		incsearch_drop (1);
+		return;
+	}
+
+	/* start the session */
+	if (inc_ri == -1) {
+		reset_search();
+		inc_ri = cnf.ring_curr;
+		inc_origin_lx = CURR_LINE;
+		inc_origin_lineno = CURR_FILE.lineno;
+		inc_origin_lncol = CURR_FILE.lncol;
+		inc_origin_focus = CURR_FILE.focus;
+		inc_expr[0] = '\0';
+		inc_nset = 0;
+	}
+
+	cut_delimiters (cnf.cmdline_buff, expr_tmp, sizeof(expr_tmp));
+	regexp_shorthands (expr_tmp, expr_new, sizeof(expr_new));
+	if (inc_expr[0] != '\0' && strncmp(inc_expr, expr_new, sizeof(expr_new)) == 0) {
+		return;		/* closing delimiter, nothing new */
+	}
+	narrow = (inc_num_lines == CURR_FILE.num_lines) && (inc_fmask == (CURR_FILE.fflag & FSTAT_FMASK)) &&
+		incsearch_narrows (inc_expr, expr_new);
+
+	reset_search();
+	inc_expr[0] = '\0';
+	if (expr_tmp[0] == '\0' || regcomp (&(CURR_FILE.search_reg), expr_new, REGCOMP_OPTION)) {
+		/* empty or incomplete pattern, no message */
+		incsearch_origin();
+		return;
+	}
+	CURR_FILE.search_gen = ++cnf.regex_gen;
+	CURR_FILE.fflag |= FSTAT_TAG2;
+	if (expr_new[0] == '^' || expr_new[0] == '$') {
+		CURR_FILE.fflag |= FSTAT_TAG4;
+	} else {
+		CURR_FILE.fflag &= ~FSTAT_TAG4;
+	}
+	strncpy (CURR_FILE.search_expr, cnf.cmdline_buff, SEARCHSTR_SIZE);
+	CURR_FILE.search_expr[SEARCHSTR_SIZE-1] = '\0';
+
+	if (narrow) {
+		/* keep the matching lines from the previous set */
+		for (i=0, j=0; i < inc_nset; i++) {
+			if (incsearch_match (inc_set[i].lx, 0, &pmatch) == 0)
+				inc_set[j++] = inc_set[i];
+		}
+		inc_nset = j;
+	} else {
+		/* all visible lines */
+		inc_nset = 0;
+		lx = CURR_FILE.top;
+		lineno = 0;
+		next_lp (cnf.ring_curr, &lx, &cnt);
+		lineno += cnt;
+		while (TEXT_LINE(lx)) {
+			if (incsearch_match (lx, 0, &pmatch) == 0) {
+				if (inc_nset >= inc_aset) {
+					s = (INCMATCH *) REALLOC((void *)inc_set, sizeof(INCMATCH) * (size_t)(inc_aset + 1024));
+					if (s == NULL) {
+						ERRLOG(0xE0CD);
+						incsearch_drop (1);
+						return;
+					}
+					inc_set = s;
+					inc_aset += 1024;
+				}
+				inc_set[inc_nset].lx = lx;
+				inc_set[inc_nset].lineno = lineno;
+				inc_nset++;
+			}
+			next_lp (cnf.ring_curr, &lx, &cnt);
+			lineno += cnt;
+		}
+		inc_num_lines = CURR_FILE.num_lines;
+		inc_fmask = CURR_FILE.fflag & FSTAT_FMASK;
+	}
+	strncpy (inc_expr, expr_new, sizeof(inc_expr));
+	inc_expr[sizeof(inc_expr)-1] = '\0';
+
+	/* the first match after the origin, binary search on line numbers */
+	incsearch_origin();
+	i = 0;
+	j = inc_nset;
+	while (i < j) {
+		cnt = (i + j) / 2;
+		if (inc_set[cnt].lineno < inc_origin_lineno)
+			i = cnt + 1;
+		else
+			j = cnt;
+	}
+	if (i < inc_nset && inc_set[i].lineno == inc_origin_lineno &&
+	incsearch_match (inc_set[i].lx, inc_origin_lncol, &pmatch) != 0) {
+		i++;	/* the origin line, but before the cursor */
+	}
+	if (i < inc_nset) {
+		incsearch_match (inc_set[i].lx, (inc_set[i].lineno == inc_origin_lineno) ? inc_origin_lncol : 0, &pmatch);
+		CURR_LINE = inc_set[i].lx;
+		CURR_FILE.lineno = inc_set[i].lineno;
+		CURR_FILE.lncol = pmatch.rm_so;
+		update_focus(FOCUS_AVOID_BORDER, cnf.ring_curr);
+		update_curpos(cnf.ring_curr);
+	}
+}
+
+/*
+ * split the change arguments (like "/from/to/g") in place at the delimiters,
+ * possible delimiters are slash, single quote, double quote, exclamation mark;
+ * return the option character after the closing delimiter (or zero), -1 if delimiters are missing
+ */
+static int
+split_change_args (char *expr_tmp, char **expr, char **repl_expr)
+{
+	char beg, *r=NULL;
+	int opt = 0;
+
+	*expr = *repl_expr = NULL;
+	beg = expr_tmp[0];
+	if (beg==0x2f || beg==0x27 || beg==0x22 || beg==0x21) {
+		*expr = r = expr_tmp+1;
+		for (; *r != '\0' && *r != beg; r++)
+			;
+		if (*r == beg) {
+			*r = '\0';
+			*repl_expr = ++r;
+			for (; *r != '\0' && *r != beg; r++)
+				;
+			if (*r == beg) {
+				opt = (unsigned char)*(r+1);
+			}
+			*r = '\0';
+		}
+	}
+	if (*expr == NULL || *repl_expr == NULL) {
+		return (-1);
+	}
+
+	return (opt);
+} /* split_change_args */
+
 /*
 ** change - start search and replace with given regular expressions (like "ch /from/to/"),
 **	possible delimiters are slash, single quote, double quote, exclamation mark;
@@ -828,10 +1341,9 @@ change (const char *argz)
 	int ret=1;
 	char errbuff[ERRBUFF_SIZE];
 	char *expr=NULL, *repl_expr=NULL;
-	char beg, *r=NULL;
 	char expr_tmp[XPATTERN_SIZE];
 	char expr_new[XPATTERN_SIZE], repl_expr_new[XPATTERN_SIZE];
-	int global_opt = 0;
+	int global_opt = 0, opt = 0;
 	LINE *g_lx=NULL;
 	int g_lineno=0, g_focus=0, g_lncol=0;
 
@@ -847,26 +1359,11 @@ change (const char *argz)
 	expr_tmp[sizeof(expr_tmp)-1] = '\0';
 
 	/* parse arguments into expressions */
-	beg = expr_tmp[0];
-	if (beg==0x2f || beg==0x27 || beg==0x22 || beg==0x21) {
-		expr = r = expr_tmp+1;
-		for (; *r != '\0' && *r != beg; r++)
-			;
-		if (*r == beg) {
-			*r = '\0';
-			repl_expr = ++r;
-			for (; *r != '\0' && *r != beg; r++)
-				;
-			if (*r == beg) {
-				global_opt = (*(r+1) == 'g');
-			}
-			*r = '\0';
-		}
-	}
-	if (expr == NULL || repl_expr == NULL) {
+	if ((opt = split_change_args (expr_tmp, &expr, &repl_expr)) == -1) {
 		tracemsg("failure: missing pattern delimiters");
 		return (1);
 	}
+	global_opt = (opt == 'g');
 
 	/* leave if search pattern is empty */
 	if (strlen(expr) == 0) {
@@ -879,6 +1376,7 @@ change (const char *argz)
 
 	memset (errbuff, 0, ERRBUFF_SIZE);
 	ret = regcomp (&(CURR_FILE.search_reg), expr_new, REGCOMP_OPTION);
+	CURR_FILE.search_gen = ++cnf.regex_gen;
 	if (ret) {
 		regerror(ret, &(CURR_FILE.search_reg), errbuff, ERRBUFF_SIZE);
 		/* external */
@@ -944,6 +1442,7 @@ repeat_change (int ch)
 	static CHDATA *chp = NULL;
 	int cnt=0;
 	int restore_focus = CURR_FILE.focus;
+	long long rest_msec = -1;
 
 	if (ch == 0xff) {
 		s1 = (CHDATA *) MALLOC(sizeof(CHDATA));
@@ -976,6 +1475,9 @@ repeat_change (int ch)
 				chp->rep_buff = s2;
 				chp->rep_length = 0;
 				chp->rflag = 0xff;	/* initially: rep_buff isn't const */
+				chp->reg = &(CURR_FILE.search_reg);
+				chp->repl_expr = CURR_FILE.replace_expr;
+				chp->anchor = (CURR_FILE.fflag & FSTAT_TAG4) ? 1 : 0;
 				/**/
 				ret = search_for_replace (chp);
 			}
@@ -988,7 +1490,7 @@ repeat_change (int ch)
 			ret = 4;	/* malloc error */
 		} else {
 			chp->change_count++;
-			chp->lncol += chp->pmatch[0].rm_so + chp->rep_length + ((CURR_FILE.fflag & FSTAT_TAG4) ? 1 : 0);
+			chp->lncol += chp->pmatch[0].rm_so + chp->rep_length + chp->anchor;
 			CURR_FILE.lncol = chp->lncol;
 			update_curpos(cnf.ring_curr);
 			/**/
@@ -996,25 +1498,16 @@ repeat_change (int ch)
 		}
 
 	} else if (ch=='n' || ch=='N') {
-		chp->lncol += chp->pmatch[0].rm_eo + ((CURR_FILE.fflag & FSTAT_TAG4) ? 1 : 0);
+		chp->lncol += chp->pmatch[0].rm_eo + chp->anchor;
 		CURR_FILE.lncol = chp->lncol;
 		update_curpos(cnf.ring_curr);
 		/**/
 		ret = search_for_replace (chp);
 
 	} else if (ch=='r' || ch=='R') {
-		while ((ret == 0) && TEXT_LINE(chp->lx)) {
-			if (chp->rflag)
-				ret = accum_replacement (chp);
-			if (ret == -1 || do_replacement (chp)) {
-				ret = 4;	/* malloc error */
-			} else {
-				chp->change_count++;
-				chp->lncol += chp->pmatch[0].rm_so + chp->rep_length + ((CURR_FILE.fflag & FSTAT_TAG4) ? 1 : 0);
-				/**/
-				ret = search_for_replace (chp);
-			}
-		}
+		rest_msec = msec_clock();
+		ret = replace_rest (chp);
+		rest_msec = msec_clock() - rest_msec;
 		/* original lncol should be updated */
 		CURR_FILE.lncol = get_col(CURR_LINE, CURR_FILE.curpos);
 
@@ -1032,6 +1525,9 @@ repeat_change (int ch)
 		} else {
 			if (ch == 0xff) {
 				tracemsg ("change: no match");
+			} else if (rest_msec >= 0) {
+				tracemsg ("change count %d (%lld ms)", chp->change_count, rest_msec);
+				ret = 0; // finished, no problem
 			} else {
 				tracemsg ("change count %d", chp->change_count);
 				ret = 0; // finished, no problem
@@ -1071,26 +1567,11 @@ search_for_replace (CHDATA *chp)
 {
 	int ret = 1;
 	int cnt;
-	char search_rflag=0;
 
 	/* start search */
 	while (!(chp->lx->lflag & LSTAT_BOTTOM)) {
-		if (chp->lncol < chp->lx->llen) {
-			search_rflag = (chp->lncol>0) && (CURR_FILE.fflag & FSTAT_TAG4) ? REG_NOTBOL : 0;
-			ret = regexec(&(CURR_FILE.search_reg), chp->lx->buff + chp->lncol, 10, chp->pmatch, search_rflag);
-			if (ret == 0 && chp->pmatch[0].rm_so >= 0)
-			{
-				if ((CURR_FILE.fflag & FSTAT_TAG4) && chp->pmatch[0].rm_so == chp->pmatch[0].rm_eo)
-				{
-					if (chp->lncol+chp->pmatch[0].rm_so == 0) {
-						break;
-					} else if (chp->lncol+chp->pmatch[0].rm_eo == chp->lx->llen-1) {
-						break;
-					}
-				} else if (chp->pmatch[0].rm_so < chp->pmatch[0].rm_eo) {
-					break;
-				}
-			}
+		if ((ret = match_for_replace (chp)) == 0) {
+			break;
 		}
 		/* not found, yet */
 		next_lp (cnf.ring_curr, &(chp->lx), &cnt);
@@ -1110,6 +1591,145 @@ search_for_replace (CHDATA *chp)
 	}
 } /* search_for_replace */
 
+/*
+ * the regexp match in chp->lx from chp->lncol, strictly for change,
+ * empty match is accepted only with anchor at the begin or end of line
+ * return 0 if found, 1 if not
+ */
+static int
+match_for_replace (CHDATA *chp)
+{
+	int ret = 1;
+	char search_rflag=0;
+
+	if (chp->lncol < chp->lx->llen) {
+		search_rflag = (chp->lncol>0) && chp->anchor ? REG_NOTBOL : 0;
+		ret = regexec(chp->reg, chp->lx->buff + chp->lncol, 10, chp->pmatch, search_rflag);
+		if (ret == 0 && chp->pmatch[0].rm_so >= 0)
+		{
+			if (chp->anchor && chp->pmatch[0].rm_so == chp->pmatch[0].rm_eo)
+			{
+				if (chp->lncol+chp->pmatch[0].rm_so == 0) {
+					return (0);
+				} else if (chp->lncol+chp->pmatch[0].rm_eo == chp->lx->llen-1) {
+					return (0);
+				}
+			} else if (chp->pmatch[0].rm_so < chp->pmatch[0].rm_eo) {
+				return (0);
+			}
+		}
+	}
+
+	return (1);
+} /* match_for_replace */
+
+/*
+ * replace the current and all remaining matches up to the end of buffer (the "Rest"),
+ * the new content of a line is built once in a reusable scratch buffer from the unchanged
+ * source line and swapped in with one milbuff() call, without focus update per match
+ * return 1 if finished, 4 on malloc error
+ */
+static int
+replace_rest (CHDATA *chp)
+{
+	char *out=NULL;
+	unsigned als=0;
+	int olen=0, cnt=0;
+	int ret = 0;
+
+	/* the first match is in chp->pmatch[] already */
+	while (ret == 0 && TEXT_LINE(chp->lx)) {
+		if (replace_line (chp, &out, &als, &olen) < 0) {
+			ret = 4;
+			break;
+		}
+
+		/* swap in */
+		if (milbuff (chp->lx, 0, chp->lx->llen, out, olen)) {
+			ret = 4;
+			break;
+		}
+		chp->lx->lflag |= LSTAT_CHANGE;
+		CURR_FILE.fflag |= FSTAT_CHANGE;
+
+		/* the first match in the next visible lines */
+		while (ret == 0) {
+			next_lp (cnf.ring_curr, &(chp->lx), &cnt);
+			chp->lineno += cnt;
+			chp->lncol = 0;
+			if (!TEXT_LINE(chp->lx)) {
+				ret = 1;
+			} else if (match_for_replace (chp) == 0) {
+				break;
+			}
+		}
+	}
+
+	FREE(out);
+	return (ret);
+} /* replace_rest */
+
+/*
+ * build the new content of chp->lx in the reusable scratch buffer *outp (allocated size in *alsp),
+ * from the match in chp->pmatch[] to the end of line, chp->lx itself is not changed
+ * return the number of replacements (the new length in *olenp) or -1 on malloc error
+ */
+static int
+replace_line (CHDATA *chp, char **outp, unsigned *alsp, int *olenp)
+{
+	char *s;
+	int olen=0, done=0, beg=0, end=0, need=0, changed=0;
+
+	while (1) {
+		/* chp->lx is unchanged, so the backrefs work on the source line */
+		if (chp->rflag && accum_replacement (chp) == -1) {
+			return (-1);
+		}
+		beg = chp->lncol + chp->pmatch[0].rm_so;
+		end = chp->lncol + chp->pmatch[0].rm_eo;
+		need = olen + (beg - done) + chp->rep_length;
+		if (*outp == NULL || REP_ASIZE(need) > *alsp) {
+			*alsp = REP_ASIZE(need);
+			s = (char *) REALLOC((void *)*outp, *alsp);
+			if (s == NULL) {
+				ERRLOG(0xE0C8);
+				return (-1);
+			}
+			*outp = s;
+		}
+		memcpy(*outp + olen, chp->lx->buff + done, (size_t)(beg - done));
+		olen += beg - done;
+		memcpy(*outp + olen, chp->rep_buff, (size_t)chp->rep_length);
+		olen += chp->rep_length;
+		done = end;
+		changed++;
+		chp->change_count++;
+
+		/* the next match in the source line, skip one char after anchored match */
+		chp->lncol = end + chp->anchor;
+		if (match_for_replace (chp) != 0)
+			break;
+	}
+
+	/* the rest of the line, with the newline */
+	need = olen + chp->lx->llen - done;
+	if (REP_ASIZE(need) > *alsp) {
+		*alsp = REP_ASIZE(need);
+		s = (char *) REALLOC((void *)*outp, *alsp);
+		if (s == NULL) {
+			ERRLOG(0xE0C9);
+			return (-1);
+		}
+		*outp = s;
+	}
+	memcpy(*outp + olen, chp->lx->buff + done, (size_t)(chp->lx->llen - done));
+	olen += chp->lx->llen - done;
+	(*outp)[olen] = '\0';
+
+	*olenp = olen;
+	return (changed);
+} /* replace_line */
+
 /* shorthands */
 #define PMLEN(ii)	(chp->pmatch[(ii)].rm_eo - chp->pmatch[(ii)].rm_so)
 #define BEG_SRC(ii)	(chp->lx->buff + chp->lncol + chp->pmatch[(ii)].rm_so)
@@ -1126,7 +1746,7 @@ search_for_replace (CHDATA *chp)
 static int
 accum_replacement (CHDATA *chp)
 {
-	char *rp;	/* ptr on (const) CURR_FILE.replace_expr */
+	const char *rp;	/* ptr on (const) chp->repl_expr */
 	char *srcp;	/* source lx->buff ptr on matching expr */
 	int idx=0;	/* index on chp->rep_buff[] */
 	int nsub=0;	/* sub expression number */
@@ -1146,7 +1766,7 @@ accum_replacement (CHDATA *chp)
 	 * but \\0, \\1, ... \\9, \& and \\ literally as \0, \1, ... \9, & and \
 	 * --- thanks for this idea/feature to who made it ---
 	 */
-	for (rp = CURR_FILE.replace_expr; *rp != '\0'; rp++) {
+	for (rp = chp->repl_expr; *rp != '\0'; rp++) {
 		srcp = NULL;
 		sublen = 0;
 		sub_expression_used = 0;
@@ -1245,3 +1865,536 @@ do_replacement (CHDATA *chp)
 
 	return (ret);
 } /* do_replacement */
+
+/*
+ * changeall target: open regular buffer, where the change is possible
+ */
+#define CHANGEALL_TARGET(ri)	((cnf.fdata[(ri)].fflag & FSTAT_OPEN) && \
+	!(cnf.fdata[(ri)].fflag & (FSTAT_SPECW | FSTAT_RO | FSTAT_NOEDIT)))
+
+/*
+** changeall - search and replace with given regular expressions (like "changeall /from/to/") in all
+**	open regular buffers, or with the "p" option (like "changeall /from/to/p") in the project files also,
+**	the changes are listed in the *changeall* buffer first and done only if confirmed by "changeall"
+**	without argument there, changed lines get the altered flag for review
+*/
+int
+changeall (const char *argz)
+{
+	int ret=0, opt=0;
+	char errbuff[ERRBUFF_SIZE];
+	char *expr=NULL, *repl_expr=NULL;
+	char expr_tmp[XPATTERN_SIZE];
+	char expr_new[XPATTERN_SIZE];
+
+	/* confirmation */
+	if (argz[0] == '\0') {
+		if (!ca_pending) {
+			tracemsg("changeall: nothing to confirm");
+		} else if (strncmp(CURR_FILE.fname, "*changeall*", 11) != 0) {
+			tracemsg("changeall: confirm in the *changeall* buffer");
+		} else {
+			ret = changeall_apply();
+			ca_pending = 0;
+			regfree (&ca_reg);
+		}
+		return (ret);
+	}
+
+	/* drop the previous one */
+	if (ca_pending) {
+		ca_pending = 0;
+		regfree (&ca_reg);
+	}
+
+	strncpy(expr_tmp, argz, sizeof(expr_tmp));
+	expr_tmp[sizeof(expr_tmp)-1] = '\0';
+
+	/* parse arguments into expressions */
+	if ((opt = split_change_args (expr_tmp, &expr, &repl_expr)) == -1) {
+		tracemsg("failure: missing pattern delimiters");
+		return (1);
+	}
+	if (strlen(expr) == 0) {
+		return (0);
+	}
+	if (opt == 'p' && cnf.project[0] == '\0') {
+		tracemsg("changeall: no project");
+		return (1);
+	}
+
+	regexp_shorthands (expr, expr_new, sizeof(expr_new));
+	regexp_shorthands (repl_expr, ca_repl, sizeof(ca_repl));
+
+	memset (errbuff, 0, ERRBUFF_SIZE);
+	ret = regcomp (&ca_reg, expr_new, REGCOMP_OPTION);
+	if (ret) {
+		regerror(ret, &ca_reg, errbuff, ERRBUFF_SIZE);
+		tracemsg("pattern [%s]: failed: %s", expr_new, errbuff);
+		return (1);
+	}
+	ca_pending = (opt == 'p') ? 2 : 1;
+	ca_anchor = (expr_new[0] == '^' || expr_new[0] == '$');
+	snprintf(ca_args, sizeof(ca_args)-1, "%s", argz);
+
+	ret = changeall_preview();
+	if (ret) {
+		ca_pending = 0;
+		regfree (&ca_reg);
+	}
+
+	return (ret);
+} /* changeall */
+
+/*
+ * initialize the change data for changeall with the pending expressions,
+ * return 0 if ok, -1 on malloc error
+ */
+static int
+changeall_chdata (CHDATA *chp)
+{
+	memset (chp, 0, sizeof(CHDATA));
+	chp->rep_buff = (char *) MALLOC(REP_ASIZE(0));
+	if (chp->rep_buff == NULL) {
+		ERRLOG(0xE0CA);
+		return (-1);
+	}
+	chp->rflag = 0xff;	/* initially: rep_buff isn't const */
+	chp->reg = &ca_reg;
+	chp->repl_expr = ca_repl;
+	chp->anchor = ca_anchor;
+
+	return (0);
+} /* changeall_chdata */
+
+/*
+ * list the change of chp->lx (if any) in the *changeall* buffer after *lpp, the old and the new line,
+ * return the number of replacements or -1 on error
+ */
+static int
+changeall_list_line (CHDATA *chp, const char *fname, int lineno, LINE **lpp, char **outp, unsigned *alsp)
+{
+	char one_line[FNAMESIZE+30];
+	int olen=0, changed=0;
+	LINE *lx=NULL;
+
+	chp->lncol = 0;
+	if (match_for_replace (chp) != 0) {
+		return (0);
+	}
+	if ((changed = replace_line (chp, outp, alsp, &olen)) < 0) {
+		return (-1);
+	}
+
+	snprintf(one_line, sizeof(one_line)-1, "%s:%d:-\n", fname, lineno);
+	if ((lx = append_line (*lpp, one_line)) == NULL) {
+		return (-1);
+	}
+	CURR_FILE.num_lines++;
+	*lpp = lx;
+	if (milbuff (lx, lx->llen-1, 0, chp->lx->buff, chp->lx->llen-1)) {
+		return (-1);
+	}
+
+	snprintf(one_line, sizeof(one_line)-1, "%s:%d:+\n", fname, lineno);
+	if ((lx = append_line (*lpp, one_line)) == NULL) {
+		return (-1);
+	}
+	CURR_FILE.num_lines++;
+	*lpp = lx;
+	if (milbuff (lx, lx->llen-1, 0, *outp, olen-1)) {
+		return (-1);
+	}
+
+	return (changed);
+} /* changeall_list_line */
+
+/*
+ * scan the file on disk (not opened in the ring) line by line for changeall,
+ * list the changes in the *changeall* buffer if lpp is given, or stop at the first match,
+ * return the number of replacements (or 1 on first match), -1 on error
+ */
+static int
+changeall_scan_file (CHDATA *chp, const char *fname, LINE **lpp, int *nlines)
+{
+	FILE *fp=NULL;
+	LINE disk_line;
+	char *buff=NULL, *s;
+	char *out=NULL;
+	unsigned als=0;
+	size_t bsize=0;
+	ssize_t blen;
+	int lineno=0, cnt=0, changes=0;
+
+	if ((fp = fopen(fname, "r")) == NULL) {
+		return (0);
+	}
+
+	memset (&disk_line, 0, sizeof(disk_line));
+	chp->lx = &disk_line;
+	while ((blen = getline(&buff, &bsize, fp)) > 0) {
+		lineno++;
+		/* the line in memory has always the newline */
+		if (buff[blen-1] != '\n') {
+			if ((size_t)blen + 2 > bsize) {
+				s = (char *) REALLOC((void *)buff, (size_t)blen + 2);
+				if (s == NULL) {
+					ERRLOG(0xE0CB);
+					changes = -1;
+					break;
+				}
+				buff = s;
+				bsize = (size_t)blen + 2;
+			}
+			buff[blen++] = '\n';
+			buff[blen] = '\0';
+		}
+		disk_line.buff = buff;
+		disk_line.llen = (int)blen;
+
+		if (lpp == NULL) {
+			chp->lncol = 0;
+			if (match_for_replace (chp) == 0) {
+				changes = 1;
+				break;
+			}
+			continue;
+		}
+		if ((cnt = changeall_list_line (chp, fname, lineno, lpp, &out, &als)) < 0) {
+			changes = -1;
+			break;
+		} else if (cnt > 0) {
+			changes += cnt;
+			(*nlines)++;
+		}
+	}
+
+	fclose(fp);
+	FREE(buff);
+	FREE(out);
+	chp->lx = NULL;
+
+	return (changes);
+} /* changeall_scan_file */
+
+/*
+ * save the state of the project file with match in the preview,
+ * return 0 if ok, -1 on malloc error
+ */
+static int
+changeall_save_file (const struct stat *sp)
+{
+	CAFILE *cp;
+
+	if (ca_nfiles >= ca_afiles) {
+		cp = (CAFILE *) REALLOC((void *)ca_files, sizeof(CAFILE) * (size_t)(ca_afiles * 2 + 64));
+		if (cp == NULL) {
+			ERRLOG(0xE0DE);
+			return (-1);
+		}
+		ca_files = cp;
+		ca_afiles = ca_afiles * 2 + 64;
+	}
+	cp = &ca_files[ca_nfiles++];
+	cp->dev = sp->st_dev;
+	cp->ino = sp->st_ino;
+	cp->mtim = sp->st_mtim;
+	cp->size = sp->st_size;
+	return (0);
+} /* changeall_save_file */
+
+/*
+ * return the index of the project file in the preview list, or -1
+ */
+static int
+changeall_find_file (const struct stat *sp)
+{
+	int k;
+
+	for (k=0; k < ca_nfiles; k++) {
+		if (ca_files[k].ino == sp->st_ino && ca_files[k].dev == sp->st_dev)
+			return (k);
+	}
+	return (-1);
+} /* changeall_find_file */
+
+/*
+ * list the pending changeall in the *changeall* buffer, from the open regular buffers
+ * and the project files (if requested), without any change there,
+ * return 0 if ok
+ */
+static int
+changeall_preview (void)
+{
+	int ret=0, ri, lineno, cnt;
+	int ring_i = cnf.ring_curr;
+	int changes=0, nlines=0, nfiles=0, flines=0;
+	CHDATA ch;
+	LINE *lp=NULL, *lx=NULL;
+	char one_line[CMDLINESIZE+100];
+	char *out=NULL, *list=NULL, *fname, *next;
+	unsigned als=0;
+	struct stat test;
+	long long t0 = msec_clock();
+
+	ca_nfiles = 0;
+
+	/* open or reopen the special buffer */
+	if ((ret = scratch_buffer("*changeall*")) != 0) {
+		return (ret);
+	}
+	/* cnf.ring_curr is set now */
+	if (CURR_FILE.num_lines > 0) {
+		clean_buffer();
+	}
+	CURR_FILE.fflag |= FSTAT_SPECW;
+	CURR_FILE.fflag |= (FSTAT_NOEDIT | FSTAT_NOADDLIN);
+	if (ring_i != cnf.ring_curr) {
+		CURR_FILE.origin = ring_i;
+	}
+
+	if (changeall_chdata (&ch)) {
+		return (4);
+	}
+
+	/* header
+	*/
+	snprintf(one_line, sizeof(one_line)-1, "changeall %s\n", ca_args);
+	if ((lp = insert_line_before (CURR_FILE.bottom, one_line)) != NULL) {
+		CURR_FILE.num_lines++;
+	} else {
+		ret = 2;
+	}
+
+	/* all lines of the open regular buffers, hidden lines also
+	*/
+	for (ri=0; ret==0 && ri<RINGSIZE; ri++) {
+		ca_lgen[ri] = 0;
+		if (!CHANGEALL_TARGET(ri))
+			continue;
+		ca_lgen[ri] = cnf.fdata[ri].lgen;
+		flines = nlines;
+		lineno = 1;
+		for (lx = cnf.fdata[ri].top->next; TEXT_LINE(lx); lx = lx->next, lineno++) {
+			ch.lx = lx;
+			if ((cnt = changeall_list_line (&ch, cnf.fdata[ri].fname, lineno, &lp, &out, &als)) < 0) {
+				ret = 2;
+				break;
+			} else if (cnt > 0) {
+				changes += cnt;
+				nlines++;
+			}
+		}
+		if (nlines > flines)
+			nfiles++;
+	}
+
+	/* the project files not opened yet
+	*/
+	if (ret==0 && ca_pending == 2) {
+		list = project_filelist();
+		for (fname = list; ret==0 && fname != NULL && *fname != '\0'; fname = next) {
+			next = strchr(fname, '\n');
+			if (next != NULL)
+				*next++ = '\0';
+			if (stat(fname, &test) || !S_ISREG(test.st_mode) || query_inode(test.st_ino) != -1)
+				continue;
+			flines = nlines;
+			if ((cnt = changeall_scan_file (&ch, fname, &lp, &nlines)) < 0) {
+				ret = 2;
+			} else {
+				changes += cnt;
+			}
+			if (nlines > flines) {
+				nfiles++;
+				if (changeall_save_file (&test))
+					ret = 2;
+			}
+		}
+		FREE(list);
+	}
+
+	FREE(out);
+	FREE(ch.rep_buff);
+
+	/* footer
+	*/
+	if (ret==0) {
+		snprintf(one_line, sizeof(one_line)-1,
+			"%d changes in %d lines of %d files, confirm with \"changeall\" here\n",
+			changes, nlines, nfiles);
+		if (append_line (lp, one_line) != NULL) {
+			CURR_FILE.num_lines++;
+		}
+	}
+
+	/* pull and update
+	*/
+	CURR_LINE = CURR_FILE.bottom->prev;
+	CURR_FILE.lineno = CURR_FILE.num_lines;
+	update_focus(FOCUS_ON_LASTBUT1_LINE, cnf.ring_curr);
+
+	if (ret == 0 && changes == 0) {
+		tracemsg("changeall: no match");
+		ret = 1;
+	} else if (ret == 0) {
+		tracemsg("changeall: %d changes in %d lines of %d files (%lld ms), confirm with \"changeall\"",
+			changes, nlines, nfiles, msec_clock() - t0);
+	}
+
+	return (ret);
+} /* changeall_preview */
+
+/*
+ * do the confirmed changeall, open the matching project files first,
+ * the *changeall* buffer must be the current one, refuse if the targets changed since the preview
+ * or the files to open do not fit in the ring, nothing is changed then,
+ * return 0 if ok
+ */
+static int
+changeall_apply (void)
+{
+	int ret=0, ri, cnt, olen=0, i, k;
+	int ring_i = cnf.ring_curr;
+	int changes=0, nlines=0, nfiles=0, flines=0;
+	int nopen=0, nfree=0, skipped=0, stale=0;
+	char *to_open[RINGSIZE];
+	CHDATA ch;
+	LINE *lx=NULL;
+	char one_line[200];
+	char *out=NULL, *list=NULL, *fname, *next;
+	unsigned als=0;
+	struct stat test;
+	long long t0 = msec_clock();
+
+	/* the open buffers, as listed in the preview
+	*/
+	for (ri=0; ri<RINGSIZE; ri++) {
+		if (!CHANGEALL_TARGET(ri)) {
+			if (ca_lgen[ri] != 0)
+				stale = 1;
+		} else if (ca_lgen[ri] != cnf.fdata[ri].lgen) {
+			stale = 1;
+		}
+		if ((cnf.fdata[ri].fflag & FSTAT_OPEN) == 0)
+			nfree++;
+	}
+	if (stale) {
+		tracemsg("changeall: buffers changed since the preview, run it again");
+		return (1);
+	}
+
+	if (changeall_chdata (&ch)) {
+		return (4);
+	}
+
+	/* the project files with match, not modified since the preview
+	*/
+	if (ca_pending == 2) {
+		list = project_filelist();
+		for (fname = list; ret==0 && fname != NULL && *fname != '\0'; fname = next) {
+			next = strchr(fname, '\n');
+			if (next != NULL)
+				*next++ = '\0';
+			if (stat(fname, &test) || !S_ISREG(test.st_mode) || query_inode(test.st_ino) != -1)
+				continue;
+			k = changeall_find_file (&test);
+			if (k >= 0 && (ca_files[k].mtim.tv_sec != test.st_mtim.tv_sec ||
+			ca_files[k].mtim.tv_nsec != test.st_mtim.tv_nsec || ca_files[k].size != test.st_size))
+			{
+				stale = 1;
+				break;
+			}
+			if ((cnt = changeall_scan_file (&ch, fname, NULL, NULL)) < 0) {
+				ret = 4;
+			} else if (cnt > 0 && k < 0) {
+				/* no match in the preview */
+				stale = 1;
+				break;
+			} else if (cnt > 0) {
+				if (nopen < RINGSIZE)
+					to_open[nopen] = fname;
+				nopen++;
+			}
+		}
+		if (ret == 0 && stale) {
+			tracemsg("changeall: %s changed since the preview, run it again", fname);
+			ret = 1;
+		} else if (ret == 0 && nopen > nfree) {
+			tracemsg("changeall: %d project files to open, only %d free buffers", nopen, nfree);
+			ret = 1;
+		}
+		for (i=0; ret==0 && i < nopen; i++) {
+			if (add_file(to_open[i])) {
+				tracemsg("changeall: cannot open %s, skipped", to_open[i]);
+				skipped++;
+			}
+			cnf.ring_curr = ring_i;
+		}
+		FREE(list);
+	}
+	if (ret) {
+		FREE(ch.rep_buff);
+		if (ret & 4)
+			tracemsg ("changeall aborted due to malloc error");
+		return (ret);
+	}
+
+	/* change all lines of the open regular buffers
+	*/
+	for (ri=0; ret==0 && ri<RINGSIZE; ri++) {
+		if (!CHANGEALL_TARGET(ri))
+			continue;
+		flines = nlines;
+		for (lx = cnf.fdata[ri].top->next; TEXT_LINE(lx); lx = lx->next) {
+			ch.lx = lx;
+			ch.lncol = 0;
+			if (match_for_replace (&ch) != 0)
+				continue;
+			if ((cnt = replace_line (&ch, &out, &als, &olen)) < 0 ||
+			milbuff (lx, 0, lx->llen, out, olen))
+			{
+				ret = 4;
+				break;
+			}
+			lx->lflag |= LSTAT_CHANGE;
+			cnf.fdata[ri].fflag |= FSTAT_CHANGE;
+			LINES_CHANGED(ri);
+			changes += cnt;
+			nlines++;
+		}
+		if (nlines > flines)
+			nfiles++;
+	}
+
+	FREE(out);
+	FREE(ch.rep_buff);
+
+	/* report in the *changeall* buffer also
+	*/
+	if (skipped) {
+		snprintf(one_line, sizeof(one_line)-1, "changed: %d changes in %d lines of %d files, %d files skipped%s\n",
+			changes, nlines, nfiles, skipped, (ret ? ", aborted" : ""));
+	} else {
+		snprintf(one_line, sizeof(one_line)-1, "changed: %d changes in %d lines of %d files%s\n",
+			changes, nlines, nfiles, (ret ? ", aborted" : ""));
+	}
+	if (append_line (CURR_FILE.bottom->prev, one_line) != NULL) {
+		CURR_FILE.num_lines++;
+		CURR_LINE = CURR_FILE.bottom->prev;
+		CURR_FILE.lineno = CURR_FILE.num_lines;
+		update_focus(FOCUS_ON_LASTBUT1_LINE, cnf.ring_curr);
+	}
+
+	if (ret & 4) {
+		tracemsg ("changeall aborted due to malloc error");
+	} else if (ret == 0 && skipped) {
+		tracemsg("changeall: %d changes in %d lines of %d files (%lld ms), %d files skipped",
+			changes, nlines, nfiles, msec_clock() - t0, skipped);
+	} else if (ret == 0) {
+		tracemsg("changeall: %d changes in %d lines of %d files (%lld ms)",
+			changes, nlines, nfiles, msec_clock() - t0);
+	}
+
+	return (ret);
+} /* changeall_apply */
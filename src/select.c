@@ -473,7 +473,6 @@ cp_select_eng (LINE *lp_src, LINE *lp_target)
 			lp_target = lx;
 
 			lp_target->lflag = (lp_src->lflag & ~LSTAT_BM_BITS);
-			lp_target->lflag &= ~LSTAT_FMASK;
 			lp_target->lflag |= LSTAT_CHANGE;
 
 			count++;
@@ -523,6 +522,7 @@ rm_select (void)
 	SELECT_FI.num_lines -= count;
 	if (count > 0) {
 		SELECT_FI.fflag |= FSTAT_CHANGE;
+		LINES_CHANGED(cnf.select_ri);
 	}
 
 	/* at last */
@@ -606,6 +606,7 @@ mv_select (void)
 	CURR_FILE.num_lines += count;
 	if (count > 0) {
 		SELECT_FI.fflag |= FSTAT_CHANGE;
+		LINES_CHANGED(cnf.select_ri);
 		CURR_FILE.fflag |= FSTAT_CHANGE;
 	}
 
@@ -639,7 +640,8 @@ mv_select_eng (LINE *lp_src, LINE *lp_target)
 		if (!HIDDEN_LINE(cnf.select_ri,lp_src)) {
 			lp_target = lll_mv(lp_src, lp_target);
 
-			lp_target->lflag &= ~(LSTAT_BM_BITS | LSTAT_FMASK);
+			lp_target->lflag &= ~LSTAT_BM_BITS;
+			lll_unhide(lp_target, LSTAT_FMASK);
 			lp_target->lflag |= LSTAT_CHANGE;
 
 			count++;
@@ -765,8 +767,10 @@ over_select_eng (int src_ri, LINE *lp_src, LINE *lp_src_end)
 		next_lp (target_ri, &lp_target, &cnt);
 		lno_first += cnt;
 	}
-	if (over > 0)
+	if (over > 0) {
 		cnf.fdata[target_ri].fflag |= FSTAT_CHANGE;
+		LINES_CHANGED(target_ri);
+	}
 	if (ans)
 		return ans;
 	// after [over]: lno_first and lineno
@@ -792,8 +796,10 @@ over_select_eng (int src_ri, LINE *lp_src, LINE *lp_src_end)
 		if (lno_first <= cnf.fdata[target_ri].lineno)
 			cnf.fdata[target_ri].lineno += insert;
 		cnf.fdata[target_ri].num_lines += insert;
-		if (insert > 0)
+		if (insert > 0) {
 			cnf.fdata[target_ri].fflag |= FSTAT_CHANGE;
+			LINES_CHANGED(target_ri);
+		}
 		// after [insert]: lineno
 
 	} else if (!target_ready && TEXT_LINE(lp_target)) {
@@ -827,8 +833,10 @@ over_select_eng (int src_ri, LINE *lp_src, LINE *lp_src_end)
 		if (lno_first < cnf.fdata[target_ri].lineno)
 			cnf.fdata[target_ri].lineno -= delete;
 		cnf.fdata[target_ri].num_lines -= delete;
-		if (delete > 0)
+		if (delete > 0) {
 			cnf.fdata[target_ri].fflag |= FSTAT_CHANGE;
+			LINES_CHANGED(target_ri);
+		}
 
 	}
 
@@ -1036,6 +1044,7 @@ shift_engine (int type)
 			SELECT_FI.lncol = get_col(SELECT_FI.curr_line, SELECT_FI.curpos);
 		}
 		SELECT_FI.fflag |= FSTAT_CHANGE;
+		LINES_CHANGED(cnf.select_ri);
 	}
 
 	return (0);
@@ -1145,6 +1154,7 @@ comment_engine (int type)
 			SELECT_FI.lncol = get_col(SELECT_FI.curr_line, SELECT_FI.curpos);
 		}
 		SELECT_FI.fflag |= FSTAT_CHANGE;
+		LINES_CHANGED(cnf.select_ri);
 	}
 
 	return (0);
@@ -1194,6 +1204,7 @@ pad_block (const char *opt_curpos)
 		} else if (ret == 0) {
 			lp->lflag |= LSTAT_CHANGE;
 			SELECT_FI.fflag |= FSTAT_CHANGE;
+			LINES_CHANGED(cnf.select_ri);
 			mod++;
 		}
 		ret = 0;
@@ -1322,6 +1333,7 @@ lcut_block_engine (int curpos, int left)
 				mod++;
 				lp->lflag |= LSTAT_CHANGE;
 				SELECT_FI.fflag |= FSTAT_CHANGE;
+				LINES_CHANGED(cnf.select_ri);
 			}
 		} else {
 			if (lncol < lp->llen-1) {
@@ -1329,6 +1341,7 @@ lcut_block_engine (int curpos, int left)
 				mod++;
 				lp->lflag |= LSTAT_CHANGE;
 				SELECT_FI.fflag |= FSTAT_CHANGE;
+				LINES_CHANGED(cnf.select_ri);
 			}
 		}
 		next_lp (cnf.select_ri, &lp, NULL);
@@ -1394,6 +1407,7 @@ split_block (const char *opt_curpos)
 			mod++;
 			lx->lflag |= LSTAT_CHANGE;
 			SELECT_FI.fflag |= FSTAT_CHANGE;
+			LINES_CHANGED(cnf.select_ri);
 			SELECT_FI.num_lines++;
 		} else {
 			ret = 1;
@@ -1545,6 +1559,7 @@ join_block (const char *separator)
 		/* update */
 		SELECT_FI.num_lines--;
 		SELECT_FI.fflag |= FSTAT_CHANGE;
+		LINES_CHANGED(cnf.select_ri);
 
 		mod++;
 		next_lp (cnf.ring_curr, &lp_target, &cnt);
@@ -1573,6 +1588,7 @@ join_block (const char *separator)
 			lx->lflag |= LSTAT_SELECT;
 			lx->lflag |= LSTAT_CHANGE;
 			SELECT_FI.fflag |= FSTAT_CHANGE;
+			LINES_CHANGED(cnf.select_ri);
 
 			/* remove */
 			clr_opt_bookmark(lp_source);
@@ -22,22 +22,194 @@
 
 #include <config.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdlib.h>	/* strtol */
+#include <stdint.h>
 #include <errno.h>
+#include <time.h>
 #include <syslog.h>
+#include <unistd.h>	/* sysconf */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>		/* mmap munmap */
+#include <pthread.h>
+#include <dirent.h>		/* opendir readdir */
 #include "main.h"
 #include "proto.h"
 
 /* global config */
 extern CONFIG cnf;
 
+/* one chunk of the tags file for the parallel parser */
+typedef struct {
+	pthread_t tid;
+	const char *from, *to;	/* whole lines [from,to) of the mapping */
+	TAG *tags;		/* tags of this chunk, in file order */
+	int ntags;
+	char *strs;		/* the strings of the tags, each closed by '\0' (malloc/free) */
+	size_t strsize;
+	const char *lastfn;	/* the file name of the previous line and its copy */
+	unsigned lastfnlen;
+	char *lastfncopy;
+	int file_sorted;
+	int err1, err2, err3;
+	int started;
+} TAGCHUNK;
+
+/* one tags file of the list for the parallel loader */
+typedef struct {
+	pthread_t tid;
+	TAGFILE *tf;
+	TAG **index;		/* the tags of this file sorted by symbol */
+	int pos;		/* the next item of index in the merge */
+	int copy;		/* read the file, do not map it */
+	int ret;
+	int started;
+} TAGLOAD;
+
+/* the source files of the tags generator */
+typedef struct {
+	char **names;		/* relative to the root */
+	int n, size;
+} MKLIST;
+
+/* one chunk of the source files for the tags generator */
+typedef struct {
+	pthread_t tid;
+	char **files;		/* the source files, shared */
+	int from, to;		/* the range [from,to) */
+	const char *root;	/* the directory of the sources */
+	char *out;		/* ctags lines of the files in this chunk */
+	size_t outlen, outsize;
+	int err;
+	int started;
+} MKCHUNK;
+
+/* one source file of the reference search and its hits */
+typedef struct {
+	const char *prefix;	/* j2path of the tags file, or "" */
+	const char *fname;	/* the interned name */
+	char *out;		/* the "fname:lineno:line\n" hits, each closed by '\0' */
+	size_t outlen, outsize;
+	int hits;
+	int err;
+	int done;		/* with refs_lock */
+} REFFILE;
+
+/* the reference search, the workers take the files in order */
+typedef struct {
+	REFFILE *files;
+	int nfiles;
+	const char *symbol;
+	size_t symlen;
+	int next;		/* the next file to scan, with refs_lock */
+	int active;		/* running workers, with refs_lock */
+	int cancel;		/* with refs_lock */
+} REFJOB;
+static pthread_mutex_t refs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define TAG_CACHE_MAGIC	"EDATAG01"	/* tags cache file magic, with the format version */
+#define TAG_CACHE_NONE	0xffffffffU
+
+/* tags cache file layout: header, tag records in file order, symbol index, file table,
+* string table; the strings are offsets in the string table
+*/
+typedef struct {
+	char magic[8];
+	uint32_t ntags;
+	uint32_t nfiles;
+	uint32_t strsize;	/* size of the string table */
+	uint32_t reserved;
+	int64_t mtime;		/* the tags file at write time */
+	int64_t fsize;
+	char path[FNAMESIZE];	/* canonical path of the tags file */
+} TAGCHEAD;
+
+typedef struct {
+	uint32_t symbol;
+	uint32_t fname;		/* the offset of the interned name, one of the file table */
+	uint32_t pattern;	/* or TAG_CACHE_NONE */
+	int32_t lineno;
+	uint32_t type;
+} TAGCREC;
+
+/* resolved position of a pattern tag, the LINE pointer is not dereferenced before validation */
+typedef struct {
+	const TAG *tp;		/* the key, NULL if the slot is empty */
+	int ri;
+	const LINE *top;	/* the buffer of ri at resolve time */
+	LINE *lx;
+	int lineno;
+	unsigned lgen;		/* lx->lgen at resolve time */
+} TAGPOS;
+
+/* the position cache, direct mapped by the TAG pointer, emptied with the tags */
+static TAGPOS tag_pos[TAGS_POS_CACHE];
+#define TAG_POS_SLOT(tp)	( ((size_t)(tp) / sizeof(TAG)) % TAGS_POS_CACHE )
+
+/* the background reload of the tags file, reload_state and the results with reload_lock */
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t reload_tid;
+static int reload_state=0;		/* 0 idle, 1 running, 2 finished */
+static TAGDB *reload_db = NULL;
+static int reload_ret=0;
+static char reload_fname[FNAMESIZE];	/* the list of the loaded tags files */
+static time_t reload_mtime=0;		/* the last attempt */
+static off_t reload_fsize=0;
+static long long reload_t0=0, reload_msec=0;
+
 /* local proto */
-static TAG *tag_add (TAG *tp);
-static TAG *tag_rm (TAG *tp);
+static void *tag_reload_worker (void *arg);
+static void tag_reload_drop (void);
+static int tag_list_expand (char *list, size_t size);
+static int tag_list_changed (const TAGDB *db, time_t *mtime, off_t *fsize);
+static int tag_load_db (const char *list, TAGDB **dbp, int copy);
+static void tag_load_one (TAGLOAD *ld);
+static void *tag_load_worker (void *arg);
+static TAG **tag_merge_index (TAGLOAD *ld, int n, int ntags);
+static void tag_load_errlog (int ret);
+static size_t tag_memsize (const TAGDB *db);
+static int tag_map_file (TAGFILE *tf, int *file_sorted, int copy);
+static int tag_parse_map (TAGFILE *tf, const char *map, size_t mapsize, int *file_sorted);
+static void tag_parse_chunk (TAGCHUNK *ck);
+static void *tag_parse_worker (void *arg);
+static int tag_parse_line (TAGCHUNK *ck, const char *buff, unsigned tlen, TAG *tp, int lno);
+static char *tag_chunk_str (TAGCHUNK *ck, const char *str, unsigned len);
+static int tag_intern_files (TAGFILE *tf);
+static int tag_cache_path (const TAGFILE *tf, char *cpath, size_t csize, char *key, size_t ksize);
+static int tag_cache_map (TAGFILE *tf, TAG ***indexp);
+static int tag_cache_cmp (const void *p1, const void *p2);
+static int tag_cache_write (const TAGFILE *tf, TAG **index);
+static void tag_free_db (TAGDB *db);
+static void tag_set_j2path (TAGFILE *tf, const char *dir);
+static int tag_source_path (const TAG *tp, char *path, size_t size);
 static int tag_do (const char *arg_symbol, int flag);
 static int tag_items (const char *symbol, TAGTYPE type, int flag);
-static int tag_jump2_pattern (const char *fname, const char *pattern, int lineno);
+static TAG **tag_build_index (const TAGFILE *tf, int file_sorted);
+static void tag_merge_sort (TAG **items, TAG **tmp, int n);
+static int tag_lower_bound (const char *symbol);
+static int tag_fuzzy_score (const char *pat, const char *sym);
+static int tag_jump2_pattern (const TAG *tp, const char *pattern, int lineno);
+static LINE *tag_pos_lookup (const TAG *tp, int ri, const char *expr, int *lineno);
+static void tag_pos_save (const TAG *tp, int ri, LINE *lx, int lineno);
 static const char *tag_pattern_safe (const char *pattern);
+static int tag_refs_cmp (const void *p1, const void *p2);
+static void *tag_refs_worker (void *arg);
+static void tag_refs_scan (const REFJOB *job, REFFILE *rf);
+static int tag_refs_add (REFFILE *rf, const char *path, int lineno, const char *line, size_t len);
+static int tag_refs_append (REFFILE *rf, LINE **lp);
+static int tag_mk_walk (const char *root, const char *rel, int depth, MKLIST *ml);
+static int tag_mk_source (const char *name);
+static int tag_mk_cmp (const void *p1, const void *p2);
+static void tag_mk_free (MKLIST *ml);
+static void *tag_mk_worker (void *arg);
+static void tag_mk_scan (MKCHUNK *mk, const char *fname, const regex_t *regs);
+static int tag_mk_header (MKCHUNK *mk, const char *fname, const char *line, int lineno, int found, const regmatch_t *pmatch);
+static void tag_mk_define (MKCHUNK *mk, const char *fname, const char *line, const char *pp, int lineno);
+static void tag_mk_typedef (MKCHUNK *mk, const char *fname, const char *line, const char *pp, int lineno);
+static void tag_mk_name (MKCHUNK *mk, const char *fname, const char *line, const char *pp, int lineno, TAGTYPE type);
+static void tag_mk_add (MKCHUNK *mk, const char *sym, int len, const char *fname, const char *line, int lineno, TAGTYPE type);
+static int tag_mk_write (const TAGDB *db, const char *path);
 
 /* regexp specials are ^.[$()|*+?{\\ and maybe }] */
 
@@ -46,58 +218,6 @@ static const char *tag_pattern_safe (const char *pattern);
 #define MEMBER_SEARCH	0x01
 #define PARENT_SEARCH	0x02
 
-/*
-* add element after tp
-* return with the new pointer next after tp, or NULL
-*/
-static TAG *
-tag_add (TAG *tp)
-{
-	TAG *tx = NULL;
-
-	if ((tx = (TAG *) MALLOC(sizeof(TAG))) == NULL) {
-		ERRLOG(0xE028);
-		return NULL;
-	}
-	if (tp == NULL) {
-		/* root of chain */
-		tx->next = NULL;
-	} else {
-		/* bind-in after tp */
-		tx->next = tp->next;	/* save */
-		tp->next = tx;
-	}
-	tx->symbol = NULL;
-	tx->fname = NULL;
-	tx->type = TAG_UNDEF;
-	tx->lineno = 0;
-	tx->pattern = NULL;
-
-	return (tx);
-} /* tag_add */
-
-/*
-* remove tp (if not NULL)
-* return with the next element (or NULL)
-*/
-static TAG *
-tag_rm (TAG *tp)
-{
-	TAG *tx = NULL;
-
-	if (tp != NULL) {
-		tx = tp->next;		/* save */
-		FREE(tp->symbol); tp->symbol = NULL;
-		FREE(tp->fname); tp->fname = NULL;
-		if (tp->pattern != NULL) {
-			FREE(tp->pattern); tp->pattern = NULL;
-		}
-		FREE(tp); tp = NULL;
-	}
-
-	return (tx);
-} /* tag_rm */
-
 /*
 *
 * global functions
@@ -105,215 +225,54 @@ tag_rm (TAG *tp)
 */
 
 /*
-** tag_load_file - load or reload the content of "tags" file,
-**	the path configured in "tags_file" resource or given as argument
+** tag_load_file - load or reload the content of "tags" file, the path configured in "tags_file"
+**	resource or given as argument; a colon separated list of tags files is merged into one index
 */
 int
 tag_load_file (const char *tags_file)
 {
-	FILE *fp;
-	TAG *tp = NULL;
-	char *buff = NULL;
-	char *pp=NULL;
-	unsigned tlen, i, x, j;		/* i:pos x:length j:pos */
-	int chunk=0, comments=0, line_format=0;
-	int ret=0, err1=0, err2=0, err3=0;
-	unsigned als=0;
+	TAGDB *db = NULL;
+	int ret=0, i;
+	long long t0 = msec_clock();
 
 	if (tags_file != NULL && tags_file[0] != '\0') {
 		strncpy(cnf.tags_file, tags_file, sizeof(cnf.tags_file));
 		cnf.tags_file[sizeof(cnf.tags_file)-1] = '\0';
 	}
 
-	if (cnf.taglist != NULL) {
+	if (cnf.tagdb != NULL) {
 		tag_rm_all();
 	}
 
-	if (glob_tilde_expansion(cnf.tags_file, sizeof(cnf.tags_file)))
+	if (tag_list_expand(cnf.tags_file, sizeof(cnf.tags_file)))
 		return (1);
-	if ((fp = fopen(cnf.tags_file,"r")) == NULL) {
+
+	ret = tag_load_db(cnf.tags_file, &db, 0);
+	if (ret == -1) {
 		tracemsg("cannot open tags file [%s]", cnf.tags_file);
 		return (0);
 	}
 
-	/* get the directory part of tags file and add as prefix to the filenames */
-	cnf.tag_j2path[0] = '\0';
-	cnf.tag_j2len = 0;
-	mydirname(cnf.tag_j2path, cnf.tags_file, sizeof(cnf.tag_j2path));
-	cnf.tag_j2len = strlen(cnf.tag_j2path);
-	if (cnf.tag_j2len < (int)sizeof(cnf.tag_j2path)-1) {
-		cnf.tag_j2path[cnf.tag_j2len++] = '/';
-		cnf.tag_j2path[cnf.tag_j2len] = '\0';
+	cnf.trace=0;	/* drop previous msgs */
+	if (ret) {
+		tag_load_errlog(ret);
+		tracemsg ("tags load failed at %d", (db != NULL) ? db->ntags : 0);
+		tag_free_db(db);
 	} else {
-		cnf.tag_j2path[0] = '\0';
-		cnf.tag_j2len = 0;
-	}
-	// "tags file [%s] -> path to tags [%s] %d",
-	// cnf.tags_file, cnf.tag_j2path, cnf.tag_j2len
-
-	buff = MALLOC(TAGLINE_SIZE);
-	if (buff == NULL) {
-		ERRLOG(0xE027); // cannot allocate memory for reading tags file
-		err2 = 1;
-		ret = 1;
-	}
-
-	while (ret==0 && err2==0)
-	{
-		if (fgets (buff, TAGLINE_SIZE, fp) == NULL) {
-			if (ferror(fp)) {
-				ERRLOG(0xE091);
-				ret=2;
-			}
-			/* drop this line */
-			break;	/* eof or error : end */
-		}
-
-		/* drop comment line and continue */
-		if (buff[0] == '!') {
-			comments++;
-			continue;
-		}
-
-		/* get new pointer next after tp, or NULL */
-		tp = tag_add(tp);
-		if (tp == NULL) {
-			ERRLOG(0xE027); // tag_add failed (malloc)
-			ret=3;
-			err2++;
-			break;
-		}
-
-		/* save header once, later the tp pointers update the tail, where tp->next==NULL */
-		if (cnf.taglist == NULL) {
-			cnf.taglist = tp;
-		}
-
-		/*
-		* symbol<TAB>fname<TAB>lineno;"<TAB>type
-		* symbol<TAB>fname<TAB>lineno;"<TAB>type<TAB>extension_fields_optional
-		* symbol<TAB>fname<TAB>pattern;"<TAB>type
-		* symbol<TAB>fname<TAB>pattern;"<TAB>type<TAB>extension_fields_optional
-		*
-		* symbol<TAB>fname<TAB>lineno
-		* symbol<TAB>fname<TAB>pattern
-		*/
-
-		tlen = strlen(buff);
-		/* replace '\n' */
-		tlen--;
-		while (tlen > 0 && (buff[tlen-1]=='\n' || buff[tlen-1]=='\r')) {
-			tlen--;
-		}
-		buff[tlen] = '\0';
-
-		/* get symbol */
-		i=0;
-		pp = &buff[i];
-		for (x=0; i<tlen && buff[i]!='\t'; i++, x++)
-			;
-		buff[i++] = '\0';
-		als = ALLOCSIZE(x+1);
-		if ((tp->symbol = (char *) MALLOC(als)) == NULL) {
-			ERRLOG(0xE026);
-			err2++;		/* err2 : malloc error */
-		} else {
-			strncpy(tp->symbol, pp, x+1);
+		cnf.tagdb = db;
+		for (i=0; i < db->ntf; i++) {
+			if (db->tf[i].tags == NULL)
+				tracemsg("cannot open tags file [%s]", db->tf[i].path);
 		}
-		/* get fname */
-		pp = &buff[i];
-		for (x=0; i<tlen && buff[i]!='\t'; i++, x++)
-			;
-		buff[i++] = '\0';
-		als = ALLOCSIZE(x+1);
-		if ((tp->fname = (char *) MALLOC(als)) == NULL) {
-			ERRLOG(0xE025);
-			err2++;		/* err2 : malloc error */
+		if (db->ntf > 1) {
+			tracemsg ("%d symbols loaded from %d tags files: OK (%lld ms, %lu KiB)", db->ntags,
+				db->ntf, msec_clock() - t0, (unsigned long)(tag_memsize(db) >> 10));
 		} else {
-			strncpy(tp->fname, pp, x+1);
+			tracemsg ("%d symbols loaded: OK (%lld ms, %lu KiB)", db->ntags,
+				msec_clock() - t0, (unsigned long)(tag_memsize(db) >> 10));
 		}
-		/* get all the rest */
-		pp = &buff[i];
-		j = i;
-		for (x=0; i<tlen && !(buff[i]==';' && buff[i+1]=='"'); i++, x++)
-			;
-		if (buff[i] == ';') {
-			/* extended format */
-			buff[i] = '\0';		/* close pp, lineno or pattern */
-			i += 3;
-			line_format = 2;
-		}
-		else if (buff[j] >= '0' && buff[j] <= '9' && buff[i-1] >= '0' && buff[i-1] <= '9') {
-			buff[i] = '\0';		/* simple lineno */
-			line_format = 0;
-		}
-		else if (buff[j] == '/' && buff[i-1] == '/') {
-			buff[i] = '\0';		/* simple pattern */
-			line_format = 1;
-		}
-		else {
-			TAGS_LOG(LOG_ERR, "(line-format) chunk=%d : symbol [%s] pp [%s] ",
-				chunk+comments, tp->symbol, pp);
-			err1++;		/* err1 : wrong line format */
-			line_format = -1;
-		}
-
-		tp->pattern = NULL;
-		if (line_format == 0) {
-			tp->type = TAG_DEFINE;
-			tp->lineno = (int) strtol(pp, NULL, 10);
-		}
-		else if (line_format == 1) {
-			tp->type = TAG_FUNCTION;	/* or TAG_VARIABLE */
-			tp->lineno = 0;
-			als = ALLOCSIZE(x+1);
-			if ((tp->pattern = (char *) MALLOC(als)) == NULL) {
-				ERRLOG(0xE024);
-				err2++;		/* err2 : malloc error */
-			} else {
-				strncpy(tp->pattern, pp, x+1);
-			}
-		}
-		else if (line_format == 2) {	/* extended */
-			/* get the type */
-			tp->type = (TAGTYPE)buff[i++];
-
-			/*
-			 * lineno or pattern --- mandatory
-			 */
-			if (tp->type == TAG_DEFINE) {
-				tp->lineno = (int) strtol(pp, NULL, 10);
-			} else if (tp->type != TAG_UNDEF) {
-				tp->lineno = 0;
-				als = ALLOCSIZE(x+1);
-				if ((tp->pattern = (char *) MALLOC(als)) == NULL) {
-					ERRLOG(0xE023);
-					err2++;		/* err2 : malloc error */
-				} else {
-					strncpy(tp->pattern, pp, x+1);
-				}
-			} else {
-				TAGS_LOG(LOG_ERR, "(unknown-tagtype) chunk=%d symbol [%s] type 0x%X",
-					chunk+comments, tp->symbol, tp->type);
-				err3++;		/* err3 : unknown tagtype */
-				tp->type = TAG_UNDEF;
-			}
-
-		}/* line_format */
-
-		chunk++;
-	}/*while*/
-	fclose(fp);
-
-	cnf.trace=0;	/* drop previous msgs */
-	if (ret || err2) {
-		tracemsg ("tags load failed at %d", comments+chunk);
-	} else {
-		tracemsg ("%d symbols loaded: OK", chunk);
 	}
 
-	FREE(buff);
-	buff = NULL;
 	return (ret);
 } /* tag_load_file */
 
@@ -323,313 +282,2690 @@ tag_load_file (const char *tags_file)
 int
 tag_rm_all (void)
 {
-	TAG *tp = cnf.taglist;
+	tag_reload_drop();
+	tag_free_db(cnf.tagdb);
+	cnf.tagdb = NULL;
+	/* the cache is keyed by the TAG pointers */
+	memset(tag_pos, 0, sizeof(tag_pos));
 
-	while (tp != NULL) {
-		tp = tag_rm(tp);
+	return (0);
+} /* tag_rm_all */
+
+/*
+* tilde expansion of the names in the colon separated list of tags files, in place;
+* the name remains as it is if the expansion fails, empty names are dropped,
+* return 0 if ok, 1 if the result is too long
+*/
+static int
+tag_list_expand (char *list, size_t size)
+{
+	char out[sizeof(cnf.tags_file)];
+	char name[FNAMESIZE];
+	const char *p, *q;
+	size_t len, olen=0;
+
+	for (p = list; p != NULL; p = (q == NULL) ? NULL : q+1) {
+		q = strchr(p, ':');
+		len = (q == NULL) ? strlen(p) : (size_t)(q - p);
+		if (len == 0)
+			continue;
+		if (len >= sizeof(name))
+			return (1);
+		memcpy(name, p, len);
+		name[len] = '\0';
+		glob_tilde_expansion(name, sizeof(name));
+		len = strlen(name);
+		if (olen + len + 2 > sizeof(out))
+			return (1);
+		if (olen > 0)
+			out[olen++] = ':';
+		memcpy(out+olen, name, len);
+		olen += len;
 	}
-	cnf.taglist = NULL;
+	out[olen] = '\0';
 
+	if (olen >= size)
+		return (1);
+	memcpy(list, out, olen+1);
 	return (0);
-} /* tag_rm_all */
+} /* tag_list_expand */
 
 /*
-** tag_view_info - view symbol definition in a notification, gained from "tags" file
+* the directory of the tags file, the prefix of the relative filenames
 */
-int
-tag_view_info (const char *arg_symbol)
+static void
+tag_set_j2path (TAGFILE *tf, const char *dir)
 {
-	int ret=0;
+	strncpy(tf->j2path, dir, sizeof(tf->j2path));
+	tf->j2path[sizeof(tf->j2path)-1] = '\0';
+	tf->j2len = strlen(tf->j2path);
+	if (tf->j2len < (int)sizeof(tf->j2path)-1) {
+		tf->j2path[tf->j2len++] = '/';
+		tf->j2path[tf->j2len] = '\0';
+	} else {
+		tf->j2path[0] = '\0';
+		tf->j2len = 0;
+	}
+} /* tag_set_j2path */
 
-	ret = tag_do (arg_symbol, 0);
+/*
+* the path of the source file of the tag, the relative names get the directory
+* of their tags file as prefix; return 0 if ok, 1 if the path is too long
+*/
+static int
+tag_source_path (const TAG *tp, char *path, size_t size)
+{
+	const TAGFILE *tf;
+	const char *prefix = "";
+	int i;
+
+	if (tp->fname[0] != '/') {
+		for (i=0; i < cnf.tagdb->ntf; i++) {
+			tf = &cnf.tagdb->tf[i];
+			if (tf->tags != NULL && tp >= tf->tags && tp < tf->tags + tf->ntags) {
+				prefix = tf->j2path;
+				break;
+			}
+		}
+	}
+	if ((size_t)snprintf(path, size, "%s%s", prefix, tp->fname) >= size)
+		return (1);
 
-	return (ret==0);
-} /* tag_view_info */
+	return (0);
+} /* tag_source_path */
 
 /*
-** tag_jump_to - jump to the symbol definition, based on information gained from "tags" file
+** tag_reload_check - check the tags file in the idle time and rebuild the symbol index
+**	in the background if the file changed, swap the new index in when it is ready,
+**	return 1 if the index was swapped
 */
 int
-tag_jump_to (const char *arg_symbol)
+tag_reload_check (void)
 {
-	int ret=0;
+	int state, i;
+	size_t len;
+	TAGDB *old;
+	time_t mtime;
+	off_t fsize;
 
-	/* arg_symbol is maybe ""
-	 * possible call from main.c before cnf.bootup
-	 */
-	ret = tag_do (arg_symbol, JUMP_TO);
+	if (cnf.tagdb == NULL || cnf.tagdb->tf[0].mkflag == 1)
+		return (0);	/* nothing to watch */
 
-	return (ret!=1);
-} /* tag_jump_to */
+	pthread_mutex_lock (&reload_lock);
+	state = reload_state;
+	pthread_mutex_unlock (&reload_lock);
+
+	if (state == 1) {
+		/* still running, the old index serves the queries */
+		return (0);
+	}
+
+	if (state == 2) {
+		pthread_join (reload_tid, NULL);
+		reload_state = 0;
+		if (reload_ret) {
+			if (reload_ret > 0)
+				tag_load_errlog(reload_ret);
+			TAGS_LOG(LOG_ERR, "tags reload failed, ret=%d", reload_ret);
+			tag_free_db(reload_db);
+			reload_db = NULL;
+			return (0);
+		}
+		/* the same tags files, with their own j2path */
+		old = cnf.tagdb;
+		cnf.tagdb = reload_db;
+		reload_db = NULL;
+		tag_free_db(old);
+		memset(tag_pos, 0, sizeof(tag_pos));
+		tracemsg ("tags file reloaded: %d symbols (%lld ms)",
+			cnf.tagdb->ntags, reload_msec);
+		return (1);
+	}
+
+	if (tag_list_changed(cnf.tagdb, &mtime, &fsize) == 0)
+		return (0);
+	if (mtime == reload_mtime && fsize == reload_fsize)
+		return (0);	/* failed already */
+	if (mtime >= time(NULL) - 1)
+		return (0);	/* maybe ctags is writing it, wait */
+
+	reload_mtime = mtime;
+	reload_fsize = fsize;
+	/* all the files of the index, the list in cnf.tags_file may be different already */
+	reload_fname[0] = '\0';
+	for (i=0, len=0; i < cnf.tagdb->ntf; i++) {
+		len += (size_t)snprintf(reload_fname+len, sizeof(reload_fname)-len, "%s%s",
+			(i > 0) ? ":" : "", cnf.tagdb->tf[i].path);
+		if (len >= sizeof(reload_fname))
+			return (0);
+	}
+	reload_t0 = msec_clock();
+	reload_db = NULL;
+	reload_state = 1;
+	if (pthread_create (&reload_tid, NULL, tag_reload_worker, NULL) != 0) {
+		ERRLOG(0xE0D8);
+		reload_state = 0;
+	}
+
+	return (0);
+} /* tag_reload_check */
 
 /*
-** tag_jump_back - come back from the last tag jump
+* background thread of the tags reload
 */
-int
-tag_jump_back (void)
+static void *
+tag_reload_worker (void *arg)
 {
-	int jump;
-	/* return to the start position of tag_jump2_pattern() */
-	jump = mhist_pop();
-	return (jump);
-} /* tag_jump_back */
+	TAGDB *db = NULL;
+	int ret;
+
+	(void) arg;
+	/* the old index serves meanwhile, it does not refer to the tags file;
+	* read a private copy, ctags may truncate the file under a mapping */
+	ret = tag_load_db(reload_fname, &db, 1);
+
+	pthread_mutex_lock (&reload_lock);
+	reload_db = db;
+	reload_ret = ret;
+	reload_msec = msec_clock() - reload_t0;
+	reload_state = 2;
+	pthread_mutex_unlock (&reload_lock);
+	return (NULL);
+} /* tag_reload_worker */
 
 /*
-*
-* other static functions
-*
+* wait for the running reload and drop the result
 */
+static void
+tag_reload_drop (void)
+{
+	if (reload_state != 0) {
+		pthread_join (reload_tid, NULL);
+		tag_free_db(reload_db);
+		reload_db = NULL;
+		reload_state = 0;
+	}
+} /* tag_reload_drop */
 
 /*
-* start point for tag search
+* check the tags files of the index, return 1 if any of them changed since the load;
+* the newest mtime and the sum of the sizes go to *mtime and *fsize
 */
 static int
-tag_do (const char *arg_symbol, int flag)
+tag_list_changed (const TAGDB *db, time_t *mtime, off_t *fsize)
 {
-	const char *symbol=NULL;
-	char *get_symbol=NULL;
-	int ret=0;
+	struct stat st;
+	int i, changed=0;
+
+	*mtime = 0;
+	*fsize = 0;
+	for (i=0; i < db->ntf; i++) {
+		if (stat(db->tf[i].path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;	/* removed, the old index serves */
+		if (st.st_mtime != db->tf[i].mtime || st.st_size != db->tf[i].fsize)
+			changed = 1;
+		if (st.st_mtime > *mtime)
+			*mtime = st.st_mtime;
+		*fsize += st.st_size;
+	}
 
-	if (cnf.taglist == NULL) {
-		tracemsg ("tags file [%s] not loaded", cnf.tags_file);
-	} else {
-		if (arg_symbol[0] == '\0') {
-			get_symbol = select_word(CURR_LINE, CURR_FILE.lncol);
-			symbol = get_symbol;
-		} else {
-			symbol = arg_symbol;
-		}
+	return (changed);
+} /* tag_list_changed */
 
-		if (symbol != NULL && symbol[0] != '\0') {
-			if (symbol[0] == '.' || symbol[0] == '>') {
-				symbol++;
-			}
-			ret = tag_items (symbol, TAG_UNDEF, flag);	/* start to search... */
+/*
+* load the colon separated list of tags files into a new TAGDB, the files are loaded
+* independently on their own threads and the sorted indexes are merged,
+* this runs also in the background, no globals here; the files are read with copy, not mapped;
+* return 0 if ok, -1 if none of the files can be opened, other positive on failure,
+* the caller has to release *dbp
+*/
+static int
+tag_load_db (const char *list, TAGDB **dbp, int copy)
+{
+	TAGDB *db;
+	TAGLOAD *ld;
+	TAGFILE *tf;
+	char dir[FNAMESIZE];
+	const char *p, *q;
+	size_t len;
+	int n, i, ret=0, loaded=0;
+
+	*dbp = NULL;
+	for (n=1, p=list; (p = strchr(p, ':')) != NULL; p++)
+		n++;
+	if ((db = (TAGDB *) MALLOC(sizeof(TAGDB))) == NULL) {
+		return (1);
+	}
+	memset(db, 0, sizeof(TAGDB));
+	db->tf = (TAGFILE *) MALLOC(sizeof(TAGFILE) * (size_t)n);
+	ld = (TAGLOAD *) MALLOC(sizeof(TAGLOAD) * (size_t)n);
+	if (db->tf == NULL || ld == NULL) {
+		FREE(ld);
+		FREE(db->tf);
+		FREE(db);
+		return (1);
+	}
+	memset(db->tf, 0, sizeof(TAGFILE) * (size_t)n);
+	memset(ld, 0, sizeof(TAGLOAD) * (size_t)n);
+
+	/* the directory part of each tags file is the prefix of its relative filenames */
+	for (p = list; p != NULL; p = (q == NULL) ? NULL : q+1) {
+		q = strchr(p, ':');
+		len = (q == NULL) ? strlen(p) : (size_t)(q - p);
+		if (len == 0 || len >= sizeof(db->tf[0].path))
+			continue;
+		tf = &db->tf[db->ntf];
+		memcpy(tf->path, p, len);
+		tf->path[len] = '\0';
+		mydirname(dir, tf->path, sizeof(dir));
+		tag_set_j2path(tf, dir);
+		ld[db->ntf].tf = tf;
+		ld[db->ntf].copy = copy;
+		db->ntf++;
+	}
 
-			/* failure messages here */
-			if (flag & JUMP_TO) {
-				if (ret == 0) {
-					tracemsg ("cannot jump to symbol \"%s\".", symbol);
-				} else if (ret > 1) {
-					; /* multiple match -- ok */
-				} else if (ret < 0) {
-					tracemsg ("symbol \"%s\" search failed", symbol);
-				}
-			} else {
-				if (ret == 0) {
-					tracemsg ("cannot show symbol \"%s\".", symbol);
-				}
+	for (i=1; i < db->ntf; i++) {
+		if (pthread_create (&ld[i].tid, NULL, tag_load_worker, &ld[i]) == 0)
+			ld[i].started = 1;
+	}
+	if (db->ntf > 0)
+		tag_load_one (&ld[0]);
+	for (i=1; i < db->ntf; i++) {
+		if (ld[i].started)
+			pthread_join (ld[i].tid, NULL);
+		else
+			tag_load_one (&ld[i]);	/* no thread, do it here */
+	}
+
+	for (i=0; i < db->ntf; i++) {
+		if (ld[i].ret == -1)
+			continue;	/* not loaded, the reload check watches it */
+		if (ld[i].ret > 0 && ret == 0)
+			ret = ld[i].ret;
+		db->ntags += db->tf[i].ntags;
+		loaded++;
+	}
+	if (ret == 0 && loaded == 0) {
+		ret = -1;
+	} else if (ret == 0 && loaded == 1) {
+		for (i=0; ld[i].index == NULL; i++)
+			;
+		db->index = ld[i].index;
+		ld[i].index = NULL;
+	} else if (ret == 0 && (db->index = tag_merge_index(ld, db->ntf, db->ntags)) == NULL) {
+		ret = 4;
+	}
+
+	for (i=0; i < db->ntf; i++) {
+		FREE(ld[i].index);
+	}
+	FREE(ld);
+	if (ret == -1) {
+		tag_free_db(db);
+		return (-1);
+	}
+
+	*dbp = db;
+	return (ret);
+} /* tag_load_db */
+
+/*
+* load one tags file of the list from the cache file, or map, parse, intern the file names,
+* sort and write the cache file;
+* ld->ret is 0 if ok, -1 if the file cannot be opened, other positive on failure
+*/
+static void
+tag_load_one (TAGLOAD *ld)
+{
+	int file_sorted=0;
+
+	if (tag_cache_map(ld->tf, &ld->index) == 0) {
+		ld->ret = 0;
+		return;
+	}
+	ld->ret = tag_map_file(ld->tf, &file_sorted, ld->copy);
+	if (ld->ret == 0 && tag_intern_files(ld->tf)) {
+		ld->ret = 5;
+	}
+	if (ld->ret == 0 && (ld->index = tag_build_index(ld->tf, file_sorted)) == NULL) {
+		ld->ret = 4;
+	}
+	if (ld->ret == 0) {
+		tag_cache_write(ld->tf, ld->index);	/* for the next load */
+	}
+} /* tag_load_one */
+
+/*
+* worker thread of the tags loader
+*/
+static void *
+tag_load_worker (void *arg)
+{
+	tag_load_one ((TAGLOAD *) arg);
+	return (NULL);
+} /* tag_load_worker */
+
+/*
+* merge the sorted indexes of the loaded tags files, the same symbol remains
+* in list order and in file order, return the new index or NULL
+*/
+static TAG **
+tag_merge_index (TAGLOAD *ld, int n, int ntags)
+{
+	TAG **index;
+	int i, k, c, best, second;
+
+	if ((index = (TAG **) MALLOC(sizeof(TAG *) * (size_t)(ntags+1))) == NULL) {
+		return (NULL);
+	}
+	for (k=0; k < ntags; ) {
+		/* the smallest and the second smallest head */
+		best = second = -1;
+		for (i=0; i < n; i++) {
+			if (ld[i].index == NULL || ld[i].pos >= ld[i].tf->ntags)
+				continue;
+			if (best == -1 || strcmp(ld[i].index[ld[i].pos]->symbol, ld[best].index[ld[best].pos]->symbol) < 0) {
+				second = best;
+				best = i;
+			} else if (second == -1 || strcmp(ld[i].index[ld[i].pos]->symbol, ld[second].index[ld[second].pos]->symbol) < 0) {
+				second = i;
 			}
-		} else {
-			tracemsg ("no symbol given");
 		}
-		FREE(get_symbol); get_symbol = NULL;
+		/* take the run of the best file up to the head of the second */
+		do {
+			index[k++] = ld[best].index[ld[best].pos++];
+			if (ld[best].pos >= ld[best].tf->ntags)
+				break;
+			if (second == -1)
+				continue;
+			c = strcmp(ld[best].index[ld[best].pos]->symbol, ld[second].index[ld[second].pos]->symbol);
+			if (c > 0 || (c == 0 && best > second))
+				break;
+		} while (k < ntags);
 	}
 
-	return (ret);	/* symbols found */
-} /* tag_do */
+	return (index);
+} /* tag_merge_index */
 
 /*
-* symbol<TAB>fname<TAB>lineno;"<TAB>type
-* symbol<TAB>fname<TAB>lineno;"<TAB>type<TAB>extension_fields_optional
-* symbol<TAB>fname<TAB>pattern;"<TAB>type
-* symbol<TAB>fname<TAB>pattern;"<TAB>type<TAB>extension_fields_optional
-*
-* symbol<TAB>fname<TAB>lineno
-* symbol<TAB>fname<TAB>pattern
+* the error log of tag_load_db failures
 */
+static void
+tag_load_errlog (int ret)
+{
+	switch (ret) {
+	case 1:
+		ERRLOG(0xE027);	// cannot allocate memory for tags
+		break;
+	case 2:
+		ERRLOG(0xE091);	// cannot map tags file
+		break;
+	case 3:
+		ERRLOG(0xE026);	// cannot allocate memory for the tag records
+		break;
+	case 4:
+		ERRLOG(0xE0D7);	// cannot allocate memory for the symbol index
+		break;
+	default:
+		ERRLOG(0xE025);	// cannot allocate memory for the file names
+		break;
+	}
+} /* tag_load_errlog */
 
 /*
-* type: TAG_UNDEF or filter search
-* flag: JUMP_TO
-* return value: matching symbols found
+* memory used by the loaded tags
 */
-static int
-tag_items (const char *symbol, TAGTYPE type, int flag)
+static size_t
+tag_memsize (const TAGDB *db)
 {
-	TAG *tp = cnf.taglist;
-	int count = 0;
-	const char *jump_fname = "ah";
-	const char *jump_pattern = "oh";
-	int jump_lineno = 0;
-	static int saved_count = -100;
-	static char saved_symbol[TAGSTR_SIZE] = "";
+	size_t size;
+	int i;
 
-	if (saved_count == -100) {
-		/* runtime init */
-		memset(saved_symbol, 0, sizeof(saved_symbol));
-		saved_count = -1;
+	size = sizeof(TAG *) * (size_t)db->ntags + sizeof(TAGFILE) * (size_t)db->ntf;
+	for (i=0; i < db->ntf; i++) {
+		size += db->tf[i].strsize + db->tf[i].mapsize + sizeof(TAG) * (size_t)db->tf[i].ntags
+			+ sizeof(char *) * (size_t)db->tf[i].nfiles;
 	}
 
-	if (flag & JUMP_TO) {
-		if ((saved_count == -1) || (strncmp(saved_symbol, symbol, sizeof(saved_symbol)-1) != 0)) {
-			memset(saved_symbol, 0, sizeof(saved_symbol));
-			strncat(saved_symbol, symbol, sizeof(saved_symbol)-1);
-			saved_count = 0;
+	return (size);
+} /* tag_memsize */
+
+/*
+* map the tags file read-only, parse the lines and unmap the file, the strings go to the arenas;
+* a rewrite of the tags file cannot hurt the loaded tags; with copy the file is read into
+* a temporary buffer instead, a truncation while parsing cannot fault,
+* return 0 if ok, -1 if the file cannot be opened, other positive on failure
+*/
+static int
+tag_map_file (TAGFILE *tf, int *file_sorted, int copy)
+{
+	int fd, ret;
+	struct stat st;
+	char *p=NULL;
+	size_t size=0;
+	ssize_t n;
+
+	if ((fd = open(tf->path, O_RDONLY)) == -1)
+		return (-1);
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return (-1);
+	}
+	tf->mtime = st.st_mtime;
+	tf->fsize = st.st_size;
+	if (st.st_size > 0 && copy) {
+		if ((p = (char *) MALLOC((size_t)st.st_size)) == NULL) {
+			close(fd);
+			return (1);
 		}
+		while (size < (size_t)st.st_size && (n = read(fd, p+size, (size_t)st.st_size - size)) > 0)
+			size += (size_t)n;
+		/* short, the file is being rewritten, the size does not match and it is loaded again */
+		tf->fsize = (off_t)size;
+	} else if (st.st_size > 0) {
+		p = (char *) mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			close(fd);
+			return (2);
+		}
+		size = (size_t)st.st_size;
 	}
+	close(fd);
 
-	// "query symbol [%s] type %c flag 0x%X",
-	// symbol, (type==TAG_UNDEF ? '?' : type), flag);
+	ret = tag_parse_map(tf, p, size, file_sorted);
+	if (copy) {
+		FREE(p);
+	} else if (p != NULL) {
+		munmap(p, size);
+	}
 
-	while (tp != NULL)
-	{
-		if ((strncmp (tp->symbol, symbol, TAGSTR_SIZE) == 0) &&
-			((type == TAG_UNDEF) || (type == tp->type)))
-		{
-			// "match symbol [%s] fname [%s] type %c lineno %d pattern [%s]",
-			// tp->symbol, tp->fname, tp->type, tp->lineno, tp->pattern
+	return (ret);
+} /* tag_map_file */
 
-			if (flag & JUMP_TO) {
-				if (tp->type == TAG_DEFINE) {
-					if (count==0 || count==saved_count) {
-						jump_fname = tp->fname;
-						jump_pattern = NULL;
-						jump_lineno = tp->lineno;
-					}
-					count++;
-				} else if (tp->type != TAG_UNDEF) {
-					if (count==0 || count==saved_count) {
-						jump_fname = tp->fname;
-						jump_pattern = tp->pattern;
-						jump_lineno = -1;
-					}
-					count++;
-				} else {
-					tracemsg ("(type:%c) %s %s %s", tp->type, tp->symbol, tp->fname, tp->pattern);
-				}
-			} else {
-				if (tp->type == TAG_DEFINE) {
-					if (show_define(tp->fname, tp->lineno)) {
-						/* failed */
-						tracemsg ("not found: [%s] %s :%d", tp->symbol, tp->fname, tp->lineno);
-					}
-					count++;
-				} else {
-					if (tp->type != TAG_UNDEF)
-						count++;
-					tracemsg ("(type:%c) %s %s %s", tp->type, tp->symbol, tp->fname, tp->pattern);
-				}
+/*
+* parse the lines of the map, the tag records go into one array and the strings
+* into the arenas of the chunks; large files are split at line boundaries and the chunks
+* are parsed on worker threads, return 0 if ok, other positive on failure
+*/
+static int
+tag_parse_map (TAGFILE *tf, const char *map, size_t mapsize, int *file_sorted)
+{
+	const char *p, *end, *nl;
+	TAGCHUNK chunk[TAGS_PAR_THREADS];
+	int nth=1, i, ret=0;
+	int err1=0, err3=0;
+	long ncpu;
+
+	if (mapsize == 0) {
+		/* empty */
+		tf->tags = (TAG *) MALLOC(sizeof(TAG));
+		return ((tf->tags == NULL) ? 3 : 0);
+	}
+	end = map + mapsize;
+
+	if (mapsize >= TAGS_PAR_SIZE) {
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nth = (ncpu > TAGS_PAR_THREADS) ? TAGS_PAR_THREADS : (int)ncpu;
+		if (nth < 1)
+			nth = 1;
+	}
+
+	/* split at line boundaries */
+	memset (chunk, 0, sizeof(chunk));
+	p = map;
+	for (i=0; i < nth; i++) {
+		chunk[i].from = p;
+		if (i == nth-1) {
+			p = end;
+		} else {
+			p = map + (size_t)((unsigned long long)mapsize * (unsigned)(i+1) / (unsigned)nth);
+			if (p < chunk[i].from)
+				p = chunk[i].from;
+			if (p > map && p < end && p[-1] != '\n') {
+				nl = memchr(p, '\n', (size_t)(end - p));
+				p = (nl == NULL) ? end : nl+1;
 			}
 		}
+		chunk[i].to = p;
+	}
 
-		tp = tp->next;
+	for (i=1; i < nth; i++) {
+		if (pthread_create (&chunk[i].tid, NULL, tag_parse_worker, &chunk[i]) == 0)
+			chunk[i].started = 1;
+	}
+	tag_parse_chunk (&chunk[0]);
+	for (i=1; i < nth; i++) {
+		if (chunk[i].started)
+			pthread_join (chunk[i].tid, NULL);
+		else
+			tag_parse_chunk (&chunk[i]);	/* no thread, do it here */
 	}
 
-	if ((flag & JUMP_TO) && (count > 0)) {
-		saved_count++;
-		if (tag_jump2_pattern (jump_fname, jump_pattern, jump_lineno)) {
-			/* failed */
-			count = -count;
-			saved_count = -1;
+	/* merge the chunks in file order */
+	for (i=0; i < nth; i++) {
+		if (chunk[i].err2)
+			ret = 3;
+		tf->ntags += chunk[i].ntags;
+		*file_sorted |= chunk[i].file_sorted;
+		err1 += chunk[i].err1;
+		err3 += chunk[i].err3;
+	}
+	if (ret == 0) {
+		if (nth == 1) {
+			tf->tags = chunk[0].tags;
+			chunk[0].tags = NULL;
+		} else if ((tf->tags = (TAG *) MALLOC(sizeof(TAG) * (size_t)(tf->ntags+1))) == NULL) {
+			ret = 3;
 		} else {
-			if (count > 1) {
-				tracemsg ("symbol \"%s\" multiple match (%d of %d)",
-					symbol, saved_count, count);
+			for (tf->ntags=0, i=0; i < nth; i++) {
+				memcpy(&tf->tags[tf->ntags], chunk[i].tags, sizeof(TAG) * (size_t)chunk[i].ntags);
+				tf->ntags += chunk[i].ntags;
 			}
 		}
-		if (saved_count == count) {
-			saved_count = -1;
+	}
+	for (i=0; i < nth; i++) {
+		FREE(chunk[i].tags);
+		if (ret == 0) {
+			tf->strs[i] = chunk[i].strs;
+			tf->strsize += chunk[i].strsize;
+		} else {
+			FREE(chunk[i].strs);
 		}
 	}
+	if (ret) {
+		tf->ntags = 0;
+		return (ret);
+	}
 
-	return (count);	/* number of symbols found */
-} /* tag_items */
+	if (err1 || err3) {
+		TAGS_LOG(LOG_NOTICE, "tags file %s: %d wrong lines, %d unknown types", tf->path, err1, err3);
+	}
+	TAGS_LOG(LOG_INFO, "tags file %s: %d symbols, %d threads", tf->path, tf->ntags, nth);
+
+	return (0);
+} /* tag_parse_map */
 
 /*
-* do the hard work in tag searching
+* parse the lines of one chunk into its own tag array and string arena,
+* the arena is large enough for the fields of all lines, the pages of the skipped
+* bytes are not used
 */
-static int
-tag_jump2_pattern (const char *fname, const char *pattern, int lineno)
+static void
+tag_parse_chunk (TAGCHUNK *ck)
 {
-	int ret=1;
-	int from_ring, from_lineno;
-	LINE *lx = NULL;
-	const char *expr;
-	int lineno2;
-	const char *fnp=NULL;
-	int rest = 0;
+	const char *p, *nl;
+	int nlines=0, lno=0;
+	unsigned tlen;
+
+	for (p = ck->from; p < ck->to && (nl = memchr(p, '\n', (size_t)(ck->to - p))) != NULL; p = nl+1)
+		nlines++;
+
+	ck->tags = (TAG *) MALLOC(sizeof(TAG) * (size_t)(nlines+1));
+	ck->strs = (char *) MALLOC((size_t)(ck->to - ck->from) + 2 * (size_t)nlines + 1);
+	if (ck->tags == NULL || ck->strs == NULL) {
+		ck->err2 = 1;
+		return;
+	}
 
-	from_ring = cnf.ring_curr;
-	from_lineno = cnf.fdata[cnf.ring_curr].lineno;
+	/* the final line without newline is dropped, like a truncated one */
+	for (p = ck->from; p < ck->to && (nl = memchr(p, '\n', (size_t)(ck->to - p))) != NULL; p = nl+1)
+	{
+		lno++;
+		/* drop comment line and continue */
+		if (p[0] == '!') {
+			if (nl - p >= 19 && strncmp(p, "!_TAG_FILE_SORTED\t1", 19) == 0)
+				ck->file_sorted = 1;
+			continue;
+		}
+
+		tlen = (unsigned)(nl - p);
+		while (tlen > 0 && p[tlen-1] == '\r') {
+			tlen--;
+		}
+		switch (tag_parse_line(ck, p, tlen, &ck->tags[ck->ntags], lno)) {
+		case 1:
+			ck->err1++;	/* err1 : wrong line format */
+			break;
+		case 3:
+			ck->err3++;	/* err3 : unknown tagtype */
+			break;
+		default:
+			break;
+		}
+		ck->ntags++;
+	}
+
+	return;
+} /* tag_parse_chunk */
+
+/*
+* worker thread of the tags parser
+*/
+static void *
+tag_parse_worker (void *arg)
+{
+	tag_parse_chunk ((TAGCHUNK *) arg);
+	return (NULL);
+} /* tag_parse_worker */
 
-	if (fname[0] == '/') {
-		fnp = fname;
+/*
+* parse one line of the tags file, buff[tlen] is the end of line, the fields are copied
+* to the arena of the chunk, the file name of the previous line is not copied again;
+* return 0 if ok, 1 for wrong line format, 3 for unknown tag type
+*
+* symbol<TAB>fname<TAB>lineno;"<TAB>type
+* symbol<TAB>fname<TAB>lineno;"<TAB>type<TAB>extension_fields_optional
+* symbol<TAB>fname<TAB>pattern;"<TAB>type
+* symbol<TAB>fname<TAB>pattern;"<TAB>type<TAB>extension_fields_optional
+*
+* symbol<TAB>fname<TAB>lineno
+* symbol<TAB>fname<TAB>pattern
+*/
+static int
+tag_parse_line (TAGCHUNK *ck, const char *buff, unsigned tlen, TAG *tp, int lno)
+{
+	const char *pp=NULL;
+	unsigned i, x, j, f;		/* i:pos x:length j:pos f:pos */
+	int line_format=0;
+
+	(void) lno;	/* for the log only */
+	tp->type = TAG_UNDEF;
+	tp->lineno = 0;
+	tp->pattern = NULL;
+
+	/* get symbol */
+	for (i=0; i<tlen && buff[i]!='\t'; i++)
+		;
+	tp->symbol = tag_chunk_str(ck, buff, i);
+	if (i < tlen)
+		i++;
+	/* get fname */
+	f = i;
+	for (; i<tlen && buff[i]!='\t'; i++)
+		;
+	if (ck->lastfn != NULL && ck->lastfnlen == i-f && memcmp(ck->lastfn, &buff[f], i-f) == 0) {
+		tp->fname = ck->lastfncopy;
 	} else {
-		cnf.tag_j2path[cnf.tag_j2len] = '\0';
-		rest = sizeof(cnf.tag_j2path) - (size_t)cnf.tag_j2len;
-		if (rest > 1) {
-			strncat(&cnf.tag_j2path[cnf.tag_j2len], fname, (size_t)rest-1);
-			fnp = cnf.tag_j2path;
+		tp->fname = tag_chunk_str(ck, &buff[f], i-f);
+		ck->lastfn = &buff[f];
+		ck->lastfnlen = i-f;
+		ck->lastfncopy = tp->fname;
+	}
+	if (i < tlen)
+		i++;
+	/* get all the rest */
+	pp = &buff[i];
+	j = i;
+	for (x=0; i<tlen && !(buff[i]==';' && buff[i+1]=='"'); i++, x++)
+		;
+	if (i < tlen && buff[i] == ';') {
+		/* extended format, pp is lineno or pattern */
+		line_format = 2;
+	}
+	else if (x > 0 && buff[j] >= '0' && buff[j] <= '9' && buff[i-1] >= '0' && buff[i-1] <= '9') {
+		line_format = 0;	/* simple lineno */
+	}
+	else if (x > 0 && buff[j] == '/' && buff[i-1] == '/') {
+		line_format = 1;	/* simple pattern */
+	}
+	else {
+		TAGS_LOG(LOG_ERR, "(line-format) line=%d : symbol [%s] pp [%.*s] ",
+			lno, tp->symbol, (int)x, pp);
+		return (1);
+	}
+
+	/* the digits end before the ';' or the end of line */
+	if (line_format == 0) {
+		tp->type = TAG_DEFINE;
+		tp->lineno = (int) strtol(pp, NULL, 10);
+	}
+	else if (line_format == 1) {
+		tp->type = TAG_FUNCTION;	/* or TAG_VARIABLE */
+		tp->pattern = tag_chunk_str(ck, pp, x);
+	}
+	else {
+		/* extended, get the type */
+		i += 3;
+		tp->type = (i < tlen) ? (TAGTYPE)buff[i] : TAG_UNDEF;
+
+		/*
+		 * lineno or pattern --- mandatory
+		 */
+		if (tp->type == TAG_DEFINE) {
+			tp->lineno = (int) strtol(pp, NULL, 10);
+		} else if (tp->type != TAG_UNDEF) {
+			tp->pattern = tag_chunk_str(ck, pp, x);
 		} else {
-			TAGS_LOG(LOG_ERR, "tag jump, cannot get path to %s from tags file", fname);
-			ret = 1;
+			TAGS_LOG(LOG_ERR, "(unknown-tagtype) line=%d symbol [%s] type 0x%X",
+				lno, tp->symbol, tp->type);
+			return (3);
 		}
 	}
 
-	/* open file or switch to
-	 */
-	if (fnp != NULL && add_file(fnp) == 0) {
-		/* cnf.ring_curr already set by add_file() */
+	return (0);
+} /* tag_parse_line */
 
-		if (CURR_FILE.fflag & FSTAT_SCRATCH) {
-			// does not exist?
-			ret=2;
+/*
+* copy the string to the arena of the chunk, return the copy
+*/
+static char *
+tag_chunk_str (TAGCHUNK *ck, const char *str, unsigned len)
+{
+	char *p = ck->strs + ck->strsize;
 
-		} else if (lineno >= 1 && lineno <= CURR_FILE.num_lines) {
-			lx = lll_goto_lineno (cnf.ring_curr, lineno);
-			if (TEXT_LINE(lx))
-				ret = 0;
+	memcpy(p, str, len);
+	p[len] = '\0';
+	ck->strsize += len + 1;
 
-		} else if (pattern != NULL) {
-			expr = tag_pattern_safe (pattern);
-			lx = search_goto_pattern (cnf.ring_curr, expr, &lineno2);
-			lineno = lineno2;
-			if (TEXT_LINE(lx))
-				ret = 0;
+	return (p);
+} /* tag_chunk_str */
+
+/*
+* intern the file names of the tags, the same name is stored once and
+* the tags point to the first occurrence in the arenas,
+* return 0 if ok, 1 on failure
+*/
+static int
+tag_intern_files (TAGFILE *tf)
+{
+	unsigned *fhash;
+	unsigned hsize=1024, mask, h, slot;
+	int files_size=64;
+	int ti, k;
+	char **files;
+	const char *s;
+
+	tf->files = NULL;
+	tf->nfiles = 0;
+	if ((tf->files = (char **) MALLOC(sizeof(char *) * (size_t)files_size)) == NULL) {
+		return (1);
+	}
+	if ((fhash = (unsigned *) MALLOC(sizeof(unsigned) * hsize)) == NULL) {
+		return (1);
+	}
+	memset(fhash, 0, sizeof(unsigned) * hsize);
+
+	for (ti=0; ti < tf->ntags; ti++)
+	{
+		/* the previous tag is mostly in the same file */
+		if (ti > 0 && strcmp(tf->tags[ti-1].fname, tf->tags[ti].fname) == 0) {
+			tf->tags[ti].fname = tf->tags[ti-1].fname;
+			continue;
+		}
+
+		h = 2166136261U;
+		for (s = tf->tags[ti].fname; *s != '\0'; s++)
+			h = (h ^ (unsigned char)*s) * 16777619U;
+		mask = hsize - 1;
+		for (slot = h & mask; fhash[slot] != 0; slot = (slot + 1) & mask) {
+			if (strcmp(tf->files[fhash[slot]-1], tf->tags[ti].fname) == 0)
+				break;
+		}
+		if (fhash[slot] != 0) {
+			tf->tags[ti].fname = tf->files[fhash[slot]-1];
+			continue;
+		}
+
+		/* new file name */
+		if (tf->nfiles >= files_size) {
+			files_size *= 2;
+			if ((files = (char **) REALLOC(tf->files, sizeof(char *) * (size_t)files_size)) == NULL) {
+				FREE(fhash);
+				return (1);
+			}
+			tf->files = files;
+		}
+		tf->files[tf->nfiles++] = tf->tags[ti].fname;
+		fhash[slot] = (unsigned)tf->nfiles;
+
+		/* keep the load factor under 1/2 */
+		if ((unsigned)tf->nfiles * 2 > hsize) {
+			FREE(fhash);
+			hsize *= 2;
+			if ((fhash = (unsigned *) MALLOC(sizeof(unsigned) * hsize)) == NULL) {
+				return (1);
+			}
+			memset(fhash, 0, sizeof(unsigned) * hsize);
+			mask = hsize - 1;
+			for (k=0; k < tf->nfiles; k++) {
+				h = 2166136261U;
+				for (s = tf->files[k]; *s != '\0'; s++)
+					h = (h ^ (unsigned char)*s) * 16777619U;
+				for (slot = h & mask; fhash[slot] != 0; slot = (slot + 1) & mask)
+					;
+				fhash[slot] = (unsigned)k+1;
+			}
 		}
 	}
+	FREE(fhash);
 
-	if (ret == 0 && lx != NULL) {
-		if (cnf.bootup) {
-			mhist_push (from_ring, from_lineno);
+	return (0);
+} /* tag_intern_files */
+
+/*
+* the path of the cache file of the tags file in the ~/.eda/ directory and the key,
+* the canonical path of the tags file; return 0 if ok, 1 if the path is too long
+*/
+static int
+tag_cache_path (const TAGFILE *tf, char *cpath, size_t csize, char *key, size_t ksize)
+{
+	char *fullpath;
+	unsigned hash = 2166136261U;
+	int i;
+
+	if ((fullpath = canonicalpath(tf->path)) == NULL)
+		return (1);
+	if (strlen(fullpath) >= ksize) {
+		FREE(fullpath);
+		return (1);
+	}
+	strncpy(key, fullpath, ksize);
+	FREE(fullpath);
+	for (i=0; key[i] != '\0'; i++) {
+		hash = (hash ^ (unsigned char)key[i]) * 16777619U;
+	}
+	snprintf(cpath, csize, "%stags-%08x.tcache", cnf.myhome, hash);
+
+	return (0);
+} /* tag_cache_path */
+
+/*
+* map the cache file of the tags file if it matches the path, mtime and size of the
+* tags file; the strings remain in the mapping, only the pointers are set up, no parsing,
+* the symbol index goes to *indexp; return 0 if ok, other positive if the file must be parsed
+*/
+static int
+tag_cache_map (TAGFILE *tf, TAG ***indexp)
+{
+	char cpath[sizeof(cnf.myhome)+SHORTNAME];
+	char key[FNAMESIZE];
+	struct stat st, cst;
+	char *map, *strs;
+	const TAGCHEAD *head;
+	const TAGCREC *rec;
+	const uint32_t *order, *foff;
+	TAG *tags=NULL;
+	TAG **index=NULL;
+	char **files=NULL;
+	uint32_t i, n, nf, ss;
+	size_t expected;
+	int fd;
+
+	if (stat(tf->path, &st) != 0 || !S_ISREG(st.st_mode))
+		return (1);
+	if (tag_cache_path(tf, cpath, sizeof(cpath), key, sizeof(key)))
+		return (1);
+	if ((fd = open(cpath, O_RDONLY)) == -1)
+		return (1);
+	if (fstat(fd, &cst) != 0 || (size_t)cst.st_size < sizeof(TAGCHEAD)) {
+		close(fd);
+		return (1);
+	}
+	map = (char *) mmap(NULL, (size_t)cst.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (2);
+
+	/* validate the header, the key and the size */
+	head = (const TAGCHEAD *)(const void *)map;
+	n = head->ntags;
+	nf = head->nfiles;
+	ss = head->strsize;
+	expected = sizeof(TAGCHEAD) + sizeof(TAGCREC) * (size_t)n
+		+ sizeof(uint32_t) * ((size_t)n + (size_t)nf) + (size_t)ss;
+	if (memcmp(head->magic, TAG_CACHE_MAGIC, 8) != 0 || expected != (size_t)cst.st_size ||
+	n > 0x7fffffffU || ss == 0 || head->mtime != (int64_t)st.st_mtime || head->fsize != (int64_t)st.st_size ||
+	strncmp(head->path, key, sizeof(head->path)) != 0)
+	{
+		munmap(map, (size_t)cst.st_size);
+		return (1);	/* stale or foreign */
+	}
+	rec = (const TAGCREC *)(const void *)(map + sizeof(TAGCHEAD));
+	order = (const uint32_t *)(const void *)(map + sizeof(TAGCHEAD) + sizeof(TAGCREC) * (size_t)n);
+	foff = order + n;
+	strs = map + (expected - ss);
+
+	tags = (TAG *) MALLOC(sizeof(TAG) * ((size_t)n+1));
+	index = (TAG **) MALLOC(sizeof(TAG *) * ((size_t)n+1));
+	files = (char **) MALLOC(sizeof(char *) * ((size_t)nf+1));
+	if (tags == NULL || index == NULL || files == NULL || strs[ss-1] != '\0') {
+		FREE(files);
+		FREE(index);
+		FREE(tags);
+		munmap(map, (size_t)cst.st_size);
+		return (3);
+	}
+
+	/* set up the pointers, with bounds check of the offsets */
+	for (i=0; i < nf && foff[i] < ss; i++) {
+		files[i] = strs + foff[i];
+	}
+	if (i == nf) {
+		for (i=0; i < n; i++) {
+			if (rec[i].symbol >= ss || rec[i].fname >= ss || order[i] >= n ||
+			(rec[i].pattern != TAG_CACHE_NONE && rec[i].pattern >= ss))
+				break;
+			tags[i].symbol = strs + rec[i].symbol;
+			tags[i].fname = strs + rec[i].fname;
+			tags[i].pattern = (rec[i].pattern == TAG_CACHE_NONE) ? NULL : strs + rec[i].pattern;
+			tags[i].lineno = rec[i].lineno;
+			tags[i].type = (TAGTYPE) rec[i].type;
+			index[i] = &tags[order[i]];
 		}
-		set_position (cnf.ring_curr, lineno, lx);
-	} else {
-		cnf.ring_curr = from_ring;
+	}
+	if (i != n) {
+		FREE(files);
+		FREE(index);
+		FREE(tags);
+		munmap(map, (size_t)cst.st_size);
+		return (1);	/* broken */
+	}
+
+	tf->map = map;
+	tf->mapsize = (size_t)cst.st_size;
+	tf->mtime = st.st_mtime;
+	tf->fsize = st.st_size;
+	tf->tags = tags;
+	tf->ntags = (int)n;
+	tf->files = files;
+	tf->nfiles = (int)nf;
+	*indexp = index;
+	TAGS_LOG(LOG_INFO, "tags file %s: %d symbols from cache %s", tf->path, tf->ntags, cpath);
+
+	return (0);
+} /* tag_cache_map */
+
+/*
+* compare the interned file name pointers
+*/
+static int
+tag_cache_cmp (const void *p1, const void *p2)
+{
+	uintptr_t a = (uintptr_t) *(char *const *)p1;
+	uintptr_t b = (uintptr_t) *(char *const *)p2;
+
+	return ((a < b) ? -1 : (a > b));
+} /* tag_cache_cmp */
+
+/*
+* write the parsed tags file and its symbol index to the cache file, keyed by the path,
+* mtime and size of the tags file; the new file replaces the old one by rename,
+* return 0 if ok, 1 if not possible, 2 if write failed
+*/
+static int
+tag_cache_write (const TAGFILE *tf, TAG **index)
+{
+	char cpath[sizeof(cnf.myhome)+SHORTNAME];
+	char tmppath[sizeof(cnf.myhome)+SHORTNAME+4];
+	TAGCHEAD head;
+	TAGCREC rec;
+	char **sorted=NULL;
+	uint32_t *foff=NULL;
+	uint32_t buff[1024];
+	uint64_t off=0;
+	const TAG *tp;
+	int i, j, lo, hi, mid, last=-1;
+	FILE *fp;
+	int ret=0;
+
+	if (tf->ntags == 0 || tf->nfiles == 0)
+		return (1);
+	memset(&head, 0, sizeof(head));
+	if (tag_cache_path(tf, cpath, sizeof(cpath), head.path, sizeof(head.path)))
+		return (1);
+	memcpy(head.magic, TAG_CACHE_MAGIC, 8);
+	head.ntags = (uint32_t)tf->ntags;
+	head.nfiles = (uint32_t)tf->nfiles;
+	head.mtime = (int64_t)tf->mtime;
+	head.fsize = (int64_t)tf->fsize;
+
+	/* the file names first in the string table, sorted by the interned pointers for the lookup */
+	sorted = (char **) MALLOC(sizeof(char *) * (size_t)tf->nfiles);
+	foff = (uint32_t *) MALLOC(sizeof(uint32_t) * (size_t)tf->nfiles);
+	if (sorted == NULL || foff == NULL) {
+		FREE(foff);
+		FREE(sorted);
+		return (1);
+	}
+	memcpy(sorted, tf->files, sizeof(char *) * (size_t)tf->nfiles);
+	qsort(sorted, (size_t)tf->nfiles, sizeof(char *), tag_cache_cmp);
+	for (j=0; j < tf->nfiles; j++) {
+		foff[j] = (uint32_t)off;
+		off += strlen(sorted[j]) + 1;
+	}
+
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", cpath);
+	if ((fp = fopen(tmppath, "w")) == NULL) {
+		FREE(foff);
+		FREE(sorted);
+		return (1);
+	}
+
+	if (fwrite(&head, sizeof(head), 1, fp) != 1)
+		ret = 2;
+	for (i=0; ret == 0 && i < tf->ntags; i++) {
+		tp = &tf->tags[i];
+		if (last == -1 || sorted[last] != tp->fname) {
+			for (lo=0, hi=tf->nfiles-1, last=0; lo <= hi; ) {
+				mid = (lo + hi) / 2;
+				if ((uintptr_t)sorted[mid] < (uintptr_t)tp->fname) {
+					lo = mid+1;
+				} else {
+					last = mid;
+					hi = mid-1;
+				}
+			}
+		}
+		memset(&rec, 0, sizeof(rec));
+		rec.symbol = (uint32_t)off;
+		off += strlen(tp->symbol) + 1;
+		rec.fname = foff[last];
+		rec.pattern = TAG_CACHE_NONE;
+		if (tp->pattern != NULL) {
+			rec.pattern = (uint32_t)off;
+			off += strlen(tp->pattern) + 1;
+		}
+		rec.lineno = tp->lineno;
+		rec.type = (uint32_t)tp->type;
+		if (off >= TAG_CACHE_NONE)
+			ret = 1;	/* too large */
+		else if (fwrite(&rec, sizeof(rec), 1, fp) != 1)
+			ret = 2;
+	}
+	for (i=0; ret == 0 && i < tf->ntags; ) {
+		for (j=0; j < 1024 && i < tf->ntags; j++, i++) {
+			buff[j] = (uint32_t)(index[i] - tf->tags);
+		}
+		if (fwrite(buff, sizeof(uint32_t), (size_t)j, fp) != (size_t)j)
+			ret = 2;
+	}
+	for (i=0; ret == 0 && i < tf->nfiles; i++) {
+		for (lo=0, hi=tf->nfiles-1; lo < hi; ) {
+			mid = (lo + hi) / 2;
+			if ((uintptr_t)sorted[mid] < (uintptr_t)tf->files[i])
+				lo = mid+1;
+			else
+				hi = mid;
+		}
+		if (fwrite(&foff[lo], sizeof(uint32_t), 1, fp) != 1)
+			ret = 2;
+	}
+	for (j=0; ret == 0 && j < tf->nfiles; j++) {
+		if (fwrite(sorted[j], strlen(sorted[j]) + 1, 1, fp) != 1)
+			ret = 2;
+	}
+	for (i=0; ret == 0 && i < tf->ntags; i++) {
+		tp = &tf->tags[i];
+		if (fwrite(tp->symbol, strlen(tp->symbol) + 1, 1, fp) != 1)
+			ret = 2;
+		if (tp->pattern != NULL && fwrite(tp->pattern, strlen(tp->pattern) + 1, 1, fp) != 1)
+			ret = 2;
+	}
+
+	/* the size of the string table is known now */
+	head.strsize = (uint32_t)off;
+	if (ret == 0 && (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&head, sizeof(head), 1, fp) != 1))
+		ret = 2;
+	if (fclose(fp) != 0 && ret == 0)
+		ret = 2;
+
+	FREE(foff);
+	FREE(sorted);
+
+	if (ret == 0 && rename(tmppath, cpath) != 0)
+		ret = 2;
+	if (ret) {
+		unlink(tmppath);
+		TAGS_LOG(LOG_NOTICE, "tags file %s: cache not written, ret=%d", tf->path, ret);
 	}
 
 	return (ret);
-} /* tag_jump2_pattern */
+} /* tag_cache_write */
 
 /*
-* copy characters until ';' and '"' or final '\0' comes
-* remove the first and occasionally the last delimiter slash
+* release the index, the tags and the mappings,
+* this runs also in the background, the callers empty the position cache
 */
-static const char *
-tag_pattern_safe (const char *pattern)
+static void
+tag_free_db (TAGDB *db)
 {
-	static char safe_pattern[TAGSTR_SIZE];
-	int i=0, j=0, option=0;
+	TAGFILE *tf;
+	int i, k;
+
+	if (db == NULL)
+		return;
+	FREE(db->index);
+	for (i=0; db->tf != NULL && i < db->ntf; i++) {
+		tf = &db->tf[i];
+		FREE(tf->files);
+		FREE(tf->tags);
+		for (k=0; k < TAGS_PAR_THREADS; k++)
+			FREE(tf->strs[k]);
+		if (tf->map != NULL)
+			munmap(tf->map, tf->mapsize);
+	}
+	FREE(db->tf);
+	FREE(db);
+} /* tag_free_db */
 
-	if (pattern[i] == '/') {
-		/* skip this and remember to skip at the end */
-		option |= 0x1;
-		i++;
+/*
+* build the symbol index of the tags of one file: sorted by symbol and in file order within
+* the same symbol; the ctags sorted file needs only a check,
+* return the index or NULL on failure
+*/
+static TAG **
+tag_build_index (const TAGFILE *tf, int file_sorted)
+{
+	TAG **index, **tmp;
+	int n = tf->ntags, i;
+
+	if ((index = (TAG **) MALLOC(sizeof(TAG *) * (size_t)(n+1))) == NULL) {
+		return (NULL);
 	}
-	for (; pattern[i] != '\0' && j<TAGSTR_SIZE-2; i++) {
-		if (pattern[i] == ';' && pattern[i+1] == '"')
-			break;
-		if (pattern[i] == '*' || pattern[i] == '[' || pattern[i] == ']') {
-			safe_pattern[j++] = '\\';
+	for (i=0; i < n; i++)
+		index[i] = &tf->tags[i];
+
+	/* the sort order of ctags is strcmp() order, but check it */
+	if (file_sorted) {
+		for (i=1; i < n; i++) {
+			if (strcmp(index[i-1]->symbol, index[i]->symbol) > 0)
+				break;
 		}
-		safe_pattern[j++] = pattern[i];
+		if (i >= n)
+			return (index);
 	}
-	if ((option & 0x1) && j>1 && safe_pattern[j-1] == '/') {
-		/* drop final slash too (if any) */
-		j--;
+
+	if ((tmp = (TAG **) MALLOC(sizeof(TAG *) * (size_t)(n/2+1))) == NULL) {
+		FREE(index);
+		return (NULL);
 	}
-	safe_pattern[j++] = '\0';
+	tag_merge_sort (index, tmp, n);
+	FREE(tmp);
 
-	return (safe_pattern);
-} /* tag_pattern_safe */
+	return (index);
+} /* tag_build_index */
+
+/*
+* stable merge sort of the tags by symbol, tmp is for n/2 items
+*/
+static void
+tag_merge_sort (TAG **items, TAG **tmp, int n)
+{
+	int half, i, j, k;
+
+	if (n < 2)
+		return;
+	half = n / 2;
+	tag_merge_sort (items, tmp, half);
+	tag_merge_sort (items+half, tmp, n-half);
+	if (strcmp(items[half-1]->symbol, items[half]->symbol) <= 0)
+		return;	/* already in order */
+
+	memcpy(tmp, items, sizeof(TAG *) * (size_t)half);
+	i = k = 0;
+	j = half;
+	while (i < half && j < n) {
+		if (strcmp(items[j]->symbol, tmp[i]->symbol) < 0)
+			items[k++] = items[j++];
+		else
+			items[k++] = tmp[i++];
+	}
+	while (i < half)
+		items[k++] = tmp[i++];
+
+	return;
+} /* tag_merge_sort */
+
+/*
+* binary search in the symbol index,
+* return the index of the first item not less than symbol (maybe ntags)
+*/
+static int
+tag_lower_bound (const char *symbol)
+{
+	int lo = 0, hi = cnf.tagdb->ntags, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(cnf.tagdb->index[mid]->symbol, symbol, TAGSTR_SIZE) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (lo);
+} /* tag_lower_bound */
+
+/*
+** tag_view_info - view symbol definition in a notification, gained from "tags" file
+*/
+int
+tag_view_info (const char *arg_symbol)
+{
+	int ret=0;
+
+	ret = tag_do (arg_symbol, 0);
+
+	return (ret==0);
+} /* tag_view_info */
+
+/*
+** tag_jump_to - jump to the symbol definition, based on information gained from "tags" file
+*/
+int
+tag_jump_to (const char *arg_symbol)
+{
+	int ret=0;
+
+	/* arg_symbol is maybe ""
+	 * possible call from main.c before cnf.bootup
+	 */
+	ret = tag_do (arg_symbol, JUMP_TO);
+
+	return (ret!=1);
+} /* tag_jump_to */
+
+/*
+** tag_jump_back - come back from the last tag jump
+*/
+int
+tag_jump_back (void)
+{
+	int jump;
+	/* return to the start position of tag_jump2_pattern() */
+	jump = mhist_pop();
+	return (jump);
+} /* tag_jump_back */
+
+/*
+* complete the symbol prefix in word from the symbol index: extend the word with the common
+* prefix of the matching symbols and return the choices; if no symbol has this prefix,
+* the symbols with the characters of the word in order are ranked and the best ones are the choices;
+* return 0 if ok, 1 if no match, 2 if no tags loaded; *choices to be freed by caller
+*/
+int
+tag_complete (char *word, unsigned maxsize, char **choices)
+{
+	TAGDB *db = cnf.tagdb;
+	char *pw = word;
+	const char *first, *last, *sym;
+	int best_ti[TAG_FUZZY_MAX], best_score[TAG_FUZZY_MAX];
+	int nbest=0, lo, hi, ti, i, j, score, count=0;
+	unsigned n, plen;
+	size_t request=1;
+
+	*choices = NULL;
+	if (db == NULL || db->ntags == 0)
+		return (2);
+	if (*pw == '.' || *pw == '>') {
+		/* member marks, like tag_do() */
+		pw++;
+		maxsize--;
+	}
+	plen = strlen(pw);
+
+	/* prefix match, the range in the sorted index */
+	lo = tag_lower_bound(pw);
+	for (i = lo, hi = db->ntags; i < hi; ) {
+		j = i + (hi - i) / 2;
+		if (strncmp(db->index[j]->symbol, pw, plen) == 0)
+			i = j + 1;
+		else
+			hi = j;
+	}
+	if (hi > lo) {
+		first = db->index[lo]->symbol;
+		last = db->index[hi-1]->symbol;
+		for (n=0; first[n] != '\0' && first[n] == last[n] && n+1 < maxsize; n++)
+			;
+		memcpy(pw, first, n);
+		pw[n] = '\0';
+		if (first[n] == '\0' && last[n] == '\0')
+			return (0);	/* unique */
+
+		/* the different symbols, 1000++ bytes */
+		for (ti = lo; ti < hi && request < 1000; ti++) {
+			if (ti == lo || strcmp(db->index[ti]->symbol, db->index[ti-1]->symbol) != 0)
+				request += strlen(db->index[ti]->symbol) + 1;
+		}
+		if ((*choices = (char *) MALLOC(request + 30)) == NULL) {
+			ERRLOG(0xE0DB);
+			return (1);
+		}
+		(*choices)[0] = '\0';
+		for (ti = lo, j = 0; ti < hi && (size_t)j+1 < request; ti++) {
+			sym = db->index[ti]->symbol;
+			if (ti == lo || strcmp(sym, db->index[ti-1]->symbol) != 0)
+				j += sprintf(*choices + j, "%s ", sym);
+		}
+		if (ti < hi)
+			sprintf(*choices + j, "... (%d tags)", hi - lo);
+		return (0);
+	}
+
+	/* subsequence match, ranked */
+	for (ti=0; ti < db->ntags; ti++) {
+		sym = db->index[ti]->symbol;
+		if (ti > 0 && sym[0] == db->index[ti-1]->symbol[0] && strcmp(sym, db->index[ti-1]->symbol) == 0)
+			continue;
+		if ((score = tag_fuzzy_score(pw, sym)) < 0)
+			continue;
+		count++;
+		/* keep the best ones, in alphabetical order within the same score */
+		for (i = nbest; i > 0 && best_score[i-1] < score; i--) {
+			if (i < TAG_FUZZY_MAX) {
+				best_score[i] = best_score[i-1];
+				best_ti[i] = best_ti[i-1];
+			}
+		}
+		if (i < TAG_FUZZY_MAX) {
+			best_score[i] = score;
+			best_ti[i] = ti;
+			if (nbest < TAG_FUZZY_MAX)
+				nbest++;
+		}
+	}
+	if (nbest == 0)
+		return (1);
+	if (count == 1) {
+		sym = db->index[best_ti[0]]->symbol;
+		if (strlen(sym) < maxsize) {
+			strncpy(pw, sym, maxsize);
+			return (0);
+		}
+	}
+
+	for (i=0; i < nbest; i++)
+		request += strlen(db->index[best_ti[i]]->symbol) + 1;
+	if ((*choices = (char *) MALLOC(request + 30)) == NULL) {
+		ERRLOG(0xE0DB);
+		return (1);
+	}
+	for (i=0, j=0; i < nbest; i++)
+		j += sprintf(*choices + j, "%s ", db->index[best_ti[i]]->symbol);
+	if (count > nbest)
+		sprintf(*choices + j, "... (%d symbols)", count);
+
+	return (0);
+} /* tag_complete */
+
+/*
+* rank of the symbol for the subsequence pattern, -1 if the characters of the pattern
+* are not in the symbol in order; consecutive characters, the starts of words and
+* the shorter symbols are preferred
+*/
+static int
+tag_fuzzy_score (const char *pat, const char *sym)
+{
+	int score=0, run=0, i=0, j;
+
+	for (j=0; sym[j] != '\0'; j++) {
+		if (pat[i] != '\0' && tolower((unsigned char)pat[i]) == tolower((unsigned char)sym[j])) {
+			score += 2;
+			if (run)
+				score += 6;
+			if (j == 0 || sym[j-1] == '_' || (islower((unsigned char)sym[j-1]) && isupper((unsigned char)sym[j])))
+				score += 10;
+			if (pat[i] == sym[j])
+				score += 1;
+			run = 1;
+			i++;
+		} else {
+			run = 0;
+		}
+	}
+	if (pat[i] != '\0')
+		return (-1);
+
+	return (score * 64 - ((j < 63) ? j : 63));
+} /* tag_fuzzy_score */
+
+/*
+*
+* other static functions
+*
+*/
+
+/*
+* start point for tag search
+*/
+static int
+tag_do (const char *arg_symbol, int flag)
+{
+	const char *symbol=NULL;
+	char *get_symbol=NULL;
+	int ret=0;
+
+	if (cnf.tagdb == NULL) {
+		tracemsg ("tags file [%s] not loaded", cnf.tags_file);
+	} else {
+		if (arg_symbol[0] == '\0') {
+			get_symbol = select_word(CURR_LINE, CURR_FILE.lncol);
+			symbol = get_symbol;
+		} else {
+			symbol = arg_symbol;
+		}
+
+		if (symbol != NULL && symbol[0] != '\0') {
+			if (symbol[0] == '.' || symbol[0] == '>') {
+				symbol++;
+			}
+			ret = tag_items (symbol, TAG_UNDEF, flag);	/* start to search... */
+
+			/* failure messages here */
+			if (flag & JUMP_TO) {
+				if (ret == 0) {
+					tracemsg ("cannot jump to symbol \"%s\".", symbol);
+				} else if (ret > 1) {
+					; /* multiple match -- ok */
+				} else if (ret < 0) {
+					tracemsg ("symbol \"%s\" search failed", symbol);
+				}
+			} else {
+				if (ret == 0) {
+					tracemsg ("cannot show symbol \"%s\".", symbol);
+				}
+			}
+		} else {
+			tracemsg ("no symbol given");
+		}
+		FREE(get_symbol); get_symbol = NULL;
+	}
+
+	return (ret);	/* symbols found */
+} /* tag_do */
+
+/*
+* type: TAG_UNDEF or filter search
+* flag: JUMP_TO
+* return value: matching symbols found
+*/
+static int
+tag_items (const char *symbol, TAGTYPE type, int flag)
+{
+	TAG *tp;
+	int ti;
+	int count = 0;
+	const TAG *jump_tp = NULL;
+	const char *jump_pattern = "oh";
+	int jump_lineno = 0;
+	static int saved_count = -100;
+	static char saved_symbol[TAGSTR_SIZE] = "";
+	char fpath[FNAMESIZE];
+
+	if (saved_count == -100) {
+		/* runtime init */
+		memset(saved_symbol, 0, sizeof(saved_symbol));
+		saved_count = -1;
+	}
+
+	if (flag & JUMP_TO) {
+		if ((saved_count == -1) || (strncmp(saved_symbol, symbol, sizeof(saved_symbol)-1) != 0)) {
+			memset(saved_symbol, 0, sizeof(saved_symbol));
+			strncat(saved_symbol, symbol, sizeof(saved_symbol)-1);
+			saved_count = 0;
+		}
+	}
+
+	// "query symbol [%s] type %c flag 0x%X",
+	// symbol, (type==TAG_UNDEF ? '?' : type), flag);
+
+	/* the definitions of the symbol are adjacent in the index, in file order */
+	for (ti = tag_lower_bound (symbol); ti < cnf.tagdb->ntags; ti++)
+	{
+		tp = cnf.tagdb->index[ti];
+		if (strncmp (tp->symbol, symbol, TAGSTR_SIZE) != 0)
+			break;
+		if ((type == TAG_UNDEF) || (type == tp->type))
+		{
+			// "match symbol [%s] fname [%s] type %c lineno %d pattern [%s]",
+			// tp->symbol, tp->fname, tp->type, tp->lineno, tp->pattern
+
+			if (flag & JUMP_TO) {
+				if (tp->type == TAG_DEFINE) {
+					if (count==0 || count==saved_count) {
+						jump_tp = tp;
+						jump_pattern = NULL;
+						jump_lineno = tp->lineno;
+					}
+					count++;
+				} else if (tp->type != TAG_UNDEF) {
+					if (count==0 || count==saved_count) {
+						jump_tp = tp;
+						jump_pattern = tp->pattern;
+						jump_lineno = -1;
+					}
+					count++;
+				} else {
+					tracemsg ("(type:%c) %s %s %s", tp->type, tp->symbol, tp->fname, tp->pattern);
+				}
+			} else {
+				if (tp->type == TAG_DEFINE) {
+					if (tag_source_path(tp, fpath, sizeof(fpath)) || show_define(fpath, tp->lineno)) {
+						/* failed */
+						tracemsg ("not found: [%s] %s :%d", tp->symbol, tp->fname, tp->lineno);
+					}
+					count++;
+				} else {
+					if (tp->type != TAG_UNDEF)
+						count++;
+					tracemsg ("(type:%c) %s %s %s", tp->type, tp->symbol, tp->fname, tp->pattern);
+				}
+			}
+		}
+	}
+
+	if ((flag & JUMP_TO) && (count > 0)) {
+		saved_count++;
+		if (tag_jump2_pattern (jump_tp, jump_pattern, jump_lineno)) {
+			/* failed */
+			count = -count;
+			saved_count = -1;
+		} else {
+			if (count > 1) {
+				tracemsg ("symbol \"%s\" multiple match (%d of %d)",
+					symbol, saved_count, count);
+			}
+		}
+		if (saved_count == count) {
+			saved_count = -1;
+		}
+	}
+
+	return (count);	/* number of symbols found */
+} /* tag_items */
+
+/*
+* do the hard work in tag searching,
+* the pattern tags use the position cache before the search from the top
+*/
+static int
+tag_jump2_pattern (const TAG *tp, const char *pattern, int lineno)
+{
+	int ret=1;
+	int from_ring, from_lineno;
+	LINE *lx = NULL;
+	const char *expr;
+	int lineno2;
+	char fpath[FNAMESIZE];
+
+	from_ring = cnf.ring_curr;
+	from_lineno = cnf.fdata[cnf.ring_curr].lineno;
+
+	/* open file or switch to
+	 */
+	if (tag_source_path(tp, fpath, sizeof(fpath))) {
+		TAGS_LOG(LOG_ERR, "tag jump, cannot get path to %s from tags file", tp->fname);
+	} else if (add_file(fpath) == 0) {
+		/* cnf.ring_curr already set by add_file() */
+
+		if (CURR_FILE.fflag & FSTAT_SCRATCH) {
+			// does not exist?
+			ret=2;
+
+		} else if (lineno >= 1 && lineno <= CURR_FILE.num_lines) {
+			lx = lll_goto_lineno (cnf.ring_curr, lineno);
+			if (TEXT_LINE(lx))
+				ret = 0;
+
+		} else if (pattern != NULL) {
+			expr = tag_pattern_safe (pattern);
+			lx = tag_pos_lookup (tp, cnf.ring_curr, expr, &lineno2);
+			if (lx == NULL) {
+				lx = search_goto_pattern (cnf.ring_curr, expr, &lineno2);
+				if (TEXT_LINE(lx))
+					tag_pos_save (tp, cnf.ring_curr, lx, lineno2);
+			}
+			lineno = lineno2;
+			if (TEXT_LINE(lx))
+				ret = 0;
+		}
+	}
+
+	if (ret == 0 && lx != NULL) {
+		if (cnf.bootup) {
+			mhist_push (from_ring, from_lineno);
+		}
+		set_position (cnf.ring_curr, lineno, lx);
+	} else {
+		cnf.ring_curr = from_ring;
+	}
+
+	return (ret);
+} /* tag_jump2_pattern */
+
+/*
+* get the cached position of the pattern tag in the buffer ri, the line at the cached lineno
+* is taken from the line index (O(1)) and it must be the same line with the same content,
+* or it must match the pattern; otherwise the slot is emptied, the caller searches
+* return the LINE pointer and the lineno, or NULL
+*/
+static LINE *
+tag_pos_lookup (const TAG *tp, int ri, const char *expr, int *lineno)
+{
+	TAGPOS *pc;
+	LINE *lx;
+
+	if (tp == NULL)
+		return (NULL);
+	pc = &tag_pos[TAG_POS_SLOT(tp)];
+	if (pc->tp != tp || pc->ri != ri || pc->top != cnf.fdata[ri].top)
+		return (NULL);
+
+	/* the cached pointer is only compared, the line is from the index */
+	lx = lll_goto_lineno (ri, pc->lineno);
+	if (TEXT_LINE(lx) && ((lx == pc->lx && lx->lgen == pc->lgen) ||
+		search_line_pattern (lx, expr)))
+	{
+		pc->lx = lx;
+		pc->lgen = lx->lgen;
+		*lineno = pc->lineno;
+		return (lx);
+	}
+
+	TAGS_LOG(LOG_DEBUG, "tag position stale: %s :%d", tp->symbol, pc->lineno);
+	pc->tp = NULL;
+	return (NULL);
+} /* tag_pos_lookup */
+
+/*
+* save the resolved position of the pattern tag
+*/
+static void
+tag_pos_save (const TAG *tp, int ri, LINE *lx, int lineno)
+{
+	TAGPOS *pc;
+
+	if (tp == NULL)
+		return;
+	pc = &tag_pos[TAG_POS_SLOT(tp)];
+	pc->tp = tp;
+	pc->ri = ri;
+	pc->top = cnf.fdata[ri].top;
+	pc->lx = lx;
+	pc->lineno = lineno;
+	pc->lgen = lx->lgen;
+} /* tag_pos_save */
+
+/*
+* copy characters until ';' and '"' or final '\0' comes
+* remove the first and occasionally the last delimiter slash
+*/
+static const char *
+tag_pattern_safe (const char *pattern)
+{
+	static char safe_pattern[TAGSTR_SIZE];
+	int i=0, j=0, option=0;
+
+	if (pattern[i] == '/') {
+		/* skip this and remember to skip at the end */
+		option |= 0x1;
+		i++;
+	}
+	for (; pattern[i] != '\0' && j<TAGSTR_SIZE-2; i++) {
+		if (pattern[i] == ';' && pattern[i+1] == '"')
+			break;
+		if (pattern[i] == '*' || pattern[i] == '[' || pattern[i] == ']') {
+			safe_pattern[j++] = '\\';
+		}
+		safe_pattern[j++] = pattern[i];
+	}
+	if ((option & 0x1) && j>1 && safe_pattern[j-1] == '/') {
+		/* drop final slash too (if any) */
+		j--;
+	}
+	safe_pattern[j++] = '\0';
+
+	return (safe_pattern);
+} /* tag_pattern_safe */
+
+/*
+*
+* the reference search in the sources of the tags
+*
+*/
+
+/*
+** tag_refs_search - search the symbol in the source files of the loaded tags, literal whole word match,
+**	the files are scanned on worker threads and the "fname:lineno:line" lines of the hits are
+**	appended to the current buffer in file name order as they come, a keypress cancels the search
+*/
+int
+tag_refs_search (const char *symbol)
+{
+	REFJOB job;
+	REFFILE *rf;
+	const TAGFILE *tf;
+	pthread_t tid[TAGS_PAR_THREADS];
+	char one_line[TAGSTR_SIZE+10];
+	LINE *lp=NULL;
+	int n=0, nth, ti, i, k, ready, active, out=0, hits=0, ret=0, cancelled=0;
+	long ncpu;
+	long long t0 = msec_clock();
+
+	if (cnf.tagdb == NULL || symbol[0] == '\0')
+		return (1);
+
+	/* the source files of all tags files, sorted by path */
+	for (ti=0; ti < cnf.tagdb->ntf; ti++)
+		n += cnf.tagdb->tf[ti].nfiles;
+	if ((rf = (REFFILE *) MALLOC(sizeof(REFFILE) * (size_t)(n+1))) == NULL) {
+		ERRLOG(0xE0DC);
+		return (2);
+	}
+	memset(rf, 0, sizeof(REFFILE) * (size_t)(n+1));
+	for (k=0, ti=0; ti < cnf.tagdb->ntf; ti++) {
+		tf = &cnf.tagdb->tf[ti];
+		for (i=0; i < tf->nfiles; i++, k++) {
+			rf[k].prefix = (tf->files[i][0] == '/') ? "" : tf->j2path;
+			rf[k].fname = tf->files[i];
+		}
+	}
+	qsort(rf, (size_t)n, sizeof(REFFILE), tag_refs_cmp);
+
+	/* header
+	*/
+	snprintf(one_line, sizeof(one_line), "refs %s\n", symbol);
+	if ((lp = insert_line_before (CURR_FILE.bottom, one_line)) != NULL) {
+		CURR_FILE.num_lines++;
+	} else {
+		FREE(rf);
+		return (2);
+	}
+
+	memset(&job, 0, sizeof(job));
+	job.files = rf;
+	job.nfiles = n;
+	job.symbol = symbol;
+	job.symlen = strlen(symbol);
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	nth = (ncpu > TAGS_PAR_THREADS) ? TAGS_PAR_THREADS : (int)ncpu;
+	if (nth > n)
+		nth = n;
+	pthread_mutex_lock (&refs_lock);
+	for (i=0; i < nth; i++) {
+		if (pthread_create (&tid[i], NULL, tag_refs_worker, &job) != 0)
+			break;
+		job.active++;
+	}
+	pthread_mutex_unlock (&refs_lock);
+	nth = i;
+	if (nth == 0) {
+		/* no thread, do it here */
+		job.active = 1;
+		tag_refs_worker (&job);
+	}
+
+	/* append the finished files in order, show the progress, cancel on keypress */
+	for (;;) {
+		pthread_mutex_lock (&refs_lock);
+		for (ready = out; ready < n && rf[ready].done; ready++)
+			;
+		active = job.active;
+		pthread_mutex_unlock (&refs_lock);
+
+		for (; out < ready; out++) {
+			if (ret == 0 && tag_refs_append (&rf[out], &lp)) {
+				ERRLOG(0xE0DC);
+				ret = 2;
+				pthread_mutex_lock (&refs_lock);
+				job.cancel = 1;
+				pthread_mutex_unlock (&refs_lock);
+			}
+			hits += rf[out].hits;
+			FREE(rf[out].out);
+		}
+		if (out >= n || active == 0)
+			break;
+
+		if (msec_clock() - t0 < CUST_WTIMEOUT) {
+			usleep (1000);	/* short searches finish without the progress */
+		} else if (!cancelled && ret == 0 && cnf.bootup) {
+			CURR_LINE = CURR_FILE.bottom->prev;
+			CURR_FILE.lineno = CURR_FILE.num_lines;
+			update_focus(FOCUS_ON_LASTBUT1_LINE, cnf.ring_curr);
+			upd_statusline ();
+			upd_text_area (0);
+			tracemsg("refs: %d lines in %d of %d files -- press any key to cancel", hits, out, n);
+			upd_trace ();
+			doupdate ();
+			if (wgetch (stdscr) != ERR) {
+				pthread_mutex_lock (&refs_lock);
+				job.cancel = 1;
+				pthread_mutex_unlock (&refs_lock);
+				cancelled = 1;
+			}
+		} else {
+			usleep (CUST_WTIMEOUT * 1000);
+		}
+	}
+	for (i=0; i < nth; i++) {
+		pthread_join (tid[i], NULL);
+	}
+	for (i=out; i < n; i++) {
+		FREE(rf[i].out);
+	}
+	FREE(rf);
+
+	/* footer
+	*/
+	if (ret==0 && append_line (lp, "\n") != NULL) {
+		CURR_FILE.num_lines++;
+	}
+
+	/* pull and update
+	*/
+	CURR_LINE = CURR_FILE.bottom->prev;
+	CURR_FILE.lineno = CURR_FILE.num_lines;
+	update_focus(FOCUS_ON_LASTBUT1_LINE, cnf.ring_curr);
+
+	cnf.trace=0;	/* drop the progress */
+	tracemsg("refs: %d lines in %d%s files, %d threads (%lld ms)%s",
+		hits, out, (out < n) ? " scanned" : "", nth, msec_clock() - t0,
+		(cancelled) ? " -- cancelled" : "");
+
+	return (ret);
+} /* tag_refs_search */
+
+/*
+* compare the paths of the reference search files
+*/
+static int
+tag_refs_cmp (const void *p1, const void *p2)
+{
+	const REFFILE *r1 = (const REFFILE *) p1;
+	const REFFILE *r2 = (const REFFILE *) p2;
+	int c;
+
+	if ((c = strcmp(r1->prefix, r2->prefix)) != 0)
+		return (c);
+	return (strcmp(r1->fname, r2->fname));
+} /* tag_refs_cmp */
+
+/*
+* worker thread of the reference search, take the next file until the end or the cancel
+*/
+static void *
+tag_refs_worker (void *arg)
+{
+	REFJOB *job = (REFJOB *) arg;
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock (&refs_lock);
+		i = (job->cancel) ? job->nfiles : job->next++;
+		pthread_mutex_unlock (&refs_lock);
+		if (i >= job->nfiles)
+			break;
+
+		tag_refs_scan (job, &job->files[i]);
+
+		pthread_mutex_lock (&refs_lock);
+		job->files[i].done = 1;
+		pthread_mutex_unlock (&refs_lock);
+	}
+
+	pthread_mutex_lock (&refs_lock);
+	job->active--;
+	pthread_mutex_unlock (&refs_lock);
+	return (NULL);
+} /* tag_refs_worker */
+
+/*
+* read one source file and collect the lines with the symbol as a whole word,
+* no globals here; the missing files are skipped silently
+*/
+static void
+tag_refs_scan (const REFJOB *job, REFFILE *rf)
+{
+	char path[FNAMESIZE];
+	struct stat st;
+	char *buf, *p, *end, *hit, *eol, *nl;
+	const char *bol;
+	size_t len, got;
+	ssize_t rlen;
+	int fd, lineno=1;
+
+	if ((size_t)snprintf(path, sizeof(path), "%s%s", rf->prefix, rf->fname) >= sizeof(path))
+		return;
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return;
+	}
+	len = (size_t)st.st_size;
+	if ((buf = (char *) MALLOC(len+1)) == NULL) {
+		close(fd);
+		rf->err = 1;
+		return;
+	}
+	for (got=0; got < len && (rlen = read(fd, buf+got, len-got)) > 0; got += (size_t)rlen)
+		;
+	close(fd);
+	end = buf + got;
+
+	bol = buf;
+	for (p = buf; p < end && (hit = memmem(p, (size_t)(end - p), job->symbol, job->symlen)) != NULL; )
+	{
+		if ((hit > buf && IS_ID(hit[-1])) || (hit + job->symlen < end && IS_ID(hit[job->symlen]))) {
+			p = hit + 1;
+			continue;
+		}
+		/* count the lines up to the hit */
+		for (; (nl = memchr(bol, '\n', (size_t)(hit - bol))) != NULL; bol = nl+1)
+			lineno++;
+		if ((eol = memchr(hit, '\n', (size_t)(end - hit))) == NULL)
+			eol = end;
+		if (tag_refs_add (rf, path, lineno, bol, (size_t)(eol - bol))) {
+			rf->err = 1;
+			break;
+		}
+		rf->hits++;
+		p = eol;	/* one hit per line */
+	}
+
+	FREE(buf);
+} /* tag_refs_scan */
+
+/*
+* add one "path:lineno:line\n" hit to the output of the file,
+* return 0 if ok, 1 on malloc failure
+*/
+static int
+tag_refs_add (REFFILE *rf, const char *path, int lineno, const char *line, size_t len)
+{
+	char head[FNAMESIZE+20];
+	size_t hlen, need, i;
+	char *q;
+
+	hlen = (size_t)snprintf(head, sizeof(head), "%s:%d:", path, lineno);
+	if (hlen >= sizeof(head))
+		return (1);
+	need = rf->outlen + hlen + len + 2;
+	if (need > rf->outsize) {
+		rf->outsize = (need > 2 * rf->outsize) ? need + 0x1000 : 2 * rf->outsize;
+		if ((q = (char *) REALLOC(rf->out, rf->outsize)) == NULL)
+			return (1);
+		rf->out = q;
+	}
+	q = rf->out + rf->outlen;
+	memcpy(q, head, hlen);
+	q += hlen;
+	for (i=0; i < len; i++) {
+		*q++ = (line[i] == '\0') ? ' ' : line[i];
+	}
+	*q++ = '\n';
+	*q++ = '\0';
+	rf->outlen = need;
+
+	return (0);
+} /* tag_refs_add */
+
+/*
+* append the hits of the file after *lp in the current buffer,
+* return 0 if ok, 1 on failure
+*/
+static int
+tag_refs_append (REFFILE *rf, LINE **lp)
+{
+	const char *p;
+	LINE *lx;
+
+	if (rf->err)
+		return (1);
+	for (p = rf->out; p != NULL && p < rf->out + rf->outlen; p += strlen(p)+1) {
+		if ((lx = append_line (*lp, p)) == NULL)
+			return (1);
+		CURR_FILE.num_lines++;
+		*lp = lx;
+	}
+
+	return (0);
+} /* tag_refs_append */
+
+/*
+*
+* the tags generator for C/C++ sources
+*
+*/
+
+/*
+** tag_make - generate the tags of the C/C++ sources under the directory given as argument
+**	or the current directory, with the "-w" option write the tags file there also
+*/
+int
+tag_make (const char *args)
+{
+	char argbuf[CMDLINESIZE];
+	char *argv[MAXARGS];
+	char root[FNAMESIZE];
+	char path[FNAMESIZE+10];
+	MKLIST ml = { NULL, 0, 0 };
+	MKCHUNK chunk[TAGS_PAR_THREADS];
+	TAGDB *db = NULL;
+	TAGFILE *tf = NULL;
+	struct stat st;
+	char *buf = NULL;
+	size_t total;
+	int argc, i, nth=1, ret=0, do_write=0, file_sorted=0;
+	long ncpu;
+	long long t0 = msec_clock();
+
+	strncpy(root, ".", sizeof(root));
+	strncpy(argbuf, args, sizeof(argbuf));
+	argbuf[sizeof(argbuf)-1] = '\0';
+	argc = parse_args(argbuf, argv);
+	for (i=0; i < argc && argv[i] != NULL; i++) {
+		if (strncmp(argv[i], "-w", 3) == 0) {
+			do_write = 1;
+		} else {
+			strncpy(root, argv[i], sizeof(root));
+			root[sizeof(root)-1] = '\0';
+		}
+	}
+	if (glob_tilde_expansion(root, sizeof(root)))
+		return (1);
+	if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		tracemsg("mktags: not a directory [%s]", root);
+		return (1);
+	}
+
+	if (tag_mk_walk(root, "", 0, &ml)) {
+		ERRLOG(0xE0D9);
+		ret = 1;
+	} else if (ml.n == 0) {
+		tracemsg("mktags: no C/C++ sources under [%s]", root);
+		ret = 1;
+	}
+	if (ret) {
+		tag_mk_free(&ml);
+		return (ret);
+	}
+	qsort(ml.names, (size_t)ml.n, sizeof(char *), tag_mk_cmp);
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	nth = (ncpu > TAGS_PAR_THREADS) ? TAGS_PAR_THREADS : (int)ncpu;
+	if (nth > ml.n)
+		nth = ml.n;
+	if (nth < 1)
+		nth = 1;
+
+	memset (chunk, 0, sizeof(chunk));
+	for (i=0; i < nth; i++) {
+		chunk[i].files = ml.names;
+		chunk[i].from = (int)((long long)ml.n * i / nth);
+		chunk[i].to = (int)((long long)ml.n * (i+1) / nth);
+		chunk[i].root = root;
+	}
+	for (i=1; i < nth; i++) {
+		if (pthread_create (&chunk[i].tid, NULL, tag_mk_worker, &chunk[i]) == 0)
+			chunk[i].started = 1;
+	}
+	tag_mk_worker (&chunk[0]);
+	for (i=1; i < nth; i++) {
+		if (chunk[i].started)
+			pthread_join (chunk[i].tid, NULL);
+		else
+			tag_mk_worker (&chunk[i]);	/* no thread, do it here */
+	}
+
+	/* the ctags lines of the chunks in file order, parsed like a tags file */
+	for (total=0, i=0; i < nth; i++) {
+		total += chunk[i].outlen;
+		ret |= chunk[i].err;
+	}
+	if (ret == 0 && (buf = (char *) MALLOC(total+1)) == NULL)
+		ret = 1;
+	if (ret == 0) {
+		for (total=0, i=0; i < nth; i++) {
+			if (chunk[i].outlen > 0)
+				memcpy(buf+total, chunk[i].out, chunk[i].outlen);
+			total += chunk[i].outlen;
+		}
+		buf[total] = '\0';
+		db = (TAGDB *) MALLOC(sizeof(TAGDB));
+		tf = (TAGFILE *) MALLOC(sizeof(TAGFILE));
+		if (db == NULL || tf == NULL) {
+			FREE(tf);
+			FREE(db);
+			FREE(buf);
+			ret = 1;
+		}
+	}
+	for (i=0; i < nth; i++) {
+		FREE(chunk[i].out);
+	}
+	if (ret) {
+		ERRLOG(0xE0D9);
+		tracemsg("mktags failed");
+		tag_mk_free(&ml);
+		return (1);
+	}
+
+	memset(db, 0, sizeof(TAGDB));
+	memset(tf, 0, sizeof(TAGFILE));
+	db->tf = tf;
+	db->ntf = 1;
+	strncpy(tf->path, root, sizeof(tf->path));
+	tf->path[sizeof(tf->path)-1] = '\0';
+	tag_set_j2path(tf, root);
+	tf->mkflag = 1;
+	ret = tag_parse_map(tf, buf, total, &file_sorted);
+	FREE(buf);
+	if (ret == 0 && tag_intern_files(tf)) {
+		ret = 5;
+	}
+	if (ret == 0 && (db->index = tag_build_index(tf, 0)) == NULL) {
+		ret = 4;
+	}
+	db->ntags = tf->ntags;
+	if (ret) {
+		tag_load_errlog(ret);
+		tracemsg("mktags failed");
+		tag_free_db(db);
+		tag_mk_free(&ml);
+		return (1);
+	}
+
+	tag_rm_all();
+	cnf.tagdb = db;
+	cnf.trace=0;	/* drop previous msgs */
+	tracemsg("mktags: %d symbols from %d files, %d threads (%lld ms)",
+		db->ntags, ml.n, nth, msec_clock() - t0);
+
+	if (do_write) {
+		snprintf(path, sizeof(path), "%s/tags", root);
+		if (tag_mk_write(db, path) || stat(path, &st) != 0) {
+			ERRLOG(0xE0DA);
+			tracemsg("mktags: cannot write [%s]", path);
+		} else {
+			/* now this is the tags file, watched for changes */
+			strncpy(cnf.tags_file, path, sizeof(cnf.tags_file));
+			cnf.tags_file[sizeof(cnf.tags_file)-1] = '\0';
+			strncpy(tf->path, path, sizeof(tf->path));
+			tf->path[sizeof(tf->path)-1] = '\0';
+			tf->mkflag = 2;
+			tf->mtime = st.st_mtime;
+			tf->fsize = st.st_size;
+			tag_cache_write(tf, db->index);
+			tracemsg("mktags: tags file written [%s]", path);
+		}
+	}
+
+	tag_mk_free(&ml);
+	return (0);
+} /* tag_make */
+
+/*
+* collect the C/C++ sources under root/rel, skip dot files and directories,
+* the names are relative to root; return 0 if ok, -1 on failure
+*/
+static int
+tag_mk_walk (const char *root, const char *rel, int depth, MKLIST *ml)
+{
+	DIR *dp = NULL;
+	struct dirent *de = NULL;
+	struct stat st;
+	char dir[FNAMESIZE];
+	char path[FNAMESIZE];
+	char name[FNAMESIZE];
+	char **nx;
+	int ret=0;
+
+	if (depth > TAGS_MK_MAXDEPTH) {
+		return (0);
+	}
+	if (rel[0] == '\0') {
+		snprintf(dir, sizeof(dir), "%s", root);
+	} else {
+		snprintf(dir, sizeof(dir), "%s/%s", root, rel);
+	}
+	if ((dp = opendir(dir)) == NULL) {
+		return (0);	/* like find, skip unreadable directories */
+	}
+
+	while (ret == 0 && (de = readdir(dp)) != NULL) {
+		if (de->d_name[0] == '.') {
+			continue;
+		}
+		if (rel[0] == '\0') {
+			snprintf(name, sizeof(name), "%s", de->d_name);
+		} else {
+			snprintf(name, sizeof(name), "%s/%s", rel, de->d_name);
+		}
+		snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+		if (lstat(path, &st) != 0) {
+			continue;
+		}
+
+		if (S_ISDIR(st.st_mode)) {
+			ret = tag_mk_walk(root, name, depth+1, ml);
+		} else if (S_ISREG(st.st_mode) && st.st_size < TAGS_MK_MAXFSIZE && tag_mk_source(de->d_name)) {
+			if (ml->n >= ml->size) {
+				nx = (char **) REALLOC((void *)ml->names, sizeof(char *) * (size_t)(ml->size + 1024));
+				if (nx == NULL) {
+					ret = -1;
+					break;
+				}
+				ml->names = nx;
+				ml->size += 1024;
+			}
+			if ((ml->names[ml->n] = strdup(name)) == NULL) {
+				ret = -1;
+				break;
+			}
+			ml->n++;
+		}
+	}
+	closedir(dp);
+
+	return (ret);
+} /* tag_mk_walk */
+
+/*
+* C/C++ source or header by the file name extension
+*/
+static int
+tag_mk_source (const char *name)
+{
+	static const char *ext[] = { ".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx", NULL };
+	const char *dot = strrchr(name, '.');
+	int i;
+
+	if (dot == NULL)
+		return (0);
+	for (i=0; ext[i] != NULL; i++) {
+		if (strcmp(dot, ext[i]) == 0)
+			return (1);
+	}
+	return (0);
+} /* tag_mk_source */
+
+static int
+tag_mk_cmp (const void *p1, const void *p2)
+{
+	return (strcmp(*(char *const *)p1, *(char *const *)p2));
+}
+
+/*
+* free the file list
+*/
+static void
+tag_mk_free (MKLIST *ml)
+{
+	int i;
+
+	for (i=0; i < ml->n; i++) {
+		FREE(ml->names[i]);
+	}
+	FREE(ml->names);
+	ml->names = NULL;
+	ml->n = ml->size = 0;
+} /* tag_mk_free */
+
+/*
+* worker thread of the tags generator, scan the files of the chunk
+*/
+static void *
+tag_mk_worker (void *arg)
+{
+	MKCHUNK *mk = (MKCHUNK *) arg;
+	regex_t regs[4];
+	int i;
+
+	if (c_header_regcomp (regs)) {
+		mk->err = 1;
+		return (NULL);
+	}
+	for (i = mk->from; i < mk->to && !mk->err; i++) {
+		tag_mk_scan (mk, mk->files[i], regs);
+	}
+	c_header_regfree (regs);
+
+	return (NULL);
+} /* tag_mk_worker */
+
+/*
+* scan the C/C++ source for the top level definitions: the headers of the top level blocks
+* are searched like in the outline, with c_header_test() on the purified text, and the
+* macro definitions and the typedefs are taken also
+*/
+static void
+tag_mk_scan (MKCHUNK *mk, const char *fname, const regex_t *regs)
+{
+	char path[FNAMESIZE*2];
+	struct stat st;
+	regmatch_t pmatch[10];	/* match and sub match */
+	char *buff=NULL, *pure=NULL, *lp, *pp, *cs;
+	int *lstart=NULL;
+	size_t size=0;
+	ssize_t got;
+	int fd, nlines, li, k, i, n, llen, found;
+	int depth=0, prev_end=0, in_comment=0, in_macro=0, tdef=0;
+
+	snprintf(path, sizeof(path), "%s/%s", mk->root, fname);
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return;
+	if (fstat(fd, &st) != 0 || st.st_size >= TAGS_MK_MAXFSIZE) {
+		close(fd);
+		return;
+	}
+	buff = (char *) MALLOC((size_t)st.st_size + 2);
+	pure = (char *) MALLOC((size_t)st.st_size + 2);
+	if (buff == NULL || pure == NULL) {
+		mk->err = 1;
+		close(fd);
+		FREE(buff);
+		FREE(pure);
+		return;
+	}
+	while (size < (size_t)st.st_size && (got = read(fd, buff+size, (size_t)st.st_size - size)) > 0)
+		size += (size_t)got;
+	close(fd);
+	if (size > 0 && buff[size-1] != '\n')
+		buff[size++] = '\n';
+
+	/* the lines, terminated in place */
+	for (nlines=0, i=0; (size_t)i < size; i++) {
+		if (buff[i] == '\n')
+			nlines++;
+	}
+	if ((lstart = (int *) MALLOC(sizeof(int) * (size_t)(nlines+1))) == NULL) {
+		mk->err = 1;
+		FREE(buff);
+		FREE(pure);
+		return;
+	}
+	lstart[0] = 0;
+	for (li=1, i=0; (size_t)i < size; i++) {
+		if (buff[i] == '\n') {
+			buff[i] = '\0';
+			lstart[li++] = i+1;
+		}
+	}
+
+	for (li=0; li < nlines && !mk->err; li++) {
+		lp = buff + lstart[li];
+		pp = pure + lstart[li];
+		llen = lstart[li+1] - lstart[li] - 1;
+
+		/* the purified line, the comments and strings are blank */
+		i = 0;
+		if (in_comment) {
+			if ((cs = strstr(lp, "*/")) == NULL) {
+				memset(pp, ' ', (size_t)llen);
+				pp[llen] = '\0';
+				continue;
+			}
+			i = (int)(cs - lp) + 2;
+			memset(pp, ' ', (size_t)i);
+			in_comment = 0;
+		}
+		purify_for_matching_clang (pp+i, lp+i, llen-i+1);
+		if ((cs = strstr(pp+i, "/*")) != NULL) {
+			/* multiline comment */
+			memset(cs, ' ', strlen(cs));
+			in_comment = 1;
+		}
+
+		/* preprocessor lines, with continuation */
+		if (in_macro) {
+			in_macro = (llen > 0 && lp[llen-1] == '\\');
+			continue;
+		}
+		for (n=0; pp[n] == ' ' || pp[n] == '\t'; n++)
+			;
+		if (pp[n] == '#') {
+			in_macro = (llen > 0 && lp[llen-1] == '\\');
+			tag_mk_define (mk, fname, lp, pp+n+1, li+1);
+			continue;
+		}
+		if (depth == 0 && strncmp(pp+n, "typedef", 7) == 0 && strchr(pp, '{') == NULL) {
+			tag_mk_typedef (mk, fname, lp, pp, li+1);
+		}
+
+		for (i=0; pp[i] != '\0'; i++) {
+			if (pp[i] == '{') {
+				if (depth == 0) {
+					/* the header is above the opening brace, but below the previous block */
+					tdef = 0;
+					for (k = li; k >= prev_end; k--) {
+						found = c_header_test (buff + lstart[k], lstart[k+1] - lstart[k] - 1,
+							(k == li) ? i : 0, (k == li), regs, pmatch);
+						if (found < 0)
+							break;
+						if (found) {
+							tdef = tag_mk_header (mk, fname, buff + lstart[k], k+1, found, pmatch);
+							break;
+						}
+					}
+				}
+				depth++;
+			} else if (pp[i] == '}' && depth > 0) {
+				depth--;
+				if (depth == 0) {
+					if (tdef)
+						tag_mk_name (mk, fname, lp, pp+i+1, li+1, TAG_TYPEDEF);
+					tdef = 0;
+					prev_end = li+1;
+				}
+			}
+		}
+	}
+
+	FREE(lstart);
+	FREE(buff);
+	FREE(pure);
+	return;
+} /* tag_mk_scan */
+
+/*
+* add the tag of the block header by the matching pattern of c_header_test(),
+* return 1 if the name of the typedef comes after the block
+*/
+static int
+tag_mk_header (MKCHUNK *mk, const char *fname, const char *line, int lineno, int found, const regmatch_t *pmatch)
+{
+	static const char *keywords[] = { "if", "for", "while", "switch", "return", "sizeof", NULL };
+	const char *sym;
+	int len, i;
+	TAGTYPE type;
+
+	if (found == 5)
+		return (1);
+
+	i = (found == 3) ? 2 : 1;
+	if (pmatch[i].rm_so < 0 || pmatch[i].rm_so >= pmatch[i].rm_eo)
+		return (0);
+	sym = line + pmatch[i].rm_so;
+	len = (int)(pmatch[i].rm_eo - pmatch[i].rm_so);
+
+	if (found == 1 || found == 2) {
+		type = TAG_FUNCTION;
+		/* the method name without the class */
+		for (i = len-1; i > 0; i--) {
+			if (sym[i-1] == ':' && sym[i] != ':')
+				break;
+		}
+		if (i > 0) {
+			sym += i;
+			len -= i;
+		}
+		for (i=0; keywords[i] != NULL; i++) {
+			if ((int)strlen(keywords[i]) == len && strncmp(sym, keywords[i], (size_t)len) == 0)
+				return (0);
+		}
+	} else if (found == 3) {
+		type = (line[pmatch[1].rm_so] == 's') ? TAG_STRUCTURE :
+			((line[pmatch[1].rm_so] == 'u') ? TAG_UNION : TAG_GLOB);
+	} else {
+		type = TAG_VARIABLE;
+		while (len > 0 && *sym == '*') {
+			sym++;
+			len--;
+		}
+		for (i=0; i < len && (sym[i] == '_' || (sym[i] >= 'a' && sym[i] <= 'z') ||
+			(sym[i] >= 'A' && sym[i] <= 'Z') || (sym[i] >= '0' && sym[i] <= '9')); i++)
+			;
+		len = i;
+	}
+	if (len > 0)
+		tag_mk_add (mk, sym, len, fname, line, lineno, type);
+
+	return (found == 3 && strncmp(line, "typedef", 7) == 0);
+} /* tag_mk_header */
+
+/*
+* add the macro of the preprocessor line, pp is after the '#'
+*/
+static void
+tag_mk_define (MKCHUNK *mk, const char *fname, const char *line, const char *pp, int lineno)
+{
+	while (*pp == ' ' || *pp == '\t')
+		pp++;
+	if (strncmp(pp, "define", 6) == 0 && (pp[6] == ' ' || pp[6] == '\t')) {
+		tag_mk_name (mk, fname, line, pp+6, lineno, TAG_DEFINE);
+	}
+} /* tag_mk_define */
+
+/*
+* add the name of the one line typedef, before the final ';' or in the "(*name)" of a function pointer
+*/
+static void
+tag_mk_typedef (MKCHUNK *mk, const char *fname, const char *line, const char *pp, int lineno)
+{
+	const char *cs;
+	int e, d;
+
+	if ((cs = strstr(pp, "(*")) != NULL) {
+		tag_mk_name (mk, fname, line, cs+2, lineno, TAG_TYPEDEF);
+		return;
+	}
+	if ((cs = strrchr(pp, ';')) == NULL)
+		return;
+	e = (int)(cs - pp);
+	while (e > 0 && (pp[e-1] == ' ' || pp[e-1] == '\t'))
+		e--;
+	if (e > 0 && pp[e-1] == ']') {
+		/* array dimension */
+		for (d=0; e > 0; e--) {
+			if (pp[e-1] == ']')
+				d++;
+			else if (pp[e-1] == '[' && --d == 0 && (e < 2 || pp[e-2] != ']'))
+				break;
+		}
+		if (e > 0)
+			e--;
+		while (e > 0 && (pp[e-1] == ' ' || pp[e-1] == '\t'))
+			e--;
+	}
+	for (d=e; d > 0 && (pp[d-1] == '_' || (pp[d-1] >= 'a' && pp[d-1] <= 'z') ||
+		(pp[d-1] >= 'A' && pp[d-1] <= 'Z') || (pp[d-1] >= '0' && pp[d-1] <= '9')); d--)
+		;
+	if (d < e && !(pp[d] >= '0' && pp[d] <= '9'))
+		tag_mk_add (mk, pp+d, e-d, fname, line, lineno, TAG_TYPEDEF);
+} /* tag_mk_typedef */
+
+/*
+* add the identifier from pp, after blanks and stars
+*/
+static void
+tag_mk_name (MKCHUNK *mk, const char *fname, const char *line, const char *pp, int lineno, TAGTYPE type)
+{
+	int len;
+
+	while (*pp == ' ' || *pp == '\t' || *pp == '*')
+		pp++;
+	if (!(*pp == '_' || (*pp >= 'a' && *pp <= 'z') || (*pp >= 'A' && *pp <= 'Z')))
+		return;
+	for (len=0; pp[len] == '_' || (pp[len] >= 'a' && pp[len] <= 'z') ||
+		(pp[len] >= 'A' && pp[len] <= 'Z') || (pp[len] >= '0' && pp[len] <= '9'); len++)
+		;
+	tag_mk_add (mk, pp, len, fname, line, lineno, type);
+} /* tag_mk_name */
+
+/*
+* append one ctags line to the output of the worker,
+* the macros with line number, others with the search pattern of the line
+*/
+static void
+tag_mk_add (MKCHUNK *mk, const char *sym, int len, const char *fname, const char *line, int lineno, TAGTYPE type)
+{
+	size_t need, llen;
+	char *px;
+	int i;
+
+	llen = strlen(line);
+	while (llen > 0 && line[llen-1] == '\r')
+		llen--;
+	need = (size_t)len + strlen(fname) + 2*llen + 40;
+	if (mk->outlen + need > mk->outsize) {
+		px = (char *) REALLOC(mk->out, mk->outsize + need + 0x10000);
+		if (px == NULL) {
+			mk->err = 1;
+			return;
+		}
+		mk->out = px;
+		mk->outsize += need + 0x10000;
+	}
+
+	px = mk->out + mk->outlen;
+	memcpy(px, sym, (size_t)len);
+	px += len;
+	px += sprintf(px, "\t%s\t", fname);
+	if (type == TAG_DEFINE) {
+		px += sprintf(px, "%d", lineno);
+	} else {
+		*px++ = '/';
+		*px++ = '^';
+		for (i=0; (size_t)i < llen; i++) {
+			if (line[i] == '\\' || line[i] == '/')
+				*px++ = '\\';
+			*px++ = line[i];
+		}
+		*px++ = '$';
+		*px++ = '/';
+	}
+	px += sprintf(px, ";\"\t%c\n", (char)type);
+	mk->outlen = (size_t)(px - mk->out);
+} /* tag_mk_add */
+
+/*
+* write the tags in ctags format, sorted by symbol,
+* return 0 if ok, 1 on failure
+*/
+static int
+tag_mk_write (const TAGDB *db, const char *path)
+{
+	char tmpname[FNAMESIZE+20];
+	FILE *fp;
+	const TAG *tp;
+	int i, ret=0;
+
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", path);
+	if ((fp = fopen(tmpname, "w")) == NULL)
+		return (1);
+
+	fprintf(fp, "!_TAG_FILE_FORMAT\t2\t/extended format/\n");
+	fprintf(fp, "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n");
+	fprintf(fp, "!_TAG_PROGRAM_NAME\teda\t//\n");
+	for (i=0; i < db->ntags; i++) {
+		tp = db->index[i];
+		if (tp->type == TAG_DEFINE)
+			fprintf(fp, "%s\t%s\t%d;\"\t%c\n", tp->symbol, tp->fname, tp->lineno, (char)tp->type);
+		else
+			fprintf(fp, "%s\t%s\t%s;\"\t%c\n", tp->symbol, tp->fname, tp->pattern, (char)tp->type);
+	}
+	if (ferror(fp))
+		ret = 1;
+	if (fclose(fp) != 0)
+		ret = 1;
+	if (ret == 0 && rename(tmpname, path) != 0)
+		ret = 1;
+	if (ret)
+		unlink(tmpname);
+
+	return (ret);
+} /* tag_mk_write */
@@ -30,6 +30,7 @@
 #include <glob.h>		/* glob, globfree */
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>		/* clock_gettime */
 #include "main.h"
 #include "proto.h"
 
@@ -823,3 +824,16 @@ is_process_alive (int pid)
 
 	return retval;
 }
+
+/* monotonic clock in milliseconds, for elapsed time reports
+*/
+long long
+msec_clock (void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+		return 0;
+	}
+	return ((long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}